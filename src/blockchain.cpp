@@ -6,11 +6,12 @@
 namespace Quasar
 {
 
-Blockchain::Blockchain()
+Blockchain::Blockchain(Round retention) : m_retention(retention), m_forks_pruned(0), m_pruned(0), m_abandoned(0)
 {
 	auto ptr = std::make_shared<Block>(GENESIS);
 	m_committed = ptr;
 	m_blocks.insert({ptr->hash(), ptr});
+	m_rounds[ptr->round()].push_back(ptr->hash());
 }
 
 std::shared_ptr<Block> Blockchain::find(Hash hash) const
@@ -27,7 +28,10 @@ void Blockchain::add(const Block &block)
 {
 	auto ptr = std::make_shared<Block>(block);
 	auto hash = ptr->hash();
-	m_blocks.insert({hash, ptr});
+	if (m_blocks.insert({hash, ptr}).second)
+	{
+		m_rounds[ptr->round()].push_back(hash);
+	}
 }
 
 std::shared_ptr<Block> Blockchain::committed_block() const
@@ -37,8 +41,9 @@ std::shared_ptr<Block> Blockchain::committed_block() const
 
 void Blockchain::commit(const std::shared_ptr<Block> &block)
 {
+	// the parent is missing if it was pruned, in which case it is committed already
 	auto parent = find(block->parent());
-	if (m_committed->round() < parent->round())
+	if (parent && m_committed->round() < parent->round())
 	{
 		commit(parent);
 	}
@@ -49,6 +54,12 @@ void Blockchain::commit(const std::shared_ptr<Block> &block)
 	}
 
 	m_committed = block;
+
+	// the committed block itself is never pruned, as its round is within the window
+	if (block->round() > m_retention)
+	{
+		prune(block->round() - m_retention);
+	}
 }
 
 void Blockchain::set_commit_handler(std::function<void(std::shared_ptr<Block>)> handler)
@@ -56,4 +67,71 @@ void Blockchain::set_commit_handler(std::function<void(std::shared_ptr<Block>)>
 	m_commit_handler = std::move(handler);
 }
 
-} // namespace Quasar
\ No newline at end of file
+void Blockchain::prune_forks(const Block &lock)
+{
+	if (lock.round() <= m_forks_pruned)
+	{
+		return;
+	}
+
+	// collect the ancestors of the lock down to the rounds that were cleaned up before, newest first
+	std::vector<std::pair<Round, Hash>> chain;
+	for (auto block = find(lock.parent()); block && block->round() >= m_forks_pruned; block = find(block->parent()))
+	{
+		chain.emplace_back(block->round(), block->hash());
+	}
+
+	auto ancestor = chain.rbegin();
+	const auto end = m_rounds.lower_bound(lock.round());
+	for (auto it = m_rounds.lower_bound(m_forks_pruned); it != end;)
+	{
+		auto &[round, hashes] = *it;
+		while (ancestor != chain.rend() && ancestor->first < round)
+		{
+			ancestor++;
+		}
+		const auto *keep = ancestor != chain.rend() && ancestor->first == round ? &ancestor->second : nullptr;
+
+		std::erase_if(hashes, [&](const Hash &hash) {
+			if ((keep && hash == *keep) || hash == m_committed->hash())
+			{
+				return false;
+			}
+			m_blocks.erase(hash);
+			m_abandoned++;
+			return true;
+		});
+
+		it = hashes.empty() ? m_rounds.erase(it) : std::next(it);
+	}
+
+	m_forks_pruned = lock.round();
+	m_blocks.shrink();
+}
+
+Blockchain::Stats Blockchain::stats() const
+{
+	return {m_blocks.size(), m_pruned, m_abandoned};
+}
+
+void Blockchain::prune(Round min_round)
+{
+	const auto end = m_rounds.lower_bound(min_round);
+	if (end == m_rounds.begin())
+	{
+		return;
+	}
+
+	for (auto it = m_rounds.begin(); it != end; ++it)
+	{
+		for (const auto &hash : it->second)
+		{
+			m_blocks.erase(hash);
+		}
+		m_pruned += it->second.size();
+	}
+	m_rounds.erase(m_rounds.begin(), end);
+	m_blocks.shrink();
+}
+
+} // namespace Quasar
@@ -1,29 +1,58 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <memory>
-#include <unordered_map>
+#include <vector>
 
+#include "flat_map.h"
 #include "types.h"
 
 namespace Quasar
 {
 
+// Blockchain holds the blocks that consensus works on. Blocks of rounds that are too far below the committed block,
+// and blocks on forks below the lock, are pruned, so that the number of blocks stays bounded however long a node runs.
 class Blockchain
 {
   public:
-	Blockchain();
+	struct Stats
+	{
+		size_t blocks;
+		// pruned counts blocks that fell out of the retention window, abandoned those that were on forks below the lock
+		uint64_t pruned;
+		uint64_t abandoned;
+	};
+
+	// retention is how many rounds of blocks below the committed block are kept
+	explicit Blockchain(Round retention = 1024);
 	std::shared_ptr<Block> find(Hash hash) const;
 	void add(const Block &block);
 	// committed_block returns the most recently committed block
 	std::shared_ptr<Block> committed_block() const;
+	// commit commits the block along with its uncommitted ancestors, and prunes the blocks below the retention window
 	void commit(const std::shared_ptr<Block> &block);
 	void set_commit_handler(std::function<void(std::shared_ptr<Block>)> handler);
 
+	// prune_forks drops the blocks of rounds below the lock that are not its ancestors, which can never be committed
+	void prune_forks(const Block &lock);
+
+	Stats stats() const;
+
   private:
-	std::unordered_map<Hash, std::shared_ptr<Block>> m_blocks;
+	void prune(Round min_round);
+
+	FlatMap<Hash, std::shared_ptr<Block>> m_blocks;
+	// rounds indexes the hashes of the blocks by round, so that pruning only visits the rounds that it drops
+	std::map<Round, std::vector<Hash>> m_rounds;
 	std::shared_ptr<Block> m_committed;
 	std::function<void(std::shared_ptr<Block>)> m_commit_handler;
+
+	const Round m_retention;
+	// forks_pruned is the round below which forks were dropped already
+	Round m_forks_pruned;
+	uint64_t m_pruned;
+	uint64_t m_abandoned;
 };
 
 } // namespace Quasar
@@ -11,3 +11,75 @@ TEST_CASE("Get Genesis", "[blockchain]")
 	REQUIRE(block != nullptr);
 	REQUIRE(block->hash() == Quasar::GENESIS.hash());
 }
+
+namespace
+{
+
+Quasar::Block make_block(const Quasar::Block &parent, Quasar::Round round, uint8_t data = 0)
+{
+	std::vector<Quasar::Transaction> transactions{Quasar::Transaction{std::vector<Quasar::byte>{Quasar::byte{data}}}};
+	return Quasar::Block{parent.hash(), Quasar::GENESIS_CERT, round, Quasar::Payload{transactions}};
+}
+
+} // namespace
+
+TEST_CASE("Blocks below the retention window are pruned on commit", "[blockchain]")
+{
+	Quasar::Blockchain blockchain{2};
+
+	std::vector<Quasar::Block> blocks{Quasar::GENESIS};
+	for (Quasar::Round round = 1; round <= 10; round++)
+	{
+		blocks.push_back(make_block(blocks.back(), round));
+		blockchain.add(blocks.back());
+	}
+
+	std::vector<Quasar::Round> committed;
+	blockchain.set_commit_handler([&](const auto &block) { committed.push_back(block->round()); });
+	blockchain.commit(blockchain.find(blocks[10].hash()));
+
+	REQUIRE(committed.size() == 10);
+	REQUIRE(blockchain.committed_block()->hash() == blocks[10].hash());
+	for (Quasar::Round round = 0; round <= 10; round++)
+	{
+		REQUIRE((blockchain.find(blocks[round].hash()) != nullptr) == (round >= 8));
+	}
+
+	auto stats = blockchain.stats();
+	REQUIRE(stats.blocks == 3);
+	REQUIRE(stats.pruned == 8);
+	REQUIRE(stats.abandoned == 0);
+}
+
+TEST_CASE("Forks below the lock are dropped", "[blockchain]")
+{
+	Quasar::Blockchain blockchain;
+
+	const auto b1 = make_block(Quasar::GENESIS, 1);
+	const auto b2 = make_block(b1, 2);
+	const auto b3 = make_block(b2, 3);
+	const auto b4 = make_block(b3, 4);
+	const auto fork2 = make_block(b1, 2, 1);
+	const auto fork3 = make_block(b1, 3, 1);
+	for (const auto &block : {b1, b2, b3, b4, fork2, fork3})
+	{
+		blockchain.add(block);
+	}
+
+	// a fork of the lock's round may still be extended
+	blockchain.prune_forks(b3);
+	REQUIRE(blockchain.find(fork2.hash()) == nullptr);
+	REQUIRE(blockchain.find(fork3.hash()) != nullptr);
+
+	blockchain.prune_forks(b4);
+	REQUIRE(blockchain.find(fork3.hash()) == nullptr);
+
+	for (const auto &block : {Quasar::GENESIS, b1, b2, b3, b4})
+	{
+		REQUIRE(blockchain.find(block.hash()) != nullptr);
+	}
+
+	auto stats = blockchain.stats();
+	REQUIRE(stats.blocks == 5);
+	REQUIRE(stats.abandoned == 2);
+}
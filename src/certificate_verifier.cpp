@@ -0,0 +1,236 @@
+#include "certificate_verifier.h"
+#include "crypto.h"
+
+namespace Quasar
+{
+
+namespace
+{
+
+Hash signature_key(const Hash &message_digest, const Signature &signature)
+{
+	Hash key{};
+	auto &hash_fn = Crypto::hasher();
+	hash_fn.update(message_digest.data(), message_digest.size());
+	hash_fn.update(signature.signer().data(), signature.signer().size());
+	hash_fn.update(signature.data().data(), signature.data().size());
+	hash_fn.final(key.data());
+	return key;
+}
+
+Hash certificate_key(const Hash &message_digest, const Certificate &cert)
+{
+	Hash key{};
+	auto &hash_fn = Crypto::hasher();
+	hash_fn.update(message_digest.data(), message_digest.size());
+	hash_fn.update(cert.digest().data(), cert.digest().size());
+	hash_fn.final(key.data());
+	return key;
+}
+
+} // namespace
+
+CertificateVerifier::CertificateVerifier(std::shared_ptr<Keystore> keystore, const Settings::Crypto &settings)
+    : m_keystore(std::move(keystore)), m_stopped(false), m_signature_cache(settings.signature_cache_size()),
+      m_certificate_cache(settings.certificate_cache_size()), m_stats()
+{
+	for (size_t i = 1; i < settings.verifier_threads(); i++)
+	{
+		m_workers.emplace_back([this] { run_worker(); });
+	}
+}
+
+CertificateVerifier::~CertificateVerifier()
+{
+	{
+		std::lock_guard lock{m_jobs_mutex};
+		m_stopped = true;
+	}
+	m_jobs_cv.notify_all();
+
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+bool CertificateVerifier::verify(const Certificate &cert, const std::string &message)
+{
+	auto start = std::chrono::steady_clock::now();
+	const auto message_digest = Crypto::hash(message);
+	const auto key = certificate_key(message_digest, cert);
+
+	if (m_certificate_cache.contains(key))
+	{
+		std::lock_guard lock{m_stats_mutex};
+		m_stats.cached_certificates++;
+		return true;
+	}
+
+	size_t cached = 0;
+	bool valid = false;
+	try
+	{
+		valid = verify_signatures(cert, message, message_digest, cached);
+	}
+	catch (...)
+	{
+		record(std::chrono::steady_clock::now() - start, cert.signers().size(), cached, false);
+		throw;
+	}
+	record(std::chrono::steady_clock::now() - start, cert.signers().size(), cached, valid);
+
+	if (valid)
+	{
+		m_certificate_cache.insert(key);
+	}
+	return valid;
+}
+
+bool CertificateVerifier::verify_signature(const Signature &signature, const std::string &message)
+{
+	const auto key = signature_key(Crypto::hash(message), signature);
+	if (m_signature_cache.contains(key))
+	{
+		return true;
+	}
+
+	if (!m_keystore->verify(signature, message))
+	{
+		return false;
+	}
+	m_signature_cache.insert(key);
+	return true;
+}
+
+void CertificateVerifier::add_verified(const Certificate &cert, const std::string &message)
+{
+	m_certificate_cache.insert(certificate_key(Crypto::hash(message), cert));
+}
+
+bool CertificateVerifier::verify_signatures(const Certificate &cert, const std::string &message,
+                                            const Hash &message_digest, size_t &cached)
+{
+	// an aggregate signature is checked with one multi-scalar multiplication, which is not split up
+	if (cert.is_aggregate())
+	{
+		return m_keystore->verify_aggregate(cert, message);
+	}
+
+	const auto count = cert.signatures().size();
+
+	auto job = std::make_shared<Job>();
+	job->certificate = &cert;
+	job->message = &message;
+	job->message_digest = message_digest;
+	job->count = count;
+	job->pending = count;
+
+	// a single signature is not worth a hand-off to the workers
+	if (!m_workers.empty() && count > 1)
+	{
+		{
+			std::lock_guard lock{m_jobs_mutex};
+			m_jobs.push_back(job);
+		}
+		m_jobs_cv.notify_all();
+	}
+
+	work(*job);
+
+	// wait for the workers to finish the signatures they took, since they point into cert and message
+	for (auto pending = job->pending.load(); pending != 0; pending = job->pending.load())
+	{
+		job->pending.wait(pending);
+	}
+
+	cached = job->cached;
+	if (job->error)
+	{
+		std::rethrow_exception(job->error);
+	}
+	return !job->failed;
+}
+
+CertificateVerifier::Stats CertificateVerifier::stats() const
+{
+	std::lock_guard lock{m_stats_mutex};
+	return m_stats;
+}
+
+void CertificateVerifier::work(Job &job)
+{
+	for (auto i = job.next++; i < job.count; i = job.next++)
+	{
+		// once a signature is invalid the certificate is, so the remaining signatures are only counted off
+		if (!job.failed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				const auto &signature = job.certificate->signatures()[i];
+				const auto key = signature_key(job.message_digest, signature);
+				if (m_signature_cache.contains(key))
+				{
+					job.cached++;
+				}
+				else if (m_keystore->verify(signature, *job.message))
+				{
+					m_signature_cache.insert(key);
+				}
+				else
+				{
+					job.failed = true;
+				}
+			}
+			catch (...)
+			{
+				std::call_once(job.error_once, [&] { job.error = std::current_exception(); });
+				job.failed = true;
+			}
+		}
+
+		if (job.pending.fetch_sub(1) == 1)
+		{
+			job.pending.notify_all();
+		}
+	}
+}
+
+void CertificateVerifier::run_worker()
+{
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock lock{m_jobs_mutex};
+			m_jobs_cv.wait(lock, [this] { return m_stopped || !m_jobs.empty(); });
+			if (m_stopped)
+			{
+				return;
+			}
+			job = m_jobs.front();
+		}
+
+		work(*job);
+
+		// all signatures of the job are taken, so other workers do not need to look at it anymore
+		std::lock_guard lock{m_jobs_mutex};
+		if (!m_jobs.empty() && m_jobs.front() == job)
+		{
+			m_jobs.pop_front();
+		}
+	}
+}
+
+void CertificateVerifier::record(std::chrono::nanoseconds latency, size_t signatures, size_t cached, bool valid)
+{
+	std::lock_guard lock{m_stats_mutex};
+	m_stats.certificates++;
+	m_stats.signatures += signatures;
+	m_stats.cached_signatures += cached;
+	m_stats.failures += valid ? 0 : 1;
+	m_stats.total_latency += latency;
+	m_stats.max_latency = std::max(m_stats.max_latency, latency);
+}
+
+} // namespace Quasar
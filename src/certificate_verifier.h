@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "digest_cache.h"
+#include "keystore.h"
+#include "settings.h"
+#include "types.h"
+
+namespace Quasar
+{
+
+// CertificateVerifier checks the signatures of a certificate in parallel.
+// The calling thread and a pool of worker threads take signatures from the same certificate until all of them
+// are checked, or until one of them turns out to be invalid, in which case the remaining ones are skipped.
+// Valid signatures and certificates are remembered in bounded caches, so that a signature that arrives again, for
+// example in the certificates of several Advance messages, is only verified once.
+class CertificateVerifier
+{
+  public:
+	struct Stats
+	{
+		uint64_t certificates;
+		uint64_t signatures;
+		uint64_t failures;
+		// cached_certificates and cached_signatures count those found in the caches, which were not verified again
+		uint64_t cached_certificates;
+		uint64_t cached_signatures;
+		std::chrono::nanoseconds total_latency;
+		std::chrono::nanoseconds max_latency;
+
+		std::chrono::nanoseconds mean_latency() const
+		{
+			return certificates == 0 ? std::chrono::nanoseconds{0} : total_latency / (int64_t)certificates;
+		}
+	};
+
+	CertificateVerifier(std::shared_ptr<Keystore> keystore, const Settings::Crypto &settings);
+	~CertificateVerifier();
+
+	CertificateVerifier(const CertificateVerifier &) = delete;
+	CertificateVerifier &operator=(const CertificateVerifier &) = delete;
+
+	// verify returns whether all signatures of the certificate are valid signatures of message.
+	// Throws an exception of kind NOT_FOUND if a signer is unknown.
+	bool verify(const Certificate &cert, const std::string &message);
+
+	// verify_signature verifies a single signature, using the same cache as the signatures of certificates.
+	// Throws an exception of kind NOT_FOUND if the signer is unknown.
+	bool verify_signature(const Signature &signature, const std::string &message);
+
+	// add_verified marks a certificate as valid without verifying it, which is meant for certificates that were
+	// assembled from signatures that were already verified.
+	void add_verified(const Certificate &cert, const std::string &message);
+
+	Stats stats() const;
+
+  private:
+	struct Job
+	{
+		// certificate and message may only be accessed while a signature is taken, since the caller owns them
+		const Certificate *certificate;
+		const std::string *message;
+		Hash message_digest;
+		size_t count;
+		std::atomic<size_t> next;
+		std::atomic<size_t> pending;
+		std::atomic<bool> failed;
+		std::atomic<size_t> cached;
+		std::exception_ptr error;
+		std::once_flag error_once;
+	};
+
+	bool verify_signatures(const Certificate &cert, const std::string &message, const Hash &message_digest,
+	                       size_t &cached);
+	void work(Job &job);
+	void run_worker();
+	void record(std::chrono::nanoseconds latency, size_t signatures, size_t cached, bool valid);
+
+	std::shared_ptr<Keystore> m_keystore;
+
+	std::mutex m_jobs_mutex;
+	std::condition_variable m_jobs_cv;
+	std::deque<std::shared_ptr<Job>> m_jobs;
+	bool m_stopped;
+	std::vector<std::thread> m_workers;
+
+	DigestCache m_signature_cache;
+	DigestCache m_certificate_cache;
+
+	mutable std::mutex m_stats_mutex;
+	Stats m_stats;
+};
+
+} // namespace Quasar
@@ -1,34 +1,53 @@
+#include <google/protobuf/arena.h>
+#include <cstring>
+
 #include "consensus.h"
-#include "crypto.h"
+#include "exception.h"
 #include "quorum.h"
 
 namespace Quasar
 {
 
+namespace
+{
+
+// MAX_PENDING_PROPOSALS_PER_SIGNER bounds the compact proposals of one signer that wait for transactions, as the
+// proposal of a round far ahead is not cleaned up by the rounds passing
+const size_t MAX_PENDING_PROPOSALS_PER_SIGNER = 4;
+
+} // namespace
+
 Consensus::Consensus(const Settings::Consensus &settings, const std::shared_ptr<EventQueue> &event_queue,
-                     const std::shared_ptr<Blockchain> &blockchain, const std::shared_ptr<Keystore> &keystore,
+                     const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Blockchain> &blockchain,
+                     const std::shared_ptr<Keystore> &keystore, const std::shared_ptr<CertificateVerifier> &verifier,
+                     const std::shared_ptr<Mempool> &mempool, const std::shared_ptr<Dissemination> &dissemination,
                      const std::shared_ptr<Network> &network, const std::shared_ptr<Synchronizer> &synchronizer,
                      const std::shared_ptr<LeaderRotation> &leader_rotation,
                      const std::shared_ptr<spdlog::logger> &logger)
-    : m_settings(settings), m_event_queue(event_queue), m_blockchain(blockchain), m_keystore(keystore),
+    : m_settings(settings), m_event_queue(event_queue), m_reactor(reactor), m_blockchain(blockchain),
+      m_keystore(keystore), m_verifier(verifier), m_mempool(mempool), m_dissemination(dissemination),
       m_network(network), m_synchronizer(synchronizer), m_leader_rotation(leader_rotation), m_logger(logger),
+      m_proposal_timer(0),
       m_lock(std::make_shared<Block>(GENESIS)), m_high_cert({GENESIS_CERT, GENESIS.hash()}), m_next_vote_round(1)
 {
 }
 
 void Consensus::init()
 {
-	m_event_queue->appendListener(EventType::MESSAGE, [self = shared_from_this()](const EventData &event) {
-		auto &pair = std::get<std::pair<Signature, Proto::MessageData>>(event);
-		self->handle_message(pair.first, pair.second);
-	});
+	m_event_queue->append_listener<MessageEvent>(
+	    [self = shared_from_this()](const MessageEvent &event) { self->handle_message(event.signature, *event.data); });
 
-	m_event_queue->appendListener(EventType::TIMEOUT, [self = shared_from_this()](const EventData &event) {
-		self->stop_voting(std::get<Round>(event));
-	});
+	m_event_queue->append_listener<TimeoutEvent>(
+	    [self = shared_from_this()](const TimeoutEvent &event) { self->stop_voting(event.round); });
 
-	m_event_queue->appendListener(EventType::ADVANCE, [self = shared_from_this()](const EventData &event) {
-		auto [round, timeout] = std::get<std::pair<Round, bool>>(event);
+	m_event_queue->append_listener<AdvanceEvent>([self = shared_from_this()](const AdvanceEvent &event) {
+		auto [round, timeout] = event;
+
+		// a proposal that is still pending belongs to an earlier round
+		self->m_reactor->cancel_timer(self->m_proposal_timer);
+
+		// a block is needed as the parent of the proposal in the next round, so it is awaited for one more round
+		self->m_pending_proposals.erase_if([round](const auto &entry) { return entry.second.round + 1 < round; });
 
 		auto all_nodes = self->m_network->connected_peers();
 		all_nodes.push_back(self->m_keystore->identity());
@@ -40,10 +59,9 @@ void Consensus::init()
 				self->make_proposal();
 			}
 			// wait for about one theta (that is, the message passing delay)
-			self->m_timer_manager.add(self->m_synchronizer->round_duration() / 2, [self](auto timer_id) {
-				self->m_timer_manager.remove(timer_id);
-				self->m_event_queue->dispatch(EventType::CALLBACK, [self]() { self->make_proposal(); });
-			});
+			auto delay = self->m_synchronizer->round_duration() / 2;
+			auto deadline = Reactor::Clock::now() + std::chrono::duration_cast<Reactor::Clock::duration>(delay);
+			self->m_proposal_timer = self->m_reactor->add_timer(deadline, [self]() { self->make_proposal(); });
 		}
 	});
 }
@@ -52,29 +70,340 @@ void Consensus::handle_message(const Signature &sig, const Proto::MessageData &m
 {
 	if (msg.has_proposal())
 	{
-		handle_proposal(sig, msg);
+		if (msg.proposal().has_compact_payload())
+		{
+			handle_compact_proposal(sig, msg);
+		}
+		else
+		{
+			handle_proposal(sig, msg);
+		}
 	}
 	else if (msg.has_vote())
 	{
 		handle_vote(sig, msg);
 	}
+	else if (msg.has_transaction_request())
+	{
+		handle_transaction_request(sig, msg);
+	}
+	else if (msg.has_transaction_response())
+	{
+		handle_transaction_response(sig, msg);
+	}
 }
 
-Proto::Message make_vote(const Signature &signature, Hash hash)
+void make_vote(Proto::Message *msg, const Signature &signature, const Block &block, const Schnorr::Share &share)
 {
-	Proto::Message msg;
-	auto sig_ptr = msg.mutable_signature();
-	*sig_ptr = signature.to_proto();
-	auto data_ptr = msg.mutable_data();
-	auto vote_ptr = data_ptr->mutable_vote();
-	vote_ptr->set_block_hash(hash.to_byte_string());
-	return msg;
+	signature.to_proto(msg->mutable_signature());
+	auto vote_ptr = msg->mutable_data()->mutable_vote();
+	const auto hash = block.hash();
+	vote_ptr->set_block_hash(hash.data(), hash.size());
+	vote_ptr->set_share(share.data(), share.size());
+	vote_ptr->set_round(block.round());
 }
 
 void Consensus::handle_proposal(const Signature &sig, const Proto::MessageData &msg)
 {
-	const Block proposal{msg.proposal()};
+	std::optional<Block> proposal;
+	try
+	{
+		proposal.emplace(msg.proposal(), *m_keystore->validators());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("proposal by {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+
+	process_proposal(sig, *proposal);
+}
+
+void Consensus::handle_compact_proposal(const Signature &sig, const Proto::MessageData &msg)
+{
+	const auto &proto = msg.proposal();
+	const auto &short_ids = proto.compact_payload().short_ids();
+	if (short_ids.size() % sizeof(uint64_t) != 0)
+	{
+		m_logger->warn("compact proposal by {:.8} has malformed short IDs", sig.signer().to_hex_string());
+		return;
+	}
+
+	// the block without its payload provides the other fields
+	std::optional<Block> header;
+	Hash root;
+	try
+	{
+		header.emplace(proto, *m_keystore->validators());
+		root = Hash::from_byte_string(proto.compact_payload().root());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("compact proposal by {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+
+	PendingProposal pending{sig,
+	                        header->parent(),
+	                        header->certificate(),
+	                        header->round(),
+	                        root,
+	                        header->batches(),
+	                        std::vector<std::optional<Transaction>>(short_ids.size() / sizeof(uint64_t)),
+	                        std::vector<uint64_t>(short_ids.size() / sizeof(uint64_t)),
+	                        0,
+	                        false};
+
+	// the header commits to the payload by its root, so the block hash is known before the payload is rebuilt
+	const auto block_hash = BlockHeader{pending.parent, pending.round, pending.certificate.digest(), pending.root,
+	                                    header->header().batches_root}
+	                            .hash();
+	if (m_pending_proposals.contains(block_hash) || m_blockchain->find(block_hash))
+	{
+		return;
+	}
+
+	// a signer keeps the proposals of its lowest rounds pending, which are the ones that the rounds passing clean up
+	size_t held = 0;
+	auto highest = m_pending_proposals.end();
+	for (auto entry = m_pending_proposals.begin(); entry != m_pending_proposals.end(); ++entry)
+	{
+		if (entry->second.signature.signer() != sig.signer())
+		{
+			continue;
+		}
+		held++;
+		if (highest == m_pending_proposals.end() || entry->second.round > highest->second.round)
+		{
+			highest = entry;
+		}
+	}
+	if (held >= MAX_PENDING_PROPOSALS_PER_SIGNER)
+	{
+		if (highest->second.round <= pending.round)
+		{
+			m_logger->warn("compact proposal in round {} by {:.8} is dropped, too many of its proposals are pending",
+			               pending.round, sig.signer().to_hex_string());
+			return;
+		}
+		m_pending_proposals.erase(highest);
+	}
+
+	for (size_t i = 0; i < pending.transactions.size(); i++)
+	{
+		uint64_t id;
+		std::memcpy(&id, short_ids.data() + i * sizeof(id), sizeof(id));
+		pending.short_ids[i] = id;
+		if (auto transaction = m_mempool->find(id))
+		{
+			pending.transactions[i] = std::move(*transaction);
+		}
+		else
+		{
+			pending.missing++;
+		}
+	}
+
+	auto [it, inserted] = m_pending_proposals.emplace(block_hash, std::move(pending));
+	if (it->second.missing > 0)
+	{
+		m_logger->debug("{} of {} transactions of proposal {:.8} are missing", it->second.missing,
+		                it->second.transactions.size(), block_hash.to_hex_string());
+		request_transactions(block_hash, it->second);
+		return;
+	}
+	complete_proposal(block_hash);
+}
+
+void Consensus::handle_transaction_request(const Signature &sig, const Proto::MessageData &msg)
+{
+	const auto &request = msg.transaction_request();
+	Hash block_hash;
+	try
+	{
+		block_hash = Hash::from_byte_string(request.block_hash());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("transaction request by {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+	auto block = m_blockchain->find(block_hash);
+	if (!block)
+	{
+		m_logger->debug("could not find block {:.8} requested by {:.8}", block_hash.to_hex_string(),
+		                sig.signer().to_hex_string());
+		return;
+	}
+
+	google::protobuf::Arena arena;
+	auto response_msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto response = response_msg->mutable_data()->mutable_transaction_response();
+	response->set_block_hash(request.block_hash());
+
+	PayloadBuilder builder;
+	const auto &payload = block->payload();
+	for (auto index : request.indexes())
+	{
+		if (index < payload.size())
+		{
+			response->add_indexes(index);
+			builder.add(payload[index]);
+		}
+	}
+	builder.build().to_proto(response->mutable_transactions());
+
+	auto response_sig = m_keystore->sign(response_msg->data().SerializeAsString());
+	response_sig.to_proto(response_msg->mutable_signature());
+
+	if (!m_network->send_message(sig.signer(), *response_msg))
+	{
+		m_logger->warn("transactions of {:.8} for {:.8} were dropped, the queue is full", block_hash.to_hex_string(),
+		               sig.signer().to_hex_string());
+	}
+}
+
+void Consensus::handle_transaction_response(const Signature &sig, const Proto::MessageData &msg)
+{
+	const auto &response = msg.transaction_response();
+	Hash block_hash;
+	try
+	{
+		block_hash = Hash::from_byte_string(response.block_hash());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("transaction response by {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+	auto it = m_pending_proposals.find(block_hash);
+	if (it == m_pending_proposals.end())
+	{
+		return;
+	}
+	auto &pending = it->second;
+
+	// the transactions are only requested from the leader, and anyone else could fill in transactions of its choice
+	if (sig.signer() != pending.signature.signer())
+	{
+		m_logger->warn("transactions of {:.8} from {:.8} were not requested from it", block_hash.to_hex_string(),
+		               sig.signer().to_hex_string());
+		return;
+	}
+
+	std::optional<Payload> transactions;
+	try
+	{
+		transactions.emplace(response.transactions());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("transactions of {:.8} from {:.8} are malformed: {}", block_hash.to_hex_string(),
+		               sig.signer().to_hex_string(), e.what());
+		return;
+	}
+
+	if (transactions->size() != (size_t)response.indexes_size())
+	{
+		m_logger->warn("transactions of {:.8} from {:.8} do not match their indexes", block_hash.to_hex_string(),
+		               sig.signer().to_hex_string());
+		return;
+	}
+
+	for (size_t i = 0; i < transactions->size(); i++)
+	{
+		const auto index = response.indexes((int)i);
+		if (index < pending.short_ids.size() && short_id((*transactions)[i].hash()) != pending.short_ids[index])
+		{
+			m_logger->warn("transactions of {:.8} from {:.8} do not match their short IDs", block_hash.to_hex_string(),
+			               sig.signer().to_hex_string());
+			return;
+		}
+	}
+
+	for (size_t i = 0; i < transactions->size(); i++)
+	{
+		const auto index = response.indexes((int)i);
+		if (index < pending.transactions.size() && !pending.transactions[index])
+		{
+			pending.transactions[index].emplace((*transactions)[i].data());
+			pending.missing--;
+		}
+	}
+
+	if (pending.missing == 0)
+	{
+		complete_proposal(block_hash);
+	}
+}
+
+void Consensus::complete_proposal(const Hash &block_hash)
+{
+	auto it = m_pending_proposals.find(block_hash);
+	auto &pending = it->second;
+
+	std::vector<Transaction> transactions;
+	transactions.reserve(pending.transactions.size());
+	for (auto &transaction : pending.transactions)
+	{
+		transactions.push_back(std::move(*transaction));
+	}
+
+	Block proposal{pending.parent, pending.certificate, pending.round, Payload{transactions}, pending.batches};
+	if (proposal.hash() != block_hash)
+	{
+		// a transaction in the mempool shares its short ID with a transaction of the block; the transactions are
+		// fetched once more in full
+		if (pending.refetched)
+		{
+			m_logger->warn("transactions of proposal {:.8} by {:.8} do not match its root", block_hash.to_hex_string(),
+			               pending.signature.signer().to_hex_string());
+			m_pending_proposals.erase(it);
+			return;
+		}
+
+		pending.refetched = true;
+		pending.missing = pending.transactions.size();
+		for (auto &transaction : pending.transactions)
+		{
+			transaction.reset();
+		}
+		request_transactions(block_hash, pending);
+		return;
+	}
+
+	const auto sig = pending.signature;
+	m_pending_proposals.erase(it);
+	process_proposal(sig, proposal);
+}
+
+void Consensus::request_transactions(const Hash &block_hash, const PendingProposal &pending)
+{
+	google::protobuf::Arena arena;
+	auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto request = msg->mutable_data()->mutable_transaction_request();
+	request->set_block_hash(block_hash.data(), block_hash.size());
+	for (size_t i = 0; i < pending.transactions.size(); i++)
+	{
+		if (!pending.transactions[i])
+		{
+			request->add_indexes((uint32_t)i);
+		}
+	}
 
+	auto sig = m_keystore->sign(msg->data().SerializeAsString());
+	sig.to_proto(msg->mutable_signature());
+
+	const auto &leader = pending.signature.signer();
+	if (!m_network->send_message(leader, *msg))
+	{
+		m_logger->warn("request for transactions of {:.8} was dropped, the queue to {:.8} is full",
+		               block_hash.to_hex_string(), leader.to_hex_string());
+	}
+}
+
+void Consensus::process_proposal(const Signature &sig, const Block &proposal)
+{
 	auto parent = m_blockchain->find(proposal.parent());
 	if (!parent)
 	{
@@ -90,13 +419,33 @@ void Consensus::handle_proposal(const Signature &sig, const Proto::MessageData &
 		return;
 	}
 
-	// check if the parent is certified
-	if (!Crypto::verify_certificate(proposal.certificate(), parent->to_proto().SerializeAsString(), *m_keystore))
+	// check if the parent is certified; votes are signatures over the block hash
+	if (!m_verifier->verify(proposal.certificate(), parent->hash().to_byte_string()))
 	{
 		m_logger->warn("proposal by {:.8} has invalid certificate", sig.signer().to_hex_string());
 		return;
 	}
 
+	if (!m_dissemination->verify_references(proposal.batches()))
+	{
+		m_logger->warn("proposal by {:.8} refers to batches that are not available", sig.signer().to_hex_string());
+		return;
+	}
+
+	if (!proposal.batches().empty())
+	{
+		const auto proposed = proposed_batches(proposal.parent());
+		for (const auto &batch : proposal.batches())
+		{
+			if (proposed.contains(batch.digest))
+			{
+				m_logger->warn("proposal by {:.8} refers to batch {:.8} that an ancestor refers to already",
+				               sig.signer().to_hex_string(), batch.digest.to_hex_string());
+				return;
+			}
+		}
+	}
+
 	m_lock = parent;
 	m_high_cert = BlockCertificate{proposal.certificate(), proposal.parent()};
 	m_blockchain->add(proposal);
@@ -113,6 +462,9 @@ void Consensus::handle_proposal(const Signature &sig, const Proto::MessageData &
 		m_logger->info("grandparent block with hash {:.8} was not found", parent->parent().to_hex_string());
 	}
 
+	// proposals only extend blocks above the lock, so other blocks below it are never needed again
+	m_blockchain->prune_forks(*m_lock);
+
 	if (m_next_vote_round > proposal.round())
 	{
 		m_logger->info("voting ended for round {}", proposal.round());
@@ -121,8 +473,16 @@ void Consensus::handle_proposal(const Signature &sig, const Proto::MessageData &
 
 	stop_voting(proposal.round());
 
-	auto vote = Crypto::sign(proposal.hash().to_byte_string(), *m_keystore->private_key());
-	auto vote_msg = make_vote(vote, proposal.hash());
+	auto vote = m_keystore->sign(proposal.hash().to_byte_string());
+	Schnorr::Share share;
+	if (m_settings.vote_certificates() == CertificateScheme::SCHNORR)
+	{
+		share = m_keystore->sign_share(proposal.hash().to_byte_string());
+	}
+
+	google::protobuf::Arena arena;
+	auto vote_msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	make_vote(vote_msg, vote, proposal, share);
 
 	auto all_nodes = m_network->connected_peers();
 	all_nodes.push_back(m_keystore->identity());
@@ -130,16 +490,29 @@ void Consensus::handle_proposal(const Signature &sig, const Proto::MessageData &
 
 	if (leader == m_keystore->identity())
 	{
-		handle_vote(vote, vote_msg.data());
+		handle_vote(vote, vote_msg->data());
 		return;
 	}
 
-	m_network->send_message(leader, vote_msg);
+	if (!m_network->send_message(leader, *vote_msg))
+	{
+		m_logger->warn("vote for {:.8} was dropped, the queue to leader {:.8} is full", proposal.hash().to_hex_string(),
+		               leader.to_hex_string());
+	}
 }
 
 void Consensus::handle_vote(const Signature &sig, const Proto::MessageData &msg)
 {
-	auto block_hash = Hash::from_byte_string(msg.vote().block_hash());
+	Hash block_hash;
+	try
+	{
+		block_hash = Hash::from_byte_string(msg.vote().block_hash());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("vote by {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
 	auto block = m_blockchain->find(block_hash);
 	if (block == nullptr)
 	{
@@ -156,16 +529,35 @@ void Consensus::handle_vote(const Signature &sig, const Proto::MessageData &msg)
 	}
 
 	auto &votes = m_votes[round];
-	votes.push_back(sig);
+	auto same_signer = [&](const Vote &vote) { return vote.signature.signer() == sig.signer(); };
+	if (std::any_of(votes.begin(), votes.end(), same_signer))
+	{
+		m_logger->debug("duplicate vote in round {} by {:.8}", round, sig.signer().to_hex_string());
+		return;
+	}
+
+	Schnorr::Share share;
+	if (m_settings.vote_certificates() == CertificateScheme::SCHNORR)
+	{
+		// shares are checked one by one here, so that an invalid share cannot spoil the aggregate
+		share.assign(msg.vote().share().begin(), msg.vote().share().end());
+		if (!m_keystore->verify_share(sig.signer(), share, block_hash.to_byte_string()))
+		{
+			m_logger->warn("vote in round {} by {:.8} has an invalid share", round, sig.signer().to_hex_string());
+			return;
+		}
+	}
+	votes.push_back({sig, std::move(share)});
 
 	if (votes.size() < quorum_size(m_network->size()))
 	{
 		return;
 	}
 
-	const Certificate cert(votes);
-	// clear votes so that we don't create the cert again if another vote shows up later
-	votes.clear();
+	// move the votes out so that we don't create the cert again if another vote shows up later
+	const auto cert = make_certificate(std::exchange(votes, {}), block_hash);
+	// the votes were verified on receipt, so the certificate is not verified again when it comes back in a proposal
+	m_verifier->add_verified(cert, block_hash.to_byte_string());
 
 	auto high_cert_block = m_blockchain->find(m_high_cert.block_hash);
 	if (high_cert_block == nullptr)
@@ -189,37 +581,109 @@ void Consensus::handle_vote(const Signature &sig, const Proto::MessageData &msg)
 	cleanup_votes(round + 1);
 }
 
-void Consensus::make_proposal()
+Certificate Consensus::make_certificate(std::vector<Vote> votes, const Hash &block_hash) const
 {
-	// TODO: get a payload from Mempool
-	const Block proposal{m_high_cert.block_hash, m_high_cert.certificate, m_synchronizer->round(), {}};
+	if (m_settings.vote_certificates() == CertificateScheme::ECDSA)
+	{
+		std::vector<Signature> signatures;
+		signatures.reserve(votes.size());
+		std::transform(votes.begin(), votes.end(), std::back_inserter(signatures),
+		               [](Vote &vote) { return vote.signature; });
+		return Certificate{std::move(signatures)};
+	}
 
-	Proto::Message msg;
-	auto msg_data_ptr = msg.mutable_data();
-	auto proposal_ptr = msg_data_ptr->mutable_proposal();
-	*proposal_ptr = proposal.to_proto();
+	std::sort(votes.begin(), votes.end(),
+	          [](const Vote &a, const Vote &b) { return a.signature.signer() < b.signature.signer(); });
 
-	auto sig = Crypto::sign(msg_data_ptr->SerializeAsString(), *m_keystore->private_key());
-	auto msg_sig_ptr = msg.mutable_signature();
-	*msg_sig_ptr = sig.to_proto();
+	std::vector<Identity> signers;
+	std::vector<Schnorr::Share> shares;
+	signers.reserve(votes.size());
+	shares.reserve(votes.size());
+	for (auto &vote : votes)
+	{
+		signers.push_back(vote.signature.signer());
+		shares.push_back(std::move(vote.share));
+	}
 
-	m_network->broadcast_message(msg);
-	handle_proposal(sig, *msg_data_ptr);
+	return m_keystore->aggregate(std::move(signers), shares, block_hash.to_byte_string());
 }
 
-void Consensus::cleanup_votes(Round min_round)
+void Consensus::make_proposal()
 {
-	for (auto it = m_votes.begin(); it != m_votes.end();)
+	// with batch dissemination, transactions reach the block through the batches it refers to
+	std::vector<Transaction> transactions;
+	if (!m_dissemination->enabled())
 	{
-		if (it->first < min_round)
+		// transactions stay in the mempool until they are committed, so those of the uncommitted ancestors of the
+		// proposal are left out
+		FlatMap<Hash, bool> proposed;
+		const auto committed_round = m_blockchain->committed_block()->round();
+		for (auto block = m_blockchain->find(m_high_cert.block_hash); block && block->round() > committed_round;
+		     block = m_blockchain->find(block->parent()))
 		{
-			m_votes.erase(it);
+			for (auto transaction : block->payload())
+			{
+				proposed.emplace(transaction.hash(), true);
+			}
 		}
-		else
+
+		transactions = m_mempool->take(m_settings.max_block_transactions(), m_settings.max_block_bytes(),
+		                               [&proposed](const Hash &hash) { return proposed.contains(hash); });
+	}
+
+	// certified batches stay available until a block that refers to them is committed, so those that the uncommitted
+	// ancestors of the proposal refer to are left out
+	std::vector<BatchReference> batches;
+	if (m_dissemination->enabled())
+	{
+		const auto proposed = proposed_batches(m_high_cert.block_hash);
+		batches =
+		    m_dissemination->select_certified([&proposed](const Hash &digest) { return proposed.contains(digest); });
+	}
+
+	const Block proposal{m_high_cert.block_hash, m_high_cert.certificate, m_synchronizer->round(),
+	                     Payload{transactions}, std::move(batches)};
+
+	google::protobuf::Arena arena;
+	auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto msg_data_ptr = msg->mutable_data();
+	if (m_settings.compact_proposals())
+	{
+		proposal.to_compact_proto(msg_data_ptr->mutable_proposal(), *m_keystore->validators());
+	}
+	else
+	{
+		proposal.to_proto(msg_data_ptr->mutable_proposal(), *m_keystore->validators());
+	}
+
+	auto sig = m_keystore->sign(msg_data_ptr->SerializeAsString());
+	sig.to_proto(msg->mutable_signature());
+
+	if (!m_network->broadcast_message(*msg))
+	{
+		m_logger->warn("proposal for round {} was dropped for peers whose queue is full", proposal.round());
+	}
+	process_proposal(sig, proposal);
+}
+
+FlatMap<Hash, bool> Consensus::proposed_batches(const Hash &block_hash) const
+{
+	FlatMap<Hash, bool> proposed;
+	const auto committed_round = m_blockchain->committed_block()->round();
+	for (auto block = m_blockchain->find(block_hash); block && block->round() > committed_round;
+	     block = m_blockchain->find(block->parent()))
+	{
+		for (const auto &batch : block->batches())
 		{
-			it++;
+			proposed.emplace(batch.digest, true);
 		}
 	}
+	return proposed;
+}
+
+void Consensus::cleanup_votes(Round min_round)
+{
+	m_votes.erase_if([min_round](const auto &entry) { return entry.first < min_round; });
 }
 
 void Consensus::stop_voting(Round round)
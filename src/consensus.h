@@ -3,9 +3,13 @@
 #include <spdlog/logger.h>
 
 #include "blockchain.h"
+#include "certificate_verifier.h"
+#include "dissemination.h"
 #include "event.h"
+#include "flat_map.h"
 #include "keystore.h"
 #include "leader_rotation.h"
+#include "mempool.h"
 #include "network.h"
 #include "synchronizer.h"
 
@@ -18,11 +22,37 @@ struct BlockCertificate
 	Hash block_hash;
 };
 
+// Vote is a vote for a block; share is only set if vote certificates are aggregated.
+struct Vote
+{
+	Signature signature;
+	Schnorr::Share share;
+};
+
+// PendingProposal is a compact proposal that waits for transactions which were not in the mempool.
+struct PendingProposal
+{
+	Signature signature;
+	Hash parent;
+	Certificate certificate;
+	Round round;
+	Hash root;
+	std::vector<BatchReference> batches;
+	std::vector<std::optional<Transaction>> transactions;
+	// short_ids holds the short ID of each transaction, against which fetched transactions are checked
+	std::vector<uint64_t> short_ids;
+	size_t missing;
+	// refetched is set once all transactions were requested because the rebuilt payload did not match the root
+	bool refetched;
+};
+
 class Consensus : public std::enable_shared_from_this<Consensus>
 {
   public:
 	Consensus(const Settings::Consensus &settings, const std::shared_ptr<EventQueue> &event_queue,
-	          const std::shared_ptr<Blockchain> &blockchain, const std::shared_ptr<Keystore> &keystore,
+	          const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Blockchain> &blockchain,
+	          const std::shared_ptr<Keystore> &keystore, const std::shared_ptr<CertificateVerifier> &verifier,
+	          const std::shared_ptr<Mempool> &mempool, const std::shared_ptr<Dissemination> &dissemination,
 	          const std::shared_ptr<Network> &network, const std::shared_ptr<Synchronizer> &synchronizer,
 	          const std::shared_ptr<LeaderRotation> &leader_rotation, const std::shared_ptr<spdlog::logger> &logger);
 
@@ -32,9 +62,20 @@ class Consensus : public std::enable_shared_from_this<Consensus>
   private:
 	void handle_message(const Signature &sig, const Proto::MessageData &msg);
 	void handle_proposal(const Signature &sig, const Proto::MessageData &msg);
+	void handle_compact_proposal(const Signature &sig, const Proto::MessageData &msg);
+	void handle_transaction_request(const Signature &sig, const Proto::MessageData &msg);
+	void handle_transaction_response(const Signature &sig, const Proto::MessageData &msg);
+	void process_proposal(const Signature &sig, const Block &proposal);
 	void handle_vote(const Signature &sig, const Proto::MessageData &msg);
+	Certificate make_certificate(std::vector<Vote> votes, const Hash &block_hash) const;
 
 	void make_proposal();
+	// proposed_batches returns the digests of the batches that the block and its uncommitted ancestors refer to
+	FlatMap<Hash, bool> proposed_batches(const Hash &block_hash) const;
+
+	// complete_proposal processes a pending proposal once it has all transactions
+	void complete_proposal(const Hash &block_hash);
+	void request_transactions(const Hash &block_hash, const PendingProposal &pending);
 
 	void stop_voting(Round round);
 	void cleanup_votes(Round min_round);
@@ -42,19 +83,25 @@ class Consensus : public std::enable_shared_from_this<Consensus>
 	Settings::Consensus m_settings;
 
 	std::shared_ptr<EventQueue> m_event_queue;
+	std::shared_ptr<Reactor> m_reactor;
 	std::shared_ptr<Blockchain> m_blockchain;
 	std::shared_ptr<Keystore> m_keystore;
+	std::shared_ptr<CertificateVerifier> m_verifier;
+	std::shared_ptr<Mempool> m_mempool;
+	std::shared_ptr<Dissemination> m_dissemination;
 	std::shared_ptr<Network> m_network;
 	std::shared_ptr<Synchronizer> m_synchronizer;
 	std::shared_ptr<LeaderRotation> m_leader_rotation;
 	std::shared_ptr<spdlog::logger> m_logger;
 
-	CppTime::Timer m_timer_manager;
+	Reactor::TimerId m_proposal_timer;
 
 	Round m_next_vote_round;
 	std::shared_ptr<Block> m_lock;
 	BlockCertificate m_high_cert;
-	std::unordered_map<Round, std::vector<Signature>> m_votes;
+	FlatMap<Round, std::vector<Vote>> m_votes;
+	// compact proposals that wait for transactions, by block hash
+	FlatMap<Hash, PendingProposal> m_pending_proposals;
 };
 
 } // namespace Quasar
@@ -0,0 +1,298 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <botan/ecdsa.h>
+#include <botan/system_rng.h>
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+#include "consensus.h"
+#include "round_duration.h"
+#include "testing/test_network.h"
+
+namespace
+{
+
+std::shared_ptr<Quasar::Keystore> make_keystore()
+{
+	return std::make_shared<Quasar::Keystore>(
+	    std::make_shared<Botan::ECDSA_PrivateKey>(Botan::system_rng(), Botan::EC_Group{"secp256r1"}));
+}
+
+// Fixture runs consensus on a replica, and lets the test send it messages from the leader or a third validator
+struct Fixture
+{
+	Fixture()
+	    : event_queue(std::make_shared<Quasar::EventQueue>()), reactor(std::make_shared<Quasar::Reactor>()),
+	      blockchain(std::make_shared<Quasar::Blockchain>()), mempool(std::make_shared<Quasar::ShardedMempool>()),
+	      keystore(make_keystore()), leader(make_keystore()), other(make_keystore()),
+	      verifier(std::make_shared<Quasar::CertificateVerifier>(keystore, settings.crypto())),
+	      test_network(std::make_shared<Quasar::TestNetwork>()), logger(spdlog::null_logger_mt("consensus_test"))
+	{
+		for (const auto &validator : {keystore, leader, other})
+		{
+			keystore->add_public_key(validator->identity(), validator->private_key());
+		}
+
+		auto network = test_network->create_node(keystore->identity());
+		test_network->create_node(leader->identity())->set_message_handler([this](auto msg) {
+			if (msg->data().has_transaction_request())
+			{
+				requests.push_back(msg);
+			}
+		});
+		test_network->create_node(other->identity());
+
+		synchronizer = std::make_shared<Quasar::Synchronizer>(
+		    Quasar::RoundDuration{settings.round_duration()}, event_queue, reactor, network, keystore, verifier, logger);
+		synchronizer->init();
+
+		auto dissemination = std::make_shared<Quasar::Dissemination>(settings.dissemination(), event_queue, reactor,
+		                                                             mempool, network, keystore, verifier, logger);
+		dissemination->init();
+
+		consensus = std::make_shared<Quasar::Consensus>(settings.consensus(), event_queue, reactor, blockchain,
+		                                                keystore, verifier, mempool, dissemination, network,
+		                                                synchronizer,
+		                                                std::make_shared<Quasar::RoundRobinLeaderRotation>(), logger);
+		consensus->init();
+	}
+
+	~Fixture()
+	{
+		spdlog::drop("consensus_test");
+	}
+
+	// deliver hands a message to the replica as if the pipeline had verified it
+	void deliver(const Quasar::Keystore &sender, const Quasar::MessagePtr &msg)
+	{
+		event_queue->dispatch(Quasar::MessageEvent{sender.sign(msg->data().SerializeAsString()),
+		                                           Quasar::MessageDataPtr{msg, &msg->data()}});
+	}
+
+	Quasar::Settings settings;
+	std::shared_ptr<Quasar::EventQueue> event_queue;
+	std::shared_ptr<Quasar::Reactor> reactor;
+	std::shared_ptr<Quasar::Blockchain> blockchain;
+	std::shared_ptr<Quasar::Mempool> mempool;
+	std::shared_ptr<Quasar::Keystore> keystore;
+	std::shared_ptr<Quasar::Keystore> leader;
+	std::shared_ptr<Quasar::Keystore> other;
+	std::shared_ptr<Quasar::CertificateVerifier> verifier;
+	std::shared_ptr<Quasar::TestNetwork> test_network;
+	std::shared_ptr<spdlog::logger> logger;
+	std::shared_ptr<Quasar::Synchronizer> synchronizer;
+	std::shared_ptr<Quasar::Consensus> consensus;
+	// requests holds the transaction requests that the leader received
+	std::vector<Quasar::MessagePtr> requests;
+};
+
+Quasar::Block make_block(const Quasar::Block &parent, Quasar::Round round)
+{
+	std::vector<Quasar::Transaction> transactions;
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		transactions.emplace_back(std::vector<std::byte>{std::byte(round), std::byte(i)});
+	}
+	return Quasar::Block{parent.hash(), Quasar::GENESIS_CERT, round, Quasar::Payload{transactions}};
+}
+
+// make_certified_block makes a block whose parent carries a certificate from all validators, so that a replica that
+// has only seen the parent accepts it
+Quasar::Block make_certified_block(const Fixture &fixture, const Quasar::Block &parent, Quasar::Round round)
+{
+	const auto message = parent.hash().to_byte_string();
+	const Quasar::Certificate certificate{
+	    {fixture.keystore->sign(message), fixture.leader->sign(message), fixture.other->sign(message)}};
+
+	std::vector<Quasar::Transaction> transactions;
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		transactions.emplace_back(std::vector<std::byte>{std::byte(round), std::byte(i)});
+	}
+	return Quasar::Block{parent.hash(), certificate, round, Quasar::Payload{transactions}};
+}
+
+Quasar::MessagePtr make_response(const Quasar::Block &block, const std::vector<Quasar::Transaction> &transactions)
+{
+	auto msg = Quasar::make_message();
+	auto response = msg->mutable_data()->mutable_transaction_response();
+	const auto hash = block.hash();
+	response->set_block_hash(hash.data(), hash.size());
+	for (uint32_t i = 0; i < transactions.size(); i++)
+	{
+		response->add_indexes(i);
+	}
+	Quasar::Payload{transactions}.to_proto(response->mutable_transactions());
+	return msg;
+}
+
+std::vector<Quasar::Transaction> transactions_of(const Quasar::Block &block)
+{
+	std::vector<Quasar::Transaction> transactions;
+	for (auto transaction : block.payload())
+	{
+		transactions.emplace_back(transaction);
+	}
+	return transactions;
+}
+
+} // namespace
+
+TEST_CASE("Consensus drops proposals with a malformed certificate", "[consensus]")
+{
+	Fixture fixture;
+	const auto validators = fixture.keystore->validators();
+	const auto block = make_block(Quasar::GENESIS, 1);
+
+	// the bitmap has a bit set beyond the validator set
+	auto msg = Quasar::make_message();
+	block.to_proto(msg->mutable_data()->mutable_proposal(), *validators);
+	msg->mutable_data()->mutable_proposal()->mutable_certificate()->set_signers(std::string(1, '\xFF'));
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, msg));
+
+	auto compact = Quasar::make_message();
+	block.to_compact_proto(compact->mutable_data()->mutable_proposal(), *validators);
+	compact->mutable_data()->mutable_proposal()->mutable_certificate()->set_signers(std::string(1, '\xFF'));
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, compact));
+
+	REQUIRE(fixture.blockchain->find(block.hash()) == nullptr);
+}
+
+TEST_CASE("Synchronizer drops timeout certificates with a malformed certificate", "[consensus]")
+{
+	Fixture fixture;
+
+	auto msg = Quasar::make_message();
+	auto advance = msg->mutable_data()->mutable_advance();
+	advance->mutable_wish()->set_round(5);
+	advance->mutable_certificate()->set_signers(std::string(1, '\xFF'));
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, msg));
+
+	REQUIRE(fixture.synchronizer->round() < 5);
+}
+
+TEST_CASE("Synchronizer counts the wishes of a validator once", "[consensus]")
+{
+	Fixture fixture;
+
+	auto msg = Quasar::make_message();
+	msg->mutable_data()->mutable_wish()->set_round(5);
+
+	// each delivery signs the wish anew, so the copies of the leader's wish carry different signatures
+	fixture.deliver(*fixture.leader, msg);
+	fixture.deliver(*fixture.leader, msg);
+	fixture.deliver(*fixture.other, msg);
+	REQUIRE(fixture.synchronizer->round() < 5);
+
+	fixture.deliver(*fixture.keystore, msg);
+	REQUIRE(fixture.synchronizer->round() == 5);
+}
+
+TEST_CASE("Consensus drops proposals whose payload offsets are out of bounds", "[consensus]")
+{
+	Fixture fixture;
+	const auto block = make_block(Quasar::GENESIS, 1);
+
+	// the last transaction ends beyond the data of the payload
+	auto msg = Quasar::make_message();
+	block.to_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	msg->mutable_data()->mutable_proposal()->mutable_payload()->add_offsets(1024);
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, msg));
+
+	REQUIRE(fixture.blockchain->find(block.hash()) == nullptr);
+}
+
+TEST_CASE("Consensus drops proposals and votes with an oversized hash", "[consensus]")
+{
+	Fixture fixture;
+	const auto block = make_block(Quasar::GENESIS, 1);
+	const auto oversized = block.parent().to_byte_string() + "x";
+
+	auto msg = Quasar::make_message();
+	block.to_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	msg->mutable_data()->mutable_proposal()->set_parent(oversized);
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, msg));
+
+	auto compact = Quasar::make_message();
+	block.to_compact_proto(compact->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	compact->mutable_data()->mutable_proposal()->set_parent(oversized);
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.leader, compact));
+
+	auto vote = Quasar::make_message();
+	vote->mutable_data()->mutable_vote()->set_block_hash(oversized);
+	REQUIRE_NOTHROW(fixture.deliver(*fixture.other, vote));
+
+	REQUIRE(fixture.blockchain->find(block.hash()) == nullptr);
+}
+
+TEST_CASE("Consensus fills in the transactions of a compact proposal only from its leader", "[consensus]")
+{
+	Fixture fixture;
+	const auto parent = make_block(Quasar::GENESIS, 1);
+	fixture.blockchain->add(parent);
+	const auto block = make_certified_block(fixture, parent, 2);
+
+	// the replica has none of the transactions, so it requests them from the leader
+	auto msg = Quasar::make_message();
+	block.to_compact_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	fixture.deliver(*fixture.leader, msg);
+	fixture.test_network->run_for(16);
+	REQUIRE(fixture.requests.size() == 1);
+
+	fixture.deliver(*fixture.other, make_response(block, transactions_of(block)));
+	REQUIRE(fixture.blockchain->find(block.hash()) == nullptr);
+
+	fixture.deliver(*fixture.leader, make_response(block, transactions_of(block)));
+	REQUIRE(fixture.blockchain->find(block.hash()) != nullptr);
+}
+
+TEST_CASE("Consensus rejects fetched transactions that do not match their short IDs", "[consensus]")
+{
+	Fixture fixture;
+	const auto parent = make_block(Quasar::GENESIS, 1);
+	fixture.blockchain->add(parent);
+	const auto block = make_certified_block(fixture, parent, 2);
+
+	auto msg = Quasar::make_message();
+	block.to_compact_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	fixture.deliver(*fixture.leader, msg);
+
+	// were they accepted, the rebuilt payload would not match the root twice and the proposal would be given up
+	auto forged = transactions_of(block);
+	forged[0] = Quasar::Transaction{std::vector<std::byte>{std::byte{0xFF}}};
+	fixture.deliver(*fixture.leader, make_response(block, forged));
+	fixture.deliver(*fixture.leader, make_response(block, forged));
+	REQUIRE(fixture.blockchain->find(block.hash()) == nullptr);
+
+	fixture.deliver(*fixture.leader, make_response(block, transactions_of(block)));
+	REQUIRE(fixture.blockchain->find(block.hash()) != nullptr);
+}
+
+TEST_CASE("Consensus bounds the compact proposals of a signer that wait for transactions", "[consensus]")
+{
+	Fixture fixture;
+	const auto parent = make_block(Quasar::GENESIS, 1);
+	fixture.blockchain->add(parent);
+
+	// proposals for rounds far ahead are not cleaned up by the rounds passing
+	for (Quasar::Round round = 1000; round < 1010; round++)
+	{
+		auto msg = Quasar::make_message();
+		make_certified_block(fixture, parent, round)
+		    .to_compact_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+		fixture.deliver(*fixture.leader, msg);
+	}
+	fixture.test_network->run_for(16);
+	REQUIRE(fixture.requests.size() == 4);
+
+	// a proposal for a lower round takes the place of the highest one
+	const auto block = make_certified_block(fixture, parent, 2);
+	auto msg = Quasar::make_message();
+	block.to_compact_proto(msg->mutable_data()->mutable_proposal(), *fixture.keystore->validators());
+	fixture.deliver(*fixture.leader, msg);
+	fixture.test_network->run_for(16);
+	REQUIRE(fixture.requests.size() == 5);
+
+	fixture.deliver(*fixture.leader, make_response(block, transactions_of(block)));
+	REQUIRE(fixture.blockchain->find(block.hash()) != nullptr);
+}
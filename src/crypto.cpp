@@ -2,15 +2,39 @@
 #include <utility>
 
 #include "crypto.h"
-#include "exception.h"
+#include "sha256.h"
 
 namespace Quasar::Crypto
 {
 
+Botan::HashFunction &hasher()
+{
+	thread_local auto hash_fn = Botan::HashFunction::create_or_throw("SHA-256");
+	return *hash_fn;
+}
+
+Hash hash(std::span<const byte> data)
+{
+	Hash hash{};
+	auto &hash_fn = hasher();
+	hash_fn.update((const uint8_t *)data.data(), data.size());
+	hash_fn.final(hash.data());
+	return hash;
+}
+
+void hash_batch(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs)
+{
+	Sha256::hash_many(inputs, outputs);
+}
+
 Signature sign(const std::string &message, const Botan::Private_Key &private_key)
 {
-	// EMSA1 does not add any padding. Deprecated in Botan version 3.
-	auto signer = Botan::PK_Signer(private_key, Botan::system_rng(), "EMSA1(SHA-256)");
+	auto signer = Botan::PK_Signer(private_key, Botan::system_rng(), SIGNATURE_PADDING);
+	return sign(message, signer, hash(private_key.public_key_bits()));
+}
+
+Signature sign(const std::string &message, Botan::PK_Signer &signer, const Identity &identity)
+{
 	signer.update(message);
 	auto signature = signer.signature(Botan::system_rng());
 	assert(signature.size() == SIGNATURE_LENGTH);
@@ -18,27 +42,42 @@ Signature sign(const std::string &message, const Botan::Private_Key &private_key
 	std::array<uint8_t, SIGNATURE_LENGTH> signature_arr{};
 	std::copy(signature.begin(), signature.begin() + SIGNATURE_LENGTH, signature_arr.begin());
 
-	return Signature{signature_arr, (Identity)hash(private_key.public_key_bits())};
+	return Signature{signature_arr, identity};
+}
+
+std::string signed_bytes(const Proto::MessageData &data)
+{
+	if (data.has_vote())
+	{
+		return data.vote().block_hash();
+	}
+	if (data.has_batch_ack())
+	{
+		// acknowledgements form the certificate of a batch, which is verified against its digest
+		return data.batch_ack().digest();
+	}
+	if (data.has_wish())
+	{
+		return data.wish().SerializeAsString();
+	}
+	return data.SerializeAsString();
 }
 
 bool verify(const Signature &signature, const std::string &message, const Botan::Public_Key &key)
 {
-	auto verifier = Botan::PK_Verifier(key, "EMSA1(SHA-256)");
+	auto verifier = Botan::PK_Verifier(key, SIGNATURE_PADDING);
+	return verify(signature, message, verifier);
+}
+
+bool verify(const Signature &signature, const std::string &message, Botan::PK_Verifier &verifier)
+{
 	verifier.update(message);
 	return verifier.check_signature(signature.data().begin(), signature.data().size());
 }
 
 bool verify_certificate(const Certificate &cert, const std::string &message, const Keystore &keystore)
 {
-	return std::ranges::all_of(cert.signatures(), [&](auto &sig) {
-		auto key = keystore.find_public_key(sig.signer());
-		if (key == nullptr)
-		{
-			throw QUASAR_EXCEPTION_KIND(Exception::Kind::NOT_FOUND, "public key for identity {:.8} not found",
-			                            sig.signer().to_hex_string());
-		}
-		return verify(sig, message, *key);
-	});
+	return std::ranges::all_of(cert.signatures(), [&](auto &sig) { return keystore.verify(sig, message); });
 }
 
 } // namespace Quasar::Crypto
\ No newline at end of file
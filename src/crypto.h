@@ -10,19 +10,39 @@
 namespace Quasar::Crypto
 {
 
-template <typename T> Hash hash(T data)
+// hasher returns a SHA-256 hash function owned by the calling thread, so that it is not recreated on every call.
+Botan::HashFunction &hasher();
+
+template <typename T> Hash hash(const T &data)
 {
 	Hash hash{};
-	auto hash_fn = Botan::HashFunction::create("SHA-256");
-	assert(hash_fn != nullptr);
-	hash_fn->update(data);
-	hash_fn->final(hash.data());
+	auto &hash_fn = hasher();
+	hash_fn.update(data);
+	hash_fn.final(hash.data());
 	return hash;
 }
 
+Hash hash(std::span<const byte> data);
+
+// hash_batch computes the hash of each input and stores it in the output at the same index.
+// It is considerably faster than hashing the inputs one by one when there are many small inputs.
+void hash_batch(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs);
+
+// EMSA1 does not add any padding. Deprecated in Botan version 3.
+const std::string SIGNATURE_PADDING = "EMSA1(SHA-256)";
+
+// signed_bytes returns the bytes that the signature of a message covers. Votes, wishes and batch acknowledgements are
+// signed over the block hash, the wish and the batch digest alone, so that their signatures can be collected into
+// certificates.
+std::string signed_bytes(const Proto::MessageData &data);
+
 bool verify(const Signature &signature, const std::string &message, const Botan::Public_Key &key);
+bool verify(const Signature &signature, const std::string &message, Botan::PK_Verifier &verifier);
 bool verify_certificate(const Certificate &cert, const std::string &message, const Keystore &keystore);
 
+// The overloads taking a signer or verifier reuse it, which avoids setting up the key for each message.
+// Prefer Keystore::sign and Keystore::verify, which keep these objects for every known key.
 Signature sign(const std::string &message, const Botan::Private_Key &key);
+Signature sign(const std::string &message, Botan::PK_Signer &signer, const Identity &identity);
 
 } // namespace Quasar::Crypto
@@ -0,0 +1,95 @@
+#include <algorithm>
+
+#include "digest_cache.h"
+
+namespace Quasar
+{
+
+DigestCache::DigestCache(size_t capacity) : m_head(NONE), m_tail(NONE), m_capacity(std::max<size_t>(1, capacity))
+{
+	m_nodes.reserve(m_capacity);
+	m_index.reserve(m_capacity);
+}
+
+bool DigestCache::contains(const Hash &digest)
+{
+	std::lock_guard lock{m_mutex};
+	auto it = m_index.find(digest);
+	if (it == m_index.end())
+	{
+		return false;
+	}
+
+	unlink(it->second);
+	push_front(it->second);
+	return true;
+}
+
+bool DigestCache::insert(const Hash &digest)
+{
+	std::lock_guard lock{m_mutex};
+	auto it = m_index.find(digest);
+	if (it != m_index.end())
+	{
+		unlink(it->second);
+		push_front(it->second);
+		return false;
+	}
+
+	uint32_t index;
+	if (m_nodes.size() < m_capacity)
+	{
+		index = (uint32_t)m_nodes.size();
+		m_nodes.push_back({digest, NONE, NONE});
+	}
+	else
+	{
+		// reuse the node of the least recently used digest
+		index = m_tail;
+		unlink(index);
+		m_index.erase(m_nodes[index].digest);
+		m_nodes[index].digest = digest;
+	}
+
+	push_front(index);
+	m_index.emplace(digest, index);
+	return true;
+}
+
+size_t DigestCache::size() const
+{
+	std::lock_guard lock{m_mutex};
+	return m_index.size();
+}
+
+size_t DigestCache::capacity() const
+{
+	return m_capacity;
+}
+
+void DigestCache::unlink(uint32_t index)
+{
+	auto &node = m_nodes[index];
+	(node.prev == NONE ? m_head : m_nodes[node.prev].next) = node.next;
+	(node.next == NONE ? m_tail : m_nodes[node.next].prev) = node.prev;
+	node.prev = NONE;
+	node.next = NONE;
+}
+
+void DigestCache::push_front(uint32_t index)
+{
+	auto &node = m_nodes[index];
+	node.prev = NONE;
+	node.next = m_head;
+	if (m_head != NONE)
+	{
+		m_nodes[m_head].prev = index;
+	}
+	m_head = index;
+	if (m_tail == NONE)
+	{
+		m_tail = index;
+	}
+}
+
+} // namespace Quasar
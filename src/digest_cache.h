@@ -0,0 +1,50 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "flat_map.h"
+#include "types.h"
+
+namespace Quasar
+{
+
+// DigestCache is a bounded set of digests. When it is full, inserting a digest evicts the least recently used one.
+// All methods are thread-safe.
+class DigestCache
+{
+  public:
+	explicit DigestCache(size_t capacity);
+
+	// contains returns whether the digest is in the cache, and marks it as recently used if it is
+	bool contains(const Hash &digest);
+
+	// insert adds the digest to the cache, and returns false if it was already present
+	bool insert(const Hash &digest);
+
+	size_t size() const;
+	size_t capacity() const;
+
+  private:
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	struct Node
+	{
+		Hash digest;
+		uint32_t prev;
+		uint32_t next;
+	};
+
+	void unlink(uint32_t index);
+	void push_front(uint32_t index);
+
+	mutable std::mutex m_mutex;
+	// nodes form a doubly linked list from the most recently used digest at head to the least recently used at tail
+	std::vector<Node> m_nodes;
+	FlatMap<Hash, uint32_t> m_index;
+	uint32_t m_head;
+	uint32_t m_tail;
+	size_t m_capacity;
+};
+
+} // namespace Quasar
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "digest_cache.h"
+
+namespace
+{
+
+Quasar::Hash make_digest(uint8_t value)
+{
+	Quasar::Hash digest{};
+	digest[0] = value;
+	return digest;
+}
+
+} // namespace
+
+TEST_CASE("DigestCache remembers inserted digests", "[digest_cache]")
+{
+	Quasar::DigestCache cache{4};
+
+	REQUIRE(!cache.contains(make_digest(1)));
+	REQUIRE(cache.insert(make_digest(1)));
+	REQUIRE(!cache.insert(make_digest(1)));
+	REQUIRE(cache.contains(make_digest(1)));
+	REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("DigestCache evicts the least recently used digest", "[digest_cache]")
+{
+	Quasar::DigestCache cache{3};
+
+	for (uint8_t i = 1; i <= 3; i++)
+	{
+		REQUIRE(cache.insert(make_digest(i)));
+	}
+
+	// a lookup refreshes digest 1, so digest 2 is the oldest
+	REQUIRE(cache.contains(make_digest(1)));
+	REQUIRE(cache.insert(make_digest(4)));
+
+	REQUIRE(cache.size() == 3);
+	REQUIRE(cache.contains(make_digest(1)));
+	REQUIRE(!cache.contains(make_digest(2)));
+	REQUIRE(cache.contains(make_digest(3)));
+	REQUIRE(cache.contains(make_digest(4)));
+
+	for (uint8_t i = 5; i < 100; i++)
+	{
+		REQUIRE(cache.insert(make_digest(i)));
+		REQUIRE(cache.size() == 3);
+	}
+	REQUIRE(cache.contains(make_digest(99)));
+	REQUIRE(!cache.contains(make_digest(1)));
+}
@@ -0,0 +1,392 @@
+#include <google/protobuf/arena.h>
+#include <algorithm>
+
+#include "dissemination.h"
+#include "exception.h"
+#include "quorum.h"
+
+namespace Quasar
+{
+
+namespace
+{
+
+// batches that blocks referred to are remembered for about as long as their certificates may still be relayed
+const size_t REFERENCED_CAPACITY = 1 << 16;
+
+} // namespace
+
+Dissemination::Dissemination(const Settings::Dissemination &settings, const std::shared_ptr<EventQueue> &event_queue,
+                             const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Mempool> &mempool,
+                             const std::shared_ptr<Network> &network, const std::shared_ptr<Keystore> &keystore,
+                             const std::shared_ptr<CertificateVerifier> &verifier,
+                             const std::shared_ptr<spdlog::logger> &logger)
+    : m_settings(settings), m_event_queue(event_queue), m_reactor(reactor), m_mempool(mempool), m_network(network),
+      m_keystore(keystore), m_verifier(verifier), m_logger(logger), m_interval(0), m_referenced(REFERENCED_CAPACITY),
+      m_stats()
+{
+}
+
+void Dissemination::init()
+{
+	m_event_queue->append_listener<MessageEvent>(
+	    [self = shared_from_this()](const MessageEvent &event) { self->handle_message(event.signature, *event.data); });
+
+	if (m_settings.enabled())
+	{
+		start_batch_timer();
+	}
+}
+
+bool Dissemination::enabled() const
+{
+	return m_settings.enabled();
+}
+
+std::vector<BatchReference> Dissemination::select_certified(const Mempool::Exclude &exclude)
+{
+	std::vector<BatchReference> batches;
+	for (auto it = m_certified_order.begin();
+	     batches.size() < m_settings.max_block_batches() && it != m_certified_order.end();)
+	{
+		// the batch may have been referred to by a committed block of another leader in the meantime
+		auto certified = m_certified.find(*it);
+		if (certified == m_certified.end())
+		{
+			it = m_certified_order.erase(it);
+			continue;
+		}
+		if (!exclude || !exclude(*it))
+		{
+			batches.push_back({*it, certified->second});
+		}
+		++it;
+	}
+	return batches;
+}
+
+bool Dissemination::verify_references(const std::vector<BatchReference> &batches)
+{
+	const auto quorum = (size_t)quorum_size(m_network->size());
+	for (const auto &batch : batches)
+	{
+		if (m_referenced.contains(batch.digest))
+		{
+			m_logger->warn("batch {:.8} is referred to by a committed block already", batch.digest.to_hex_string());
+			return false;
+		}
+		if (batch.certificate.signers().size() < quorum)
+		{
+			m_logger->warn("batch {:.8} is acknowledged by {} validators, but a quorum is {}",
+			               batch.digest.to_hex_string(), batch.certificate.signers().size(), quorum);
+			return false;
+		}
+		if (!m_verifier->verify(batch.certificate, batch.digest.to_byte_string()))
+		{
+			m_logger->warn("batch {:.8} has an invalid certificate", batch.digest.to_hex_string());
+			return false;
+		}
+	}
+	return true;
+}
+
+void Dissemination::commit(const Block &block)
+{
+	for (const auto &batch : block.batches())
+	{
+		if (!m_referenced.insert(batch.digest))
+		{
+			continue;
+		}
+		m_certified.erase(batch.digest);
+		m_stats.referenced++;
+
+		// the transactions are on the chain from now on, so copies that clients sent to this replica as well are not
+		// sealed again
+		if (auto transactions = find(batch.digest))
+		{
+			m_mempool->remove(*transactions);
+		}
+		if (m_unreferenced.contains(batch.digest))
+		{
+			release(batch.digest);
+		}
+	}
+}
+
+const Payload *Dissemination::find(const Hash &digest) const
+{
+	auto it = m_batches.find(digest);
+	return it != m_batches.end() ? &it->second : nullptr;
+}
+
+Dissemination::Stats Dissemination::stats() const
+{
+	return m_stats;
+}
+
+void Dissemination::handle_message(const Signature &sig, const Proto::MessageData &msg)
+{
+	if (msg.has_batch())
+	{
+		handle_batch(sig, msg);
+	}
+	else if (msg.has_batch_ack())
+	{
+		handle_batch_ack(sig, msg);
+	}
+	else if (msg.has_batch_certificate())
+	{
+		handle_batch_certificate(sig, msg);
+	}
+}
+
+void Dissemination::handle_batch(const Signature &sig, const Proto::MessageData &msg)
+{
+	std::optional<Payload> transactions;
+	try
+	{
+		transactions.emplace(msg.batch().transactions());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("batch from {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+
+	const auto digest = batch_digest(sig.signer(), transactions->root());
+	store_batch(digest, std::move(*transactions));
+
+	google::protobuf::Arena arena;
+	auto ack_msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	ack_msg->mutable_data()->mutable_batch_ack()->set_digest(digest.data(), digest.size());
+
+	auto ack_sig = m_keystore->sign(digest.to_byte_string());
+	ack_sig.to_proto(ack_msg->mutable_signature());
+
+	if (!m_network->send_message(sig.signer(), *ack_msg))
+	{
+		m_logger->warn("acknowledgement of batch {:.8} was dropped, the queue to {:.8} is full",
+		               digest.to_hex_string(), sig.signer().to_hex_string());
+	}
+}
+
+void Dissemination::handle_batch_ack(const Signature &sig, const Proto::MessageData &msg)
+{
+	Hash digest;
+	try
+	{
+		digest = Hash::from_byte_string(msg.batch_ack().digest());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("acknowledgement from {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+	auto it = m_acks.find(digest);
+	if (it == m_acks.end())
+	{
+		// the batch is certified already, or it is not ours
+		return;
+	}
+
+	auto &acks = it->second;
+	auto same_signer = [&](const Signature &ack) { return ack.signer() == sig.signer(); };
+	if (std::any_of(acks.begin(), acks.end(), same_signer))
+	{
+		return;
+	}
+	acks.push_back(sig);
+
+	if (acks.size() >= quorum_size(m_network->size()))
+	{
+		certify(digest);
+	}
+}
+
+void Dissemination::certify(const Hash &digest)
+{
+	auto it = m_acks.find(digest);
+	const Certificate cert{std::move(it->second)};
+	m_acks.erase(it);
+	// the acknowledgements were verified on receipt
+	m_verifier->add_verified(cert, digest.to_byte_string());
+
+	google::protobuf::Arena arena;
+	auto cert_msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto reference = cert_msg->mutable_data()->mutable_batch_certificate();
+	reference->set_digest(digest.data(), digest.size());
+	cert.to_proto(reference->mutable_certificate(), *m_keystore->validators());
+
+	auto cert_sig = m_keystore->sign(cert_msg->data().SerializeAsString());
+	cert_sig.to_proto(cert_msg->mutable_signature());
+
+	if (!m_network->broadcast_message(*cert_msg))
+	{
+		m_logger->warn("certificate of batch {:.8} was dropped for peers whose queue is full", digest.to_hex_string());
+	}
+	add_certified(digest, cert);
+}
+
+void Dissemination::handle_batch_certificate(const Signature &sig, const Proto::MessageData &msg)
+{
+	const auto &reference = msg.batch_certificate();
+	std::optional<BatchReference> decoded;
+	try
+	{
+		decoded = BatchReference{Hash::from_byte_string(reference.digest()),
+		                         Certificate{reference.certificate(), *m_keystore->validators()}};
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("certificate of a batch from {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
+	auto &batch = *decoded;
+	if (m_certified.contains(batch.digest) || m_referenced.contains(batch.digest))
+	{
+		return;
+	}
+
+	const auto quorum = (size_t)quorum_size(m_network->size());
+	if (batch.certificate.signers().size() < quorum ||
+	    !m_verifier->verify(batch.certificate, batch.digest.to_byte_string()))
+	{
+		m_logger->warn("certificate of batch {:.8} from {:.8} is invalid", batch.digest.to_hex_string(),
+		               sig.signer().to_hex_string());
+		return;
+	}
+
+	add_certified(batch.digest, std::move(batch.certificate));
+}
+
+void Dissemination::start_batch_timer()
+{
+	const auto deadline = Reactor::Clock::now() + m_settings.batch_interval();
+	m_reactor->add_timer(deadline, [self = shared_from_this()] {
+		self->prune_batches();
+		self->seal_batches();
+		self->start_batch_timer();
+	});
+}
+
+void Dissemination::seal_batches()
+{
+	while (true)
+	{
+		const Payload transactions{m_mempool->take(m_settings.batch_transactions(), m_settings.batch_bytes(),
+		                                           [this](const Hash &hash) { return m_sealed.contains(hash); })};
+		if (transactions.empty())
+		{
+			return;
+		}
+
+		// the transactions stay in the mempool until a committed block refers to the batch, so that they are not lost
+		// if no quorum acknowledges it or the block is abandoned
+		const auto digest = batch_digest(m_keystore->identity(), transactions.root());
+		m_unreferenced.emplace(digest, true);
+		for (auto transaction : transactions)
+		{
+			m_sealed.emplace(transaction.hash(), true);
+		}
+
+		google::protobuf::Arena arena;
+		auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+		auto msg_data_ptr = msg->mutable_data();
+		transactions.to_proto(msg_data_ptr->mutable_batch()->mutable_transactions());
+
+		auto sig = m_keystore->sign(msg_data_ptr->SerializeAsString());
+		sig.to_proto(msg->mutable_signature());
+
+		if (!m_network->broadcast_message(*msg))
+		{
+			m_logger->warn("batch {:.8} was dropped for peers whose queue is full", digest.to_hex_string());
+		}
+		m_stats.sealed++;
+
+		// the author stores its own batch and acknowledges it like any other replica
+		store_batch(digest, transactions);
+		auto &acks = m_acks[digest];
+		if (acks.empty())
+		{
+			acks.push_back(m_keystore->sign(digest.to_byte_string()));
+		}
+		if (acks.size() >= quorum_size(m_network->size()))
+		{
+			certify(digest);
+		}
+	}
+}
+
+void Dissemination::prune_batches()
+{
+	m_interval++;
+
+	size_t pruned = 0;
+	while (!m_stored_order.empty() && m_stored_order.front().first + m_settings.batch_retention() <= m_interval)
+	{
+		const auto digest = m_stored_order.front().second;
+		m_stored_order.pop_front();
+
+		if (m_unreferenced.contains(digest))
+		{
+			if (!m_acks.contains(digest))
+			{
+				// a certified batch is kept until a committed block refers to it, as its transactions are in no other
+				// batch
+				m_stored_order.emplace_back(m_interval, digest);
+				continue;
+			}
+
+			m_logger->debug("batch {:.8} was not acknowledged by a quorum in time", digest.to_hex_string());
+			release(digest);
+			m_stats.expired++;
+		}
+
+		m_batches.erase(digest);
+		pruned++;
+	}
+
+	if (pruned > 0)
+	{
+		m_batches.shrink();
+		m_stats.pruned += pruned;
+	}
+}
+
+void Dissemination::store_batch(const Hash &digest, Payload transactions)
+{
+	if (m_batches.emplace(digest, std::move(transactions)).second)
+	{
+		m_stored_order.emplace_back(m_interval, digest);
+		m_stats.stored++;
+	}
+}
+
+void Dissemination::release(const Hash &digest)
+{
+	m_unreferenced.erase(digest);
+	m_acks.erase(digest);
+
+	auto it = m_batches.find(digest);
+	if (it == m_batches.end())
+	{
+		return;
+	}
+	for (auto transaction : it->second)
+	{
+		m_sealed.erase(transaction.hash());
+	}
+	m_sealed.shrink();
+}
+
+void Dissemination::add_certified(const Hash &digest, Certificate certificate)
+{
+	if (m_certified.emplace(digest, std::move(certificate)).second)
+	{
+		m_certified_order.push_back(digest);
+		m_stats.certified++;
+	}
+}
+
+} // namespace Quasar
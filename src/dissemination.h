@@ -0,0 +1,117 @@
+#pragma once
+
+#include <spdlog/logger.h>
+
+#include <deque>
+
+#include "certificate_verifier.h"
+#include "digest_cache.h"
+#include "event.h"
+#include "flat_map.h"
+#include "keystore.h"
+#include "mempool.h"
+#include "network.h"
+#include "reactor.h"
+#include "settings.h"
+
+namespace Quasar
+{
+
+// Dissemination spreads transactions independently of the leader. Every replica seals the transactions in its mempool
+// into batches and broadcasts them, and replicas acknowledge each batch that they stored. Once a quorum acknowledged a
+// batch, it is available and its author broadcasts the certificate formed by the acknowledgements. Proposals refer to
+// certified batches by their digests, so the bandwidth to spread transactions grows with the number of replicas.
+class Dissemination : public std::enable_shared_from_this<Dissemination>
+{
+  public:
+	struct Stats
+	{
+		uint64_t sealed;
+		uint64_t stored;
+		uint64_t certified;
+		uint64_t referenced;
+		// expired counts own batches that no quorum acknowledged in time, and pruned the batches that were dropped
+		uint64_t expired;
+		uint64_t pruned;
+	};
+
+	Dissemination(const Settings::Dissemination &settings, const std::shared_ptr<EventQueue> &event_queue,
+	              const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Mempool> &mempool,
+	              const std::shared_ptr<Network> &network, const std::shared_ptr<Keystore> &keystore,
+	              const std::shared_ptr<CertificateVerifier> &verifier, const std::shared_ptr<spdlog::logger> &logger);
+
+	// init sets up event handlers and starts sealing batches if dissemination is enabled
+	void init();
+
+	bool enabled() const;
+
+	// select_certified returns certified batches that no committed block refers to and that are not excluded, oldest
+	// first, up to the limit of a block; they stay certified, so that they are proposed again if the block is abandoned
+	std::vector<BatchReference> select_certified(const Mempool::Exclude &exclude = {});
+
+	// verify_references returns whether the certificates of the batches are valid, each is signed by a quorum, and no
+	// committed block refers to them yet
+	bool verify_references(const std::vector<BatchReference> &batches);
+
+	// commit marks the batches that a committed block refers to as referenced, so that they are no longer proposed,
+	// and removes the transactions of those batches that were received from the mempool
+	void commit(const Block &block);
+
+	// find returns the transactions of a batch, or nullptr if the batch was not received
+	const Payload *find(const Hash &digest) const;
+
+	Stats stats() const;
+
+  private:
+	void handle_message(const Signature &sig, const Proto::MessageData &msg);
+	void handle_batch(const Signature &sig, const Proto::MessageData &msg);
+	void handle_batch_ack(const Signature &sig, const Proto::MessageData &msg);
+	void handle_batch_certificate(const Signature &sig, const Proto::MessageData &msg);
+
+	// certify forms the certificate of an own batch from its acknowledgements and broadcasts it
+	void certify(const Hash &digest);
+
+	void start_batch_timer();
+	// seal_batches broadcasts the transactions in the mempool that are not in a batch yet as batches
+	void seal_batches();
+	// prune_batches drops the batches that were stored more than the retention ago, and gives up own batches that are
+	// not certified by then
+	void prune_batches();
+	void store_batch(const Hash &digest, Payload transactions);
+	// release lets the transactions of an own batch be sealed again, or forgets them if they left the mempool
+	void release(const Hash &digest);
+	void add_certified(const Hash &digest, Certificate certificate);
+
+	Settings::Dissemination m_settings;
+
+	std::shared_ptr<EventQueue> m_event_queue;
+	std::shared_ptr<Reactor> m_reactor;
+	std::shared_ptr<Mempool> m_mempool;
+	std::shared_ptr<Network> m_network;
+	std::shared_ptr<Keystore> m_keystore;
+	std::shared_ptr<CertificateVerifier> m_verifier;
+	std::shared_ptr<spdlog::logger> m_logger;
+
+	// batches holds the transactions of all batches that were received, by digest, and stored_order their digests
+	// along with the batch interval in which they were stored, oldest first
+	FlatMap<Hash, Payload> m_batches;
+	std::deque<std::pair<uint64_t, Hash>> m_stored_order;
+	uint64_t m_interval;
+	// acks holds the acknowledgements of own batches that are not certified yet
+	FlatMap<Hash, std::vector<Signature>> m_acks;
+	// unreferenced holds own batches that no committed block refers to yet; their transactions stay in the mempool
+	// until then, and are listed in sealed so that they are not sealed into another batch
+	FlatMap<Hash, bool> m_unreferenced;
+	FlatMap<Hash, bool> m_sealed;
+	// certified holds certified batches that no committed block refers to yet, and certified_order their digests in the
+	// order in which they were certified
+	FlatMap<Hash, Certificate> m_certified;
+	std::deque<Hash> m_certified_order;
+	// referenced remembers batches that committed blocks refer to, so that a late certificate does not get them
+	// proposed again
+	DigestCache m_referenced;
+
+	Stats m_stats;
+};
+
+} // namespace Quasar
@@ -0,0 +1,248 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <botan/ecdsa.h>
+#include <botan/system_rng.h>
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+#include "dissemination.h"
+#include "testing/test_network.h"
+
+namespace
+{
+
+std::shared_ptr<Quasar::Keystore> make_keystore()
+{
+	return std::make_shared<Quasar::Keystore>(
+	    std::make_shared<Botan::ECDSA_PrivateKey>(Botan::system_rng(), Botan::EC_Group{"secp256r1"}));
+}
+
+// Fixture disseminates the batches of the first of two replicas; the second replica only acknowledges them
+struct Fixture
+{
+	Fixture()
+	    : event_queue(std::make_shared<Quasar::EventQueue>()), reactor(std::make_shared<Quasar::Reactor>()),
+	      mempool(std::make_shared<Quasar::ShardedMempool>()), keystore(make_keystore()), peer(make_keystore()),
+	      verifier(std::make_shared<Quasar::CertificateVerifier>(keystore, settings.crypto())),
+	      test_network(std::make_shared<Quasar::TestNetwork>())
+	{
+		keystore->add_public_key(keystore->identity(), keystore->private_key());
+		keystore->add_public_key(peer->identity(), peer->private_key());
+
+		auto network = test_network->create_node(keystore->identity());
+		test_network->create_node(peer->identity());
+
+		dissemination = std::make_shared<Quasar::Dissemination>(settings.dissemination(), event_queue, reactor,
+		                                                        mempool, network, keystore, verifier,
+		                                                        spdlog::null_logger_mt("dissemination_test"));
+		dissemination->init();
+	}
+
+	~Fixture()
+	{
+		spdlog::drop("dissemination_test");
+	}
+
+	void acknowledge(const Quasar::Hash &digest)
+	{
+		auto msg = Quasar::make_message();
+		msg->mutable_data()->mutable_batch_ack()->set_digest(digest.data(), digest.size());
+		event_queue->dispatch(Quasar::MessageEvent{peer->sign(digest.to_byte_string()),
+		                                           Quasar::MessageDataPtr{msg, &msg->data()}});
+	}
+
+	Quasar::Settings settings;
+	std::shared_ptr<Quasar::EventQueue> event_queue;
+	std::shared_ptr<Quasar::Reactor> reactor;
+	std::shared_ptr<Quasar::Mempool> mempool;
+	std::shared_ptr<Quasar::Keystore> keystore;
+	std::shared_ptr<Quasar::Keystore> peer;
+	std::shared_ptr<Quasar::CertificateVerifier> verifier;
+	std::shared_ptr<Quasar::TestNetwork> test_network;
+	std::shared_ptr<Quasar::Dissemination> dissemination;
+};
+
+std::vector<Quasar::Transaction> make_transactions(size_t count)
+{
+	std::vector<Quasar::Transaction> transactions;
+	for (size_t i = 0; i < count; i++)
+	{
+		transactions.emplace_back(std::vector<std::byte>{std::byte(i)});
+	}
+	return transactions;
+}
+
+} // namespace
+
+TEST_CASE("Dissemination certifies a batch once a quorum acknowledged it", "[dissemination]")
+{
+	Fixture fixture;
+	// a single transaction, as the mempool does not keep the order of transactions across its shards
+	const auto transactions = make_transactions(1);
+	fixture.mempool->add(transactions[0]);
+
+	// the mempool is sealed into a batch on the next tick of the batch timer
+	while (fixture.dissemination->stats().sealed == 0)
+	{
+		fixture.reactor->poll();
+	}
+	// the transaction stays in the mempool until a block refers to the batch, but it is not sealed again
+	REQUIRE(fixture.mempool->size() == 1);
+	for (int i = 0; i < 3; i++)
+	{
+		fixture.reactor->poll();
+	}
+	REQUIRE(fixture.dissemination->stats().sealed == 1);
+
+	const auto digest = Quasar::batch_digest(fixture.keystore->identity(), Quasar::Payload{transactions}.root());
+	auto batch = fixture.dissemination->find(digest);
+	REQUIRE(batch != nullptr);
+	REQUIRE(batch->size() == 1);
+
+	// the author's own acknowledgement is not a quorum of two
+	REQUIRE(fixture.dissemination->select_certified().empty());
+
+	fixture.acknowledge(digest);
+	auto references = fixture.dissemination->select_certified();
+	REQUIRE(references.size() == 1);
+	REQUIRE(references[0].digest == digest);
+	REQUIRE(references[0].certificate.signers().size() == 2);
+
+	REQUIRE(fixture.dissemination->verify_references(references));
+	fixture.dissemination->commit(Quasar::Block{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 1, {}, references});
+	REQUIRE(fixture.dissemination->stats().referenced == 1);
+	REQUIRE(fixture.mempool->size() == 0);
+	REQUIRE(fixture.dissemination->select_certified().empty());
+	REQUIRE(!fixture.dissemination->verify_references(references));
+}
+
+TEST_CASE("Dissemination proposes a batch again if the block that refers to it is not committed", "[dissemination]")
+{
+	Fixture fixture;
+	const auto transactions = make_transactions(1);
+	fixture.mempool->add(transactions[0]);
+	const auto digest = Quasar::batch_digest(fixture.keystore->identity(), Quasar::Payload{transactions}.root());
+
+	while (fixture.dissemination->stats().sealed == 0)
+	{
+		fixture.reactor->poll();
+	}
+	fixture.acknowledge(digest);
+
+	// a proposal refers to the batch, but it is abandoned without being committed
+	auto references = fixture.dissemination->select_certified();
+	REQUIRE(references.size() == 1);
+	REQUIRE(fixture.dissemination->verify_references(references));
+	const Quasar::Block abandoned{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 1, {}, references};
+
+	// a block that extends the proposal leaves the batch out, but a later proposal on another fork still carries it
+	auto exclude = [&abandoned](const Quasar::Hash &hash) { return abandoned.batches()[0].digest == hash; };
+	REQUIRE(fixture.dissemination->select_certified(exclude).empty());
+	references = fixture.dissemination->select_certified();
+	REQUIRE(references.size() == 1);
+	REQUIRE(references[0].digest == digest);
+	REQUIRE(fixture.mempool->size() == 1);
+
+	const Quasar::Block later{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 2, {}, references};
+	fixture.dissemination->commit(later);
+	REQUIRE(fixture.dissemination->stats().referenced == 1);
+	REQUIRE(fixture.mempool->size() == 0);
+	REQUIRE(fixture.dissemination->select_certified().empty());
+}
+
+TEST_CASE("Dissemination seals the transactions of a batch without a quorum once more", "[dissemination]")
+{
+	Fixture fixture;
+	const auto transactions = make_transactions(1);
+	fixture.mempool->add(transactions[0]);
+	const auto digest = Quasar::batch_digest(fixture.keystore->identity(), Quasar::Payload{transactions}.root());
+
+	// the peer never acknowledges the batch, so it is given up after the retention
+	while (fixture.dissemination->stats().expired == 0)
+	{
+		REQUIRE(fixture.dissemination->stats().sealed <= 1);
+		fixture.reactor->poll();
+	}
+	REQUIRE(fixture.dissemination->stats().pruned == 1);
+	REQUIRE(fixture.mempool->size() == 1);
+
+	// the transaction is sealed in the same batch interval, into a batch with the same digest
+	REQUIRE(fixture.dissemination->stats().sealed == 2);
+	REQUIRE(fixture.dissemination->find(digest) != nullptr);
+
+	fixture.acknowledge(digest);
+	REQUIRE(fixture.dissemination->select_certified().size() == 1);
+}
+
+TEST_CASE("Dissemination prunes the batches of other replicas after the retention", "[dissemination]")
+{
+	Fixture fixture;
+	const Quasar::Payload transactions{make_transactions(2)};
+
+	auto msg = Quasar::make_message();
+	transactions.to_proto(msg->mutable_data()->mutable_batch()->mutable_transactions());
+	fixture.event_queue->dispatch(Quasar::MessageEvent{fixture.peer->sign(msg->data().SerializeAsString()),
+	                                                   Quasar::MessageDataPtr{msg, &msg->data()}});
+
+	const auto digest = Quasar::batch_digest(fixture.peer->identity(), transactions.root());
+	REQUIRE(fixture.dissemination->find(digest) != nullptr);
+
+	while (fixture.dissemination->stats().pruned == 0)
+	{
+		fixture.reactor->poll();
+	}
+	REQUIRE(fixture.dissemination->find(digest) == nullptr);
+	REQUIRE(fixture.dissemination->stats().expired == 0);
+}
+
+TEST_CASE("Dissemination removes the transactions of committed batches of other replicas", "[dissemination]")
+{
+	Fixture fixture;
+	REQUIRE(fixture.dissemination->enabled());
+
+	// a client sent the transactions to both replicas, and the peer sealed them into a batch first
+	const auto transactions = make_transactions(2);
+	for (const auto &transaction : transactions)
+	{
+		fixture.mempool->add(transaction);
+	}
+	const Quasar::Payload payload{transactions};
+	auto msg = Quasar::make_message();
+	payload.to_proto(msg->mutable_data()->mutable_batch()->mutable_transactions());
+	fixture.event_queue->dispatch(Quasar::MessageEvent{fixture.peer->sign(msg->data().SerializeAsString()),
+	                                                   Quasar::MessageDataPtr{msg, &msg->data()}});
+
+	const auto digest = Quasar::batch_digest(fixture.peer->identity(), payload.root());
+	const auto message = digest.to_byte_string();
+	const Quasar::Certificate certificate{{fixture.keystore->sign(message), fixture.peer->sign(message)}};
+	fixture.dissemination->commit(
+	    Quasar::Block{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 1, {}, {{digest, certificate}}});
+
+	REQUIRE(fixture.mempool->size() == 0);
+	REQUIRE(fixture.dissemination->stats().referenced == 1);
+}
+
+TEST_CASE("Dissemination rejects references to batches without a quorum", "[dissemination]")
+{
+	Fixture fixture;
+	const auto digest = Quasar::batch_digest(fixture.peer->identity(), {});
+	const Quasar::Certificate certificate{{fixture.peer->sign(digest.to_byte_string())}};
+
+	REQUIRE(!fixture.dissemination->verify_references({{digest, certificate}}));
+}
+
+TEST_CASE("Dissemination drops batch certificates that cannot be decoded", "[dissemination]")
+{
+	Fixture fixture;
+	const auto digest = Quasar::batch_digest(fixture.peer->identity(), {});
+
+	// the bitmap has a bit set beyond the validator set
+	auto msg = Quasar::make_message();
+	auto reference = msg->mutable_data()->mutable_batch_certificate();
+	reference->set_digest(digest.data(), digest.size());
+	reference->mutable_certificate()->set_signers(std::string(1, '\xFF'));
+	REQUIRE_NOTHROW(fixture.event_queue->dispatch(Quasar::MessageEvent{
+	    fixture.peer->sign(digest.to_byte_string()), Quasar::MessageDataPtr{msg, &msg->data()}}));
+
+	REQUIRE(fixture.dissemination->select_certified().empty());
+}
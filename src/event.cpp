@@ -0,0 +1,145 @@
+#include <bit>
+#include <thread>
+
+#include "event.h"
+
+namespace Quasar
+{
+
+EventQueue::EventQueue(size_t capacity)
+    : m_slots(std::bit_ceil(std::max<size_t>(capacity, 2))), m_mask(m_slots.size() - 1), m_head(0), m_tail(0),
+      m_waiting(false)
+{
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+void EventQueue::enqueue_event(Event &&event)
+{
+	auto position = m_head.load(std::memory_order_relaxed);
+	Slot *slot;
+	while (true)
+	{
+		slot = &m_slots[position & m_mask];
+		auto sequence = slot->sequence.load(std::memory_order_acquire);
+		auto difference = (std::ptrdiff_t)(sequence - position);
+
+		if (difference == 0)
+		{
+			if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the ring is full, so wait for the consensus thread to free the slot
+			std::this_thread::yield();
+			position = m_head.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			position = m_head.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->event = std::move(event);
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	// pairs with the fence in prepare_wait: either the consumer sees the event, or the producer sees it waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_waiting.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	if (m_waker)
+	{
+		m_waker();
+	}
+	else
+	{
+		std::lock_guard lock{m_wait_mutex};
+		m_wait_cv.notify_one();
+	}
+}
+
+size_t EventQueue::process()
+{
+	const auto end = m_head.load(std::memory_order_acquire);
+
+	size_t count = 0;
+	while (m_tail != end && ready())
+	{
+		auto &slot = m_slots[m_tail & m_mask];
+		auto event = std::move(slot.event);
+		slot.event.emplace<std::monostate>();
+		slot.sequence.store(m_tail + m_slots.size(), std::memory_order_release);
+		m_tail++;
+
+		std::visit(
+		    [this](const auto &event) {
+			    if constexpr (!std::is_same_v<std::decay_t<decltype(event)>, std::monostate>)
+			    {
+				    dispatch(event);
+			    }
+		    },
+		    event);
+		count++;
+	}
+	return count;
+}
+
+bool EventQueue::wait_for(std::chrono::nanoseconds timeout)
+{
+	if (!prepare_wait())
+	{
+		finish_wait();
+		return true;
+	}
+
+	bool result;
+	{
+		std::unique_lock lock{m_wait_mutex};
+		result = m_wait_cv.wait_for(lock, timeout, [this] { return ready(); });
+	}
+
+	finish_wait();
+	return result;
+}
+
+void EventQueue::set_waker(std::function<void()> waker)
+{
+	m_waker = std::move(waker);
+}
+
+bool EventQueue::prepare_wait()
+{
+	if (ready())
+	{
+		return false;
+	}
+
+	m_waiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return !ready();
+}
+
+void EventQueue::finish_wait()
+{
+	m_waiting.store(false, std::memory_order_relaxed);
+}
+
+size_t EventQueue::capacity() const
+{
+	return m_slots.size();
+}
+
+bool EventQueue::ready() const
+{
+	return m_slots[m_tail & m_mask].sequence.load(std::memory_order_acquire) == m_tail + 1;
+}
+
+} // namespace Quasar
@@ -1,7 +1,18 @@
 #pragma once
 
-#include <eventpp/eventqueue.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include "quasar.pb.h"
 #include "types.h"
@@ -9,17 +20,201 @@
 namespace Quasar
 {
 
-enum class EventType
+// MessageDataPtr shares ownership of the arena that the received message was allocated on.
+using MessageDataPtr = std::shared_ptr<const Proto::MessageData>;
+
+// Callback is a move-only function that is stored inline, so that queueing it does not allocate.
+// The captures of the function must fit into CAPACITY bytes, which is checked at compile time.
+class Callback
 {
-	MESSAGE,  // data: pair<Signature, MessageData>
-	CALLBACK, // data: function<void()>
-	TIMEOUT,  // data: Round
-	ADVANCE,  // data: pair<Round, bool>
+  public:
+	static constexpr size_t CAPACITY = 48;
+
+	Callback() = default;
+
+	template <typename F>
+	    requires(!std::is_same_v<std::decay_t<F>, Callback>)
+	Callback(F &&function)
+	{
+		using T = std::decay_t<F>;
+		static_assert(sizeof(T) <= CAPACITY && alignof(T) <= alignof(std::max_align_t),
+		              "the captures of the callback do not fit into its inline storage");
+		static_assert(std::is_nothrow_move_constructible_v<T>, "the callback must be nothrow move constructible");
+
+		new (m_storage) T(std::forward<F>(function));
+		m_ops = &OPS<T>;
+	}
+
+	Callback(Callback &&other) noexcept : m_ops(other.m_ops)
+	{
+		if (m_ops)
+		{
+			m_ops->move(m_storage, other.m_storage);
+			other.m_ops = nullptr;
+		}
+	}
+
+	Callback &operator=(Callback &&other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			if (other.m_ops)
+			{
+				other.m_ops->move(m_storage, other.m_storage);
+				m_ops = std::exchange(other.m_ops, nullptr);
+			}
+		}
+		return *this;
+	}
+
+	Callback(const Callback &) = delete;
+	Callback &operator=(const Callback &) = delete;
+
+	~Callback()
+	{
+		reset();
+	}
+
+	void operator()() const
+	{
+		m_ops->call(m_storage);
+	}
+
+	explicit operator bool() const
+	{
+		return m_ops != nullptr;
+	}
+
+  private:
+	struct Ops
+	{
+		void (*call)(void *storage);
+		void (*move)(void *to, void *from);
+		void (*destroy)(void *storage);
+	};
+
+	template <typename T>
+	static constexpr Ops OPS{
+	    [](void *storage) { (*static_cast<T *>(storage))(); },
+	    [](void *to, void *from) {
+		    new (to) T(std::move(*static_cast<T *>(from)));
+		    static_cast<T *>(from)->~T();
+	    },
+	    [](void *storage) { static_cast<T *>(storage)->~T(); },
+	};
+
+	void reset()
+	{
+		if (m_ops)
+		{
+			m_ops->destroy(m_storage);
+			m_ops = nullptr;
+		}
+	}
+
+	alignas(std::max_align_t) mutable std::byte m_storage[CAPACITY];
+	const Ops *m_ops = nullptr;
+};
+
+struct MessageEvent
+{
+	Signature signature;
+	MessageDataPtr data;
 };
 
-// TODO: should probably create new types for each of the possible EventData types.
-using EventData = std::variant<std::monostate, std::pair<Signature, Proto::MessageData>, std::function<void()>, Round,
-                               std::pair<Round, bool>>;
-using EventQueue = eventpp::EventQueue<EventType, void(EventData)>;
+struct TimeoutEvent
+{
+	Round round;
+};
+
+struct AdvanceEvent
+{
+	Round round;
+	bool timeout;
+};
+
+template <typename T> using Listener = std::function<void(const T &)>;
+
+// EventQueue hands events from any thread to the consensus thread.
+// Events are queued in a bounded ring buffer that producers claim slots of without taking a lock, and the
+// consensus thread drains the ring in batches with process. Each event type has its own table of listeners, so an
+// event only reaches the listeners that registered for its type.
+// Listeners must be appended before events are processed, and only the consensus thread may call process and
+// dispatch.
+class EventQueue
+{
+  public:
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 14;
+
+	// capacity is rounded up to a power of two
+	explicit EventQueue(size_t capacity = DEFAULT_CAPACITY);
+
+	template <typename T> void append_listener(Listener<T> listener)
+	{
+		std::get<std::vector<Listener<T>>>(m_listeners).push_back(std::move(listener));
+	}
+
+	// enqueue queues an event to be processed on the consensus thread.
+	// When the ring is full it waits for the consensus thread to make room, so the consensus thread must not call it.
+	template <typename T> void enqueue(T event)
+	{
+		enqueue_event(Event{std::in_place_type<T>, std::move(event)});
+	}
+
+	// dispatch runs the listeners of an event immediately on the calling thread
+	template <typename T> void dispatch(const T &event)
+	{
+		for (const auto &listener : std::get<std::vector<Listener<T>>>(m_listeners))
+		{
+			listener(event);
+		}
+	}
+
+	// process runs the listeners of the events that are queued when it is called, and returns how many there were.
+	// Events that are queued while it runs are left for the next call.
+	size_t process();
+
+	// wait_for waits until an event is queued or the timeout expires, and returns whether an event is queued
+	bool wait_for(std::chrono::nanoseconds timeout);
+
+	// set_waker makes producers call the waker instead of waking wait_for, for a consumer that sleeps elsewhere.
+	// Such a consumer calls prepare_wait before it sleeps, and only sleeps if it returns true; it calls finish_wait
+	// when it is awake again.
+	void set_waker(std::function<void()> waker);
+	bool prepare_wait();
+	void finish_wait();
+
+	size_t capacity() const;
+
+  private:
+	using Event = std::variant<std::monostate, MessageEvent, TimeoutEvent, AdvanceEvent>;
+
+	// a slot is ready to be claimed at position p when its sequence is p, and holds an event when it is p + 1
+	struct alignas(64) Slot
+	{
+		std::atomic<size_t> sequence;
+		Event event;
+	};
+
+	void enqueue_event(Event &&event);
+	bool ready() const;
+
+	std::vector<Slot> m_slots;
+	size_t m_mask;
+
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) size_t m_tail;
+
+	// the consumer sleeps only after announcing it in waiting, so producers only wake it when needed
+	std::atomic<bool> m_waiting;
+	std::mutex m_wait_mutex;
+	std::condition_variable m_wait_cv;
+	std::function<void()> m_waker;
+
+	std::tuple<std::vector<Listener<MessageEvent>>, std::vector<Listener<TimeoutEvent>>,
+	           std::vector<Listener<AdvanceEvent>>>
+	    m_listeners;
+};
 
 } // namespace Quasar
@@ -0,0 +1,127 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+
+#include "event.h"
+
+TEST_CASE("Callback runs and moves its captures", "[event]")
+{
+	auto counter = std::make_shared<int>(0);
+
+	Quasar::Callback callback{[counter] { (*counter)++; }};
+	REQUIRE(counter.use_count() == 2);
+
+	Quasar::Callback moved{std::move(callback)};
+	REQUIRE_FALSE(callback);
+	REQUIRE(moved);
+	moved();
+	REQUIRE(*counter == 1);
+
+	moved = Quasar::Callback{};
+	REQUIRE(counter.use_count() == 1);
+}
+
+TEST_CASE("EventQueue only runs the listeners of an event's type", "[event]")
+{
+	Quasar::EventQueue queue{16};
+	std::vector<Quasar::Round> timeouts;
+	std::vector<Quasar::Round> advances;
+
+	queue.append_listener<Quasar::TimeoutEvent>(
+	    [&](const Quasar::TimeoutEvent &event) { timeouts.push_back(event.round); });
+	queue.append_listener<Quasar::AdvanceEvent>(
+	    [&](const Quasar::AdvanceEvent &event) { advances.push_back(event.round); });
+
+	queue.enqueue(Quasar::TimeoutEvent{1});
+	queue.enqueue(Quasar::AdvanceEvent{2, false});
+	queue.enqueue(Quasar::TimeoutEvent{3});
+	REQUIRE(timeouts.empty());
+
+	REQUIRE(queue.process() == 3);
+	REQUIRE((timeouts == std::vector<Quasar::Round>{1, 3}));
+	REQUIRE(advances == std::vector<Quasar::Round>{2});
+
+	queue.dispatch(Quasar::AdvanceEvent{4, true});
+	REQUIRE((advances == std::vector<Quasar::Round>{2, 4}));
+	REQUIRE(queue.process() == 0);
+}
+
+TEST_CASE("EventQueue leaves events queued by listeners for the next batch", "[event]")
+{
+	Quasar::EventQueue queue{16};
+	std::vector<Quasar::Round> timeouts;
+
+	queue.append_listener<Quasar::TimeoutEvent>([&](const Quasar::TimeoutEvent &event) {
+		timeouts.push_back(event.round);
+		if (event.round == 1)
+		{
+			queue.enqueue(Quasar::TimeoutEvent{2});
+		}
+	});
+	queue.enqueue(Quasar::TimeoutEvent{1});
+
+	REQUIRE(queue.process() == 1);
+	REQUIRE(timeouts == std::vector<Quasar::Round>{1});
+	REQUIRE(queue.process() == 1);
+	REQUIRE((timeouts == std::vector<Quasar::Round>{1, 2}));
+}
+
+TEST_CASE("EventQueue keeps the order of each producer", "[event]")
+{
+	const size_t producers = 4;
+	const size_t events = 20000;
+
+	// a small ring makes the producers wait for the consumer
+	Quasar::EventQueue queue{64};
+	std::vector<Quasar::Round> last(producers, 0);
+	size_t received = 0;
+	bool ordered = true;
+
+	queue.append_listener<Quasar::AdvanceEvent>([&](const Quasar::AdvanceEvent &event) {
+		auto producer = event.round % producers;
+		ordered = ordered && event.round > last[producer];
+		last[producer] = event.round;
+		received++;
+	});
+
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&queue, p] {
+			for (size_t i = 1; i <= events; i++)
+			{
+				queue.enqueue(Quasar::AdvanceEvent{i * producers + p, false});
+			}
+		});
+	}
+
+	while (received < producers * events)
+	{
+		queue.wait_for(std::chrono::milliseconds(10));
+		queue.process();
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(ordered);
+	REQUIRE(received == producers * events);
+}
+
+TEST_CASE("Benchmark EventQueue", "[!benchmark][event]")
+{
+	Quasar::EventQueue queue;
+	size_t received = 0;
+	queue.append_listener<Quasar::TimeoutEvent>([&](const Quasar::TimeoutEvent &) { received++; });
+
+	BENCHMARK("enqueue and process 1000 events")
+	{
+		for (Quasar::Round round = 0; round < 1000; round++)
+		{
+			queue.enqueue(Quasar::TimeoutEvent{round});
+		}
+		return queue.process();
+	};
+}
@@ -0,0 +1,548 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "types.h"
+
+namespace Quasar
+{
+
+// FlatMapTraits defines how the keys of a FlatMap are hashed and compared.
+template <typename K> struct FlatMapTraits;
+
+template <> struct FlatMapTraits<Hash>
+{
+	// SHA-256 digests are uniformly distributed already, so a single word of the digest is a good hash.
+	static uint64_t hash(const Hash &key)
+	{
+		uint64_t word;
+		std::memcpy(&word, key.data(), sizeof(word));
+		return word;
+	}
+
+	static bool equal(const Hash &a, const Hash &b)
+	{
+#if defined(__SSE2__)
+		static_assert(HASH_LENGTH == 32);
+		auto lo =
+		    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a.data()), _mm_loadu_si128((const __m128i *)b.data()));
+		auto hi = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a.data() + 16)),
+		                         _mm_loadu_si128((const __m128i *)(b.data() + 16)));
+		return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+#else
+		return std::memcmp(a.data(), b.data(), HASH_LENGTH) == 0;
+#endif
+	}
+};
+
+template <> struct FlatMapTraits<uint64_t>
+{
+	// The table takes the control byte and the slot from the low bits of the hash. Unlike Fibonacci hashing, which
+	// takes the top bits of the product, this keeps the low bits: multiplying by an odd constant permutes them, so
+	// consecutive integers (such as rounds) land in distinct slots. The low bits of the product depend only on the low
+	// bits of the key, so the high half of the key is folded in; keys that differ only in the middle bits, above those
+	// of the slot, would still collide, but rounds are consecutive and short IDs are uniform.
+	static uint64_t hash(uint64_t key)
+	{
+		return (key * 0x9E3779B97F4A7C15ULL) ^ (key >> 32);
+	}
+
+	static bool equal(uint64_t a, uint64_t b)
+	{
+		return a == b;
+	}
+};
+
+// FlatMap is an open-addressing hash map that stores its entries in a single array.
+// Like SwissTable, it keeps one control byte per slot that holds 7 bits of the key's hash, and probes groups of
+// 16 control bytes at a time with SIMD instructions, so most lookups touch only one cache line of entries.
+// Erasing an entry does not move other entries, so it only invalidates iterators to the erased entry.
+// Inserting may rehash the table, which invalidates all iterators.
+template <typename K, typename V, typename Traits = FlatMapTraits<K>> class FlatMap
+{
+  public:
+	using value_type = std::pair<const K, V>;
+
+	template <bool CONST> class Iterator
+	{
+	  public:
+		using map_type = std::conditional_t<CONST, const FlatMap, FlatMap>;
+		using reference = std::conditional_t<CONST, const value_type &, value_type &>;
+		using pointer = std::conditional_t<CONST, const value_type *, value_type *>;
+
+		Iterator(map_type *map, size_t index) : m_map(map), m_index(index)
+		{
+			skip_free();
+		}
+
+		// allow conversion from a mutable to a const iterator
+		operator Iterator<true>() const
+		{
+			return {m_map, m_index};
+		}
+
+		reference operator*() const
+		{
+			return *m_map->slot(m_index);
+		}
+
+		pointer operator->() const
+		{
+			return m_map->slot(m_index);
+		}
+
+		Iterator &operator++()
+		{
+			m_index++;
+			skip_free();
+			return *this;
+		}
+
+		bool operator==(const Iterator &other) const
+		{
+			return m_index == other.m_index;
+		}
+
+	  private:
+		void skip_free()
+		{
+			while (m_index < m_map->m_capacity && !is_full(m_map->m_ctrl[m_index]))
+			{
+				m_index++;
+			}
+		}
+
+		map_type *m_map;
+		size_t m_index;
+
+		friend class FlatMap;
+	};
+
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	FlatMap() = default;
+
+	FlatMap(const FlatMap &other)
+	{
+		reserve(other.size());
+		for (const auto &entry : other)
+		{
+			emplace(entry.first, entry.second);
+		}
+	}
+
+	FlatMap(FlatMap &&other) noexcept
+	    : m_ctrl(std::exchange(other.m_ctrl, nullptr)), m_slots(std::exchange(other.m_slots, nullptr)),
+	      m_capacity(std::exchange(other.m_capacity, 0)), m_size(std::exchange(other.m_size, 0)),
+	      m_growth_left(std::exchange(other.m_growth_left, 0))
+	{
+	}
+
+	FlatMap &operator=(FlatMap other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~FlatMap()
+	{
+		destroy();
+	}
+
+	void swap(FlatMap &other) noexcept
+	{
+		std::swap(m_ctrl, other.m_ctrl);
+		std::swap(m_slots, other.m_slots);
+		std::swap(m_capacity, other.m_capacity);
+		std::swap(m_size, other.m_size);
+		std::swap(m_growth_left, other.m_growth_left);
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+
+	size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+	iterator begin()
+	{
+		return {this, 0};
+	}
+
+	iterator end()
+	{
+		return {this, m_capacity};
+	}
+
+	const_iterator begin() const
+	{
+		return {this, 0};
+	}
+
+	const_iterator end() const
+	{
+		return {this, m_capacity};
+	}
+
+	iterator find(const K &key)
+	{
+		return {this, find_index(key)};
+	}
+
+	const_iterator find(const K &key) const
+	{
+		return {this, find_index(key)};
+	}
+
+	bool contains(const K &key) const
+	{
+		return find_index(key) != m_capacity;
+	}
+
+	template <typename... Args> std::pair<iterator, bool> emplace(const K &key, Args &&...args)
+	{
+		auto hash = Traits::hash(key);
+		auto index = find_index(key, hash);
+		if (index != m_capacity)
+		{
+			return {{this, index}, false};
+		}
+
+		if (m_capacity == 0)
+		{
+			grow();
+		}
+
+		index = find_insert_index(hash);
+		if (m_growth_left == 0 && m_ctrl[index] == EMPTY)
+		{
+			grow();
+			index = find_insert_index(hash);
+		}
+
+		if (m_ctrl[index] == EMPTY)
+		{
+			m_growth_left--;
+		}
+		new (slot(index)) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+		                             std::forward_as_tuple(std::forward<Args>(args)...));
+		set_ctrl(index, h2(hash));
+		m_size++;
+
+		return {{this, index}, true};
+	}
+
+	std::pair<iterator, bool> insert(const value_type &entry)
+	{
+		return emplace(entry.first, entry.second);
+	}
+
+	std::pair<iterator, bool> insert(value_type &&entry)
+	{
+		return emplace(entry.first, std::move(entry.second));
+	}
+
+	V &operator[](const K &key)
+	{
+		return emplace(key).first->second;
+	}
+
+	iterator erase(const_iterator it)
+	{
+		erase_index(it.m_index);
+		return {this, it.m_index + 1};
+	}
+
+	size_t erase(const K &key)
+	{
+		auto index = find_index(key);
+		if (index == m_capacity)
+		{
+			return 0;
+		}
+		erase_index(index);
+		return 1;
+	}
+
+	// erase_if erases all entries for which pred returns true, and returns the number of erased entries.
+	template <typename Pred> size_t erase_if(Pred pred)
+	{
+		size_t erased = 0;
+		for (size_t i = 0; i < m_capacity; i++)
+		{
+			if (is_full(m_ctrl[i]) && pred(*slot(i)))
+			{
+				erase_index(i);
+				erased++;
+			}
+		}
+		return erased;
+	}
+
+	void clear()
+	{
+		destroy();
+	}
+
+	// reserve makes room for at least count entries without rehashing.
+	void reserve(size_t count)
+	{
+		if (count > m_size + m_growth_left)
+		{
+			rehash(capacity_for(count));
+		}
+	}
+
+	// shrink returns memory after many entries were erased: it rehashes the table to the capacity for its entries if
+	// that is at most a quarter of the current one, so that a map whose size goes up and down a little is not
+	// rehashed each time.
+	void shrink()
+	{
+		if (m_size == 0)
+		{
+			destroy();
+			return;
+		}
+
+		const auto capacity = capacity_for(m_size);
+		if (capacity <= m_capacity / 4)
+		{
+			rehash(capacity);
+		}
+	}
+
+  private:
+	static constexpr size_t GROUP_WIDTH = 16;
+	static constexpr size_t MIN_CAPACITY = GROUP_WIDTH;
+
+	static constexpr int8_t EMPTY = -128;
+	static constexpr int8_t DELETED = -2;
+
+	static bool is_full(int8_t ctrl)
+	{
+		return ctrl >= 0;
+	}
+
+	static int8_t h2(uint64_t hash)
+	{
+		return (int8_t)(hash & 0x7F);
+	}
+
+	static size_t h1(uint64_t hash)
+	{
+		return (size_t)(hash >> 7);
+	}
+
+	// the table is kept at most 7/8 full
+	static size_t max_load(size_t capacity)
+	{
+		return capacity - capacity / 8;
+	}
+
+	static size_t capacity_for(size_t count)
+	{
+		size_t capacity = MIN_CAPACITY;
+		while (max_load(capacity) < count)
+		{
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	// match returns a bitmask with a bit set for each control byte in the group that equals value.
+	static uint32_t match(const int8_t *group, int8_t value)
+	{
+#if defined(__SSE2__)
+		auto ctrl = _mm_loadu_si128((const __m128i *)group);
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), ctrl));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < GROUP_WIDTH; i++)
+		{
+			mask |= (uint32_t)(group[i] == value) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// match_free returns a bitmask with a bit set for each empty or deleted control byte in the group.
+	static uint32_t match_free(const int8_t *group)
+	{
+#if defined(__SSE2__)
+		// EMPTY and DELETED are the only negative values
+		return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < GROUP_WIDTH; i++)
+		{
+			mask |= (uint32_t)(group[i] < 0) << i;
+		}
+		return mask;
+#endif
+	}
+
+	value_type *slot(size_t index) const
+	{
+		return std::launder(reinterpret_cast<value_type *>(m_slots) + index);
+	}
+
+	// The first GROUP_WIDTH control bytes are mirrored after the end of the table,
+	// so that a group starting near the end can be loaded without wrapping around.
+	void set_ctrl(size_t index, int8_t value)
+	{
+		m_ctrl[index] = value;
+		if (index < GROUP_WIDTH)
+		{
+			m_ctrl[m_capacity + index] = value;
+		}
+	}
+
+	size_t find_index(const K &key) const
+	{
+		return find_index(key, Traits::hash(key));
+	}
+
+	// find_index returns the index of the slot that holds key, or m_capacity if there is no such slot.
+	size_t find_index(const K &key, uint64_t hash) const
+	{
+		if (m_size == 0)
+		{
+			return m_capacity;
+		}
+
+		auto mask = m_capacity - 1;
+		auto pos = h1(hash) & mask;
+		for (size_t step = GROUP_WIDTH;; step += GROUP_WIDTH)
+		{
+			const auto *group = m_ctrl + pos;
+			for (auto bits = match(group, h2(hash)); bits != 0; bits &= bits - 1)
+			{
+				auto index = (pos + std::countr_zero(bits)) & mask;
+				if (Traits::equal(slot(index)->first, key))
+				{
+					return index;
+				}
+			}
+			if (match(group, EMPTY) != 0)
+			{
+				return m_capacity;
+			}
+			pos = (pos + step) & mask;
+		}
+	}
+
+	// find_insert_index returns the first free slot in the probe sequence of hash.
+	size_t find_insert_index(uint64_t hash) const
+	{
+		auto mask = m_capacity - 1;
+		auto pos = h1(hash) & mask;
+		for (size_t step = GROUP_WIDTH;; step += GROUP_WIDTH)
+		{
+			auto bits = match_free(m_ctrl + pos);
+			if (bits != 0)
+			{
+				return (pos + std::countr_zero(bits)) & mask;
+			}
+			pos = (pos + step) & mask;
+		}
+	}
+
+	void erase_index(size_t index)
+	{
+		slot(index)->~value_type();
+		// a tombstone keeps probe sequences that pass through this slot intact
+		set_ctrl(index, DELETED);
+		m_size--;
+	}
+
+	void grow()
+	{
+		// if many slots are taken up by tombstones, rehashing at the same capacity is enough to clean them up
+		auto capacity = m_capacity == 0 ? MIN_CAPACITY : m_capacity;
+		if (m_size + 1 > max_load(capacity) / 2)
+		{
+			capacity *= 2;
+		}
+		rehash(capacity);
+	}
+
+	void rehash(size_t capacity)
+	{
+		FlatMap table;
+		table.allocate(capacity);
+
+		for (size_t i = 0; i < m_capacity; i++)
+		{
+			if (!is_full(m_ctrl[i]))
+			{
+				continue;
+			}
+			auto entry = slot(i);
+			auto hash = Traits::hash(entry->first);
+			auto index = table.find_insert_index(hash);
+			new (table.slot(index)) value_type(std::move(*entry));
+			table.set_ctrl(index, h2(hash));
+			table.m_size++;
+			table.m_growth_left--;
+		}
+
+		swap(table);
+	}
+
+	void allocate(size_t capacity)
+	{
+		m_capacity = capacity;
+		m_growth_left = max_load(capacity);
+		m_ctrl = new int8_t[capacity + GROUP_WIDTH];
+		std::memset(m_ctrl, EMPTY, capacity + GROUP_WIDTH);
+		m_slots = static_cast<std::byte *>(
+		    ::operator new(capacity * sizeof(value_type), std::align_val_t{alignof(value_type)}));
+	}
+
+	void destroy()
+	{
+		for (size_t i = 0; i < m_capacity; i++)
+		{
+			if (is_full(m_ctrl[i]))
+			{
+				slot(i)->~value_type();
+			}
+		}
+		delete[] m_ctrl;
+		if (m_slots != nullptr)
+		{
+			::operator delete(m_slots, std::align_val_t{alignof(value_type)});
+		}
+
+		m_ctrl = nullptr;
+		m_slots = nullptr;
+		m_capacity = 0;
+		m_size = 0;
+		m_growth_left = 0;
+	}
+
+	int8_t *m_ctrl = nullptr;
+	std::byte *m_slots = nullptr;
+	size_t m_capacity = 0;
+	size_t m_size = 0;
+	size_t m_growth_left = 0;
+};
+
+} // namespace Quasar
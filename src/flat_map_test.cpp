@@ -0,0 +1,231 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "flat_map.h"
+
+namespace
+{
+
+std::vector<Quasar::Hash> random_hashes(size_t count)
+{
+	std::mt19937_64 rng{42};
+	std::vector<Quasar::Hash> hashes(count);
+	for (auto &hash : hashes)
+	{
+		for (auto &b : hash)
+		{
+			b = (uint8_t)rng();
+		}
+	}
+	return hashes;
+}
+
+// BytewiseHash is the hash of Hash keys before FlatMap, which folds every byte; it is the baseline of the benchmarks
+struct BytewiseHash
+{
+	size_t operator()(const Quasar::Hash &a) const noexcept
+	{
+		const std::hash<uint8_t> hasher;
+		size_t h = 0;
+		for (size_t i = 0; i < Quasar::HASH_LENGTH; i++)
+		{
+			h = h * 31 + hasher(a[i]);
+		}
+		return h;
+	}
+};
+
+} // namespace
+
+TEST_CASE("FlatMap inserts, finds and erases", "[flat_map]")
+{
+	Quasar::FlatMap<Quasar::Hash, int> map;
+	const auto keys = random_hashes(1000);
+
+	REQUIRE(map.empty());
+	REQUIRE(map.find(keys[0]) == map.end());
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		REQUIRE(map.emplace(keys[i], (int)i).second);
+	}
+	REQUIRE(map.size() == keys.size());
+	REQUIRE_FALSE(map.emplace(keys[0], -1).second);
+	REQUIRE(map.find(keys[0])->second == 0);
+
+	for (size_t i = 0; i < keys.size(); i += 2)
+	{
+		REQUIRE(map.erase(keys[i]) == 1);
+	}
+	REQUIRE(map.erase(keys[0]) == 0);
+	REQUIRE(map.size() == keys.size() / 2);
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		REQUIRE(map.contains(keys[i]) == (i % 2 == 1));
+	}
+
+	size_t visited = 0;
+	for (const auto &[key, value] : map)
+	{
+		REQUIRE(key == keys[value]);
+		visited++;
+	}
+	REQUIRE(visited == map.size());
+}
+
+TEST_CASE("FlatMap shrinks once most entries are erased", "[flat_map]")
+{
+	Quasar::FlatMap<Quasar::Hash, int> map;
+	const auto keys = random_hashes(1000);
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		map.emplace(keys[i], (int)i);
+	}
+	const auto capacity = map.capacity();
+
+	// erasing half of the entries is not enough to shrink
+	for (size_t i = 0; i < keys.size() / 2; i++)
+	{
+		map.erase(keys[i]);
+	}
+	map.shrink();
+	REQUIRE(map.capacity() == capacity);
+
+	for (size_t i = keys.size() / 2; i < keys.size() - 10; i++)
+	{
+		map.erase(keys[i]);
+	}
+	map.shrink();
+	REQUIRE(map.capacity() < capacity / 4);
+	REQUIRE(map.size() == 10);
+	for (size_t i = keys.size() - 10; i < keys.size(); i++)
+	{
+		REQUIRE(map.find(keys[i])->second == (int)i);
+	}
+
+	for (size_t i = keys.size() - 10; i < keys.size(); i++)
+	{
+		map.erase(keys[i]);
+	}
+	map.shrink();
+	REQUIRE(map.capacity() == 0);
+	REQUIRE(map.emplace(keys[0], 0).second);
+}
+
+TEST_CASE("FlatMap matches std::unordered_map under churn", "[flat_map]")
+{
+	Quasar::FlatMap<uint64_t, std::string> map;
+	std::unordered_map<uint64_t, std::string> expected;
+	std::mt19937_64 rng{7};
+
+	// a small key space forces many tombstones to be reused and purged
+	for (int i = 0; i < 20000; i++)
+	{
+		const uint64_t key = rng() % 500;
+		if (rng() % 2 == 0)
+		{
+			const auto value = std::to_string(i);
+			REQUIRE(map.emplace(key, value).second == expected.emplace(key, value).second);
+		}
+		else
+		{
+			REQUIRE(map.erase(key) == expected.erase(key));
+		}
+	}
+
+	REQUIRE(map.size() == expected.size());
+	for (const auto &[key, value] : expected)
+	{
+		REQUIRE(map.find(key)->second == value);
+	}
+
+	REQUIRE(map.erase_if([](const auto &entry) { return entry.first % 3 == 0; }) ==
+	        std::erase_if(expected, [](const auto &entry) { return entry.first % 3 == 0; }));
+	REQUIRE(map.size() == expected.size());
+
+	for (auto it = map.begin(); it != map.end();)
+	{
+		it = map.erase(it);
+	}
+	REQUIRE(map.empty());
+}
+
+TEST_CASE("FlatMap lookups", "[flat_map][!benchmark]")
+{
+	const auto keys = random_hashes(100000);
+
+	Quasar::FlatMap<Quasar::Hash, size_t> flat;
+	std::unordered_map<Quasar::Hash, size_t> node;
+	std::unordered_map<Quasar::Hash, size_t, BytewiseHash> baseline;
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		flat.emplace(keys[i], i);
+		node.emplace(keys[i], i);
+		baseline.emplace(keys[i], i);
+	}
+
+	BENCHMARK("FlatMap find")
+	{
+		size_t sum = 0;
+		for (const auto &key : keys)
+		{
+			sum += flat.find(key)->second;
+		}
+		return sum;
+	};
+
+	BENCHMARK("std::unordered_map find")
+	{
+		size_t sum = 0;
+		for (const auto &key : keys)
+		{
+			sum += node.find(key)->second;
+		}
+		return sum;
+	};
+
+	BENCHMARK("std::unordered_map find, bytewise hash")
+	{
+		size_t sum = 0;
+		for (const auto &key : keys)
+		{
+			sum += baseline.find(key)->second;
+		}
+		return sum;
+	};
+
+	BENCHMARK("FlatMap insert")
+	{
+		Quasar::FlatMap<Quasar::Hash, size_t> map;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			map.emplace(keys[i], i);
+		}
+		return map.size();
+	};
+
+	BENCHMARK("std::unordered_map insert")
+	{
+		std::unordered_map<Quasar::Hash, size_t> map;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			map.emplace(keys[i], i);
+		}
+		return map.size();
+	};
+
+	BENCHMARK("std::unordered_map insert, bytewise hash")
+	{
+		std::unordered_map<Quasar::Hash, size_t, BytewiseHash> map;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			map.emplace(keys[i], i);
+		}
+		return map.size();
+	};
+}
@@ -0,0 +1,273 @@
+#include "inbound_pipeline.h"
+#include "crypto.h"
+#include "exception.h"
+
+namespace Quasar
+{
+
+InboundPipeline::InboundPipeline(const Settings::Inbound &settings, const Settings::Crypto &crypto_settings,
+                                 std::shared_ptr<EventQueue> event_queue, std::shared_ptr<Keystore> keystore,
+                                 std::shared_ptr<CertificateVerifier> verifier, std::shared_ptr<spdlog::logger> logger)
+    : m_event_queue(std::move(event_queue)), m_keystore(std::move(keystore)), m_verifier(std::move(verifier)),
+      m_logger(std::move(logger)), m_received(crypto_settings.message_cache_size()), m_round(0), m_next_sequence(0),
+      m_next_hand_off(0), m_in_flight(0), m_capacity(settings.queue_size()), m_stopped(false), m_stats()
+{
+	for (size_t i = 0; i < settings.workers(); i++)
+	{
+		m_workers.emplace_back([this] { run_worker(); });
+	}
+}
+
+InboundPipeline::~InboundPipeline()
+{
+	stop();
+}
+
+void InboundPipeline::init()
+{
+	// the pipeline is the only source of message events, so each one that is processed frees a slot
+	m_event_queue->append_listener<MessageEvent>(
+	    [self = shared_from_this()](const MessageEvent &) { self->processed(); });
+
+	m_event_queue->append_listener<AdvanceEvent>(
+	    [self = shared_from_this()](const AdvanceEvent &event) { self->m_round.store(event.round); });
+}
+
+void InboundPipeline::stop()
+{
+	{
+		std::lock_guard lock{m_mutex};
+		m_stopped = true;
+	}
+	m_items_cv.notify_all();
+	m_space_cv.notify_all();
+
+	for (auto &worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+}
+
+bool InboundPipeline::submit(Frame frame)
+{
+	return submit(std::variant<Frame, MessagePtr>{std::move(frame)});
+}
+
+bool InboundPipeline::submit(MessagePtr message)
+{
+	return submit(std::variant<Frame, MessagePtr>{std::move(message)});
+}
+
+bool InboundPipeline::submit(std::variant<Frame, MessagePtr> payload)
+{
+	{
+		std::unique_lock lock{m_mutex};
+		m_space_cv.wait(lock, [this] { return m_stopped || m_in_flight < m_capacity; });
+		if (m_stopped)
+		{
+			return false;
+		}
+
+		m_items.push_back({m_next_sequence++, std::move(payload)});
+		m_in_flight++;
+		m_stats.received++;
+		m_stats.depths.parse++;
+	}
+	m_items_cv.notify_one();
+	return true;
+}
+
+InboundPipeline::Stats InboundPipeline::stats() const
+{
+	std::lock_guard lock{m_mutex};
+	return m_stats;
+}
+
+void InboundPipeline::run_worker()
+{
+	while (true)
+	{
+		Item item;
+		{
+			std::unique_lock lock{m_mutex};
+			m_items_cv.wait(lock, [this] { return m_stopped || !m_items.empty(); });
+			if (m_stopped)
+			{
+				return;
+			}
+
+			item = std::move(m_items.front());
+			m_items.pop_front();
+			m_stats.depths.parse--;
+			m_stats.depths.verify++;
+		}
+
+		auto delivery = process(std::move(item.payload));
+		hand_off(item.sequence, std::move(delivery));
+	}
+}
+
+std::optional<MessageEvent> InboundPipeline::process(std::variant<Frame, MessagePtr> payload)
+{
+	MessagePtr message;
+	if (auto *frame = std::get_if<Frame>(&payload))
+	{
+		message = make_message(frame->size());
+		if (!message->ParseFromArray(frame->data(), (int)frame->size()))
+		{
+			m_logger->warn("received a malformed message");
+			std::lock_guard lock{m_mutex};
+			m_stats.malformed++;
+			return std::nullopt;
+		}
+	}
+	else
+	{
+		message = std::move(std::get<MessagePtr>(payload));
+	}
+
+	if (is_obsolete(message->data()))
+	{
+		std::lock_guard lock{m_mutex};
+		m_stats.obsolete++;
+		return std::nullopt;
+	}
+
+	Signature sig{message->signature()};
+
+	if (!m_keystore->has_public_key(sig.signer()))
+	{
+		m_logger->warn("public key with ID {:.8} not found", sig.signer().to_hex_string());
+		std::lock_guard lock{m_mutex};
+		m_stats.rejected++;
+		return std::nullopt;
+	}
+
+	const auto signed_data = Crypto::signed_bytes(message->data());
+
+	// peers relay the same messages, so copies that were already received are dropped before their signature is
+	// checked. The digest covers the whole message and its signature: the signature of a vote, an acknowledgement or
+	// a wish leaves out some fields, and a relayed copy with those altered would otherwise shadow the real message.
+	// Other messages are signed in full, so their signed bytes are reused.
+	const auto &data = message->data();
+	std::string serialized;
+	if (data.has_vote() || data.has_batch_ack() || data.has_wish())
+	{
+		serialized = data.SerializeAsString();
+	}
+	auto &hash_fn = Crypto::hasher();
+	hash_fn.update(serialized.empty() ? signed_data : serialized);
+	hash_fn.update(sig.signer().data(), sig.signer().size());
+	hash_fn.update(sig.data().data(), sig.data().size());
+	Hash digest{};
+	hash_fn.final(digest.data());
+
+	if (!m_received.insert(digest))
+	{
+		m_logger->debug("dropped duplicate message from {:.8}", sig.signer().to_hex_string());
+		std::lock_guard lock{m_mutex};
+		m_stats.duplicates++;
+		return std::nullopt;
+	}
+
+	bool valid = false;
+	try
+	{
+		valid = m_verifier->verify_signature(sig, signed_data);
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("could not verify message from {:.8}: {}", sig.signer().to_hex_string(), e.what());
+	}
+
+	if (!valid)
+	{
+		m_logger->warn("message received with invalid signature");
+		std::lock_guard lock{m_mutex};
+		m_stats.rejected++;
+		return std::nullopt;
+	}
+
+	// the event shares ownership of the message's arena, so the message data is not copied
+	return MessageEvent{sig, MessageDataPtr{message, &message->data()}};
+}
+
+bool InboundPipeline::is_obsolete(const Proto::MessageData &data) const
+{
+	// the round is read from the unverified message, which is fine as long as a forged round only makes the forger's
+	// own message be dropped; the consensus thread checks the rounds again after verification
+	const auto round = m_round.load();
+	switch (data.data_case())
+	{
+	case Proto::MessageData::kVote:
+		// votes of older senders have no round
+		return data.vote().round() != 0 && data.vote().round() < round;
+	case Proto::MessageData::kWish:
+		return data.wish().round() <= round;
+	case Proto::MessageData::kAdvance:
+		return data.advance().wish().round() <= round;
+	default:
+		// proposals are kept, as they carry the blocks that later proposals build on
+		return false;
+	}
+}
+
+void InboundPipeline::hand_off(uint64_t sequence, std::optional<MessageEvent> delivery)
+{
+	std::lock_guard lock{m_mutex};
+	m_stats.depths.verify--;
+
+	if (sequence != m_next_hand_off)
+	{
+		m_reorder.emplace(sequence, std::move(delivery));
+		m_stats.depths.reorder++;
+		return;
+	}
+
+	// hand off this message and every later one that already finished, without gaps
+	size_t freed = 0;
+	while (true)
+	{
+		if (delivery)
+		{
+			m_event_queue->enqueue(std::move(*delivery));
+			m_stats.delivered++;
+			m_stats.depths.dispatch++;
+		}
+		else
+		{
+			freed++;
+		}
+		m_next_hand_off++;
+
+		auto it = m_reorder.find(m_next_hand_off);
+		if (it == m_reorder.end())
+		{
+			break;
+		}
+		delivery = std::move(it->second);
+		m_reorder.erase(it);
+		m_stats.depths.reorder--;
+	}
+
+	if (freed > 0)
+	{
+		m_in_flight -= freed;
+		m_space_cv.notify_all();
+	}
+}
+
+void InboundPipeline::processed()
+{
+	{
+		std::lock_guard lock{m_mutex};
+		m_stats.depths.dispatch--;
+		m_in_flight--;
+	}
+	m_space_cv.notify_one();
+}
+
+} // namespace Quasar
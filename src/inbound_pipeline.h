@@ -0,0 +1,115 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "certificate_verifier.h"
+#include "digest_cache.h"
+#include "event.h"
+#include "flat_map.h"
+#include "keystore.h"
+#include "network.h"
+#include "settings.h"
+
+namespace Quasar
+{
+
+// InboundPipeline moves received messages from the network to the consensus thread in stages:
+// the network thread submits messages, a pool of workers parses them and verifies their signatures, and the
+// verified messages are handed to the event queue in the order in which they were submitted.
+// At most queue_size messages are in flight between submission and their processing on the consensus thread;
+// submit blocks while the limit is reached, which pushes back on the network instead of dropping messages.
+class InboundPipeline : public std::enable_shared_from_this<InboundPipeline>
+{
+  public:
+	// Depths counts the messages that are currently in each stage.
+	struct Depths
+	{
+		size_t parse;    // submitted, waiting for a worker
+		size_t verify;   // taken by a worker
+		size_t reorder;  // verified, waiting for an earlier message to be handed off
+		size_t dispatch; // handed to the event queue, waiting for the consensus thread
+	};
+
+	struct Stats
+	{
+		uint64_t received;
+		uint64_t malformed;
+		// obsolete counts messages for rounds that have passed, which are dropped before their signature is checked
+		uint64_t obsolete;
+		uint64_t duplicates;
+		uint64_t rejected;
+		uint64_t delivered;
+		Depths depths;
+	};
+
+	InboundPipeline(const Settings::Inbound &settings, const Settings::Crypto &crypto_settings,
+	                std::shared_ptr<EventQueue> event_queue, std::shared_ptr<Keystore> keystore,
+	                std::shared_ptr<CertificateVerifier> verifier, std::shared_ptr<spdlog::logger> logger);
+	~InboundPipeline();
+
+	// init registers with the event queue to learn when the consensus thread has processed a message, and which
+	// round it is in
+	void init();
+
+	// stop makes pending and future calls to submit return false and joins the workers
+	void stop();
+
+	// submit queues a message for verification, and returns false if the pipeline is stopped.
+	// It must not be called from the consensus thread, which it may wait for.
+	bool submit(Frame frame);
+	bool submit(MessagePtr message);
+
+	Stats stats() const;
+
+  private:
+	struct Item
+	{
+		uint64_t sequence;
+		std::variant<Frame, MessagePtr> payload;
+	};
+
+	bool submit(std::variant<Frame, MessagePtr> payload);
+	void run_worker();
+	std::optional<MessageEvent> process(std::variant<Frame, MessagePtr> payload);
+	bool is_obsolete(const Proto::MessageData &data) const;
+	void hand_off(uint64_t sequence, std::optional<MessageEvent> delivery);
+	void processed();
+
+	std::shared_ptr<EventQueue> m_event_queue;
+	std::shared_ptr<Keystore> m_keystore;
+	std::shared_ptr<CertificateVerifier> m_verifier;
+	std::shared_ptr<spdlog::logger> m_logger;
+
+	// received holds digests of recent messages to drop copies before their signature is checked
+	DigestCache m_received;
+	// round is the current round of the consensus thread
+	std::atomic<Round> m_round;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_items_cv;
+	std::condition_variable m_space_cv;
+	std::deque<Item> m_items;
+	// reorder holds the results of messages that finished before an earlier one, by sequence number;
+	// rejected messages are kept as nullopt so that the hand-off can move past them
+	FlatMap<uint64_t, std::optional<MessageEvent>> m_reorder;
+	uint64_t m_next_sequence;
+	uint64_t m_next_hand_off;
+	size_t m_in_flight;
+	size_t m_capacity;
+	bool m_stopped;
+	Stats m_stats;
+
+	std::vector<std::thread> m_workers;
+};
+
+} // namespace Quasar
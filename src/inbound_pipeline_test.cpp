@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <botan/ecdsa.h>
+#include <botan/system_rng.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <thread>
+
+#include "inbound_pipeline.h"
+
+namespace
+{
+
+struct Fixture
+{
+	Fixture()
+	    : event_queue(std::make_shared<Quasar::EventQueue>()),
+	      keystore(std::make_shared<Quasar::Keystore>(
+	          std::make_shared<Botan::ECDSA_PrivateKey>(Botan::system_rng(), Botan::EC_Group{"secp256r1"}))),
+	      verifier(std::make_shared<Quasar::CertificateVerifier>(keystore, settings.crypto())),
+	      pipeline(std::make_shared<Quasar::InboundPipeline>(settings.inbound(), settings.crypto(), event_queue,
+	                                                         keystore, verifier,
+	                                                         spdlog::null_logger_mt("inbound_pipeline_test")))
+	{
+		keystore->add_public_key(keystore->identity(), keystore->private_key());
+		pipeline->init();
+	}
+
+	~Fixture()
+	{
+		pipeline->stop();
+		spdlog::drop("inbound_pipeline_test");
+	}
+
+	// wait_idle waits until the workers have handled every submitted message
+	Quasar::InboundPipeline::Stats wait_idle() const
+	{
+		while (true)
+		{
+			auto stats = pipeline->stats();
+			auto handled = stats.malformed + stats.obsolete + stats.duplicates + stats.rejected + stats.delivered;
+			if (handled == stats.received)
+			{
+				return stats;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	Quasar::Settings settings;
+	std::shared_ptr<Quasar::EventQueue> event_queue;
+	std::shared_ptr<Quasar::Keystore> keystore;
+	std::shared_ptr<Quasar::CertificateVerifier> verifier;
+	std::shared_ptr<Quasar::InboundPipeline> pipeline;
+};
+
+Quasar::MessagePtr make_wish(const Quasar::Identity &signer, Quasar::Round round)
+{
+	auto msg = Quasar::make_message();
+	msg->mutable_data()->mutable_wish()->set_round(round);
+	Quasar::Signature{{}, signer}.to_proto(msg->mutable_signature());
+	return msg;
+}
+
+} // namespace
+
+TEST_CASE("InboundPipeline drops malformed and unsigned messages", "[inbound_pipeline]")
+{
+	Fixture fixture;
+
+	const std::string garbage(2, '\xff');
+	REQUIRE(fixture.pipeline->submit(Quasar::Frame{garbage.data(), garbage.size()}));
+	REQUIRE(fixture.pipeline->submit(make_wish(Quasar::Identity::from_hex_string("01"), 1)));
+	REQUIRE(fixture.pipeline->submit(make_wish(fixture.keystore->identity(), 1)));
+
+	auto stats = fixture.wait_idle();
+	REQUIRE(stats.received == 3);
+	REQUIRE(stats.malformed == 1);
+	REQUIRE(stats.rejected == 2);
+	REQUIRE(stats.delivered == 0);
+	REQUIRE(stats.depths.parse == 0);
+	REQUIRE(stats.depths.verify == 0);
+	REQUIRE(stats.depths.reorder == 0);
+	REQUIRE(stats.depths.dispatch == 0);
+}
+
+TEST_CASE("InboundPipeline drops copies before verifying them", "[inbound_pipeline]")
+{
+	Fixture fixture;
+
+	for (int i = 0; i < 3; i++)
+	{
+		REQUIRE(fixture.pipeline->submit(make_wish(fixture.keystore->identity(), 7)));
+	}
+
+	auto stats = fixture.wait_idle();
+	REQUIRE(stats.rejected == 1);
+	REQUIRE(stats.duplicates == 2);
+}
+
+TEST_CASE("InboundPipeline does not let an altered copy of a vote shadow the vote", "[inbound_pipeline]")
+{
+	Fixture fixture;
+
+	// the signature of a vote covers only the block hash, so a relay can alter its share and keep the signature
+	const auto sig = fixture.keystore->sign("block");
+	auto make_vote = [&](const std::string &share) {
+		auto msg = Quasar::make_message();
+		msg->mutable_data()->mutable_vote()->set_block_hash("block");
+		msg->mutable_data()->mutable_vote()->set_share(share);
+		sig.to_proto(msg->mutable_signature());
+		return msg;
+	};
+
+	REQUIRE(fixture.pipeline->submit(make_vote("altered")));
+	REQUIRE(fixture.pipeline->submit(make_vote("share")));
+
+	auto stats = fixture.wait_idle();
+	REQUIRE(stats.duplicates == 0);
+	REQUIRE(stats.delivered == 2);
+}
+
+TEST_CASE("InboundPipeline refuses messages once stopped", "[inbound_pipeline]")
+{
+	Fixture fixture;
+	fixture.pipeline->stop();
+
+	REQUIRE_FALSE(fixture.pipeline->submit(make_wish(fixture.keystore->identity(), 1)));
+}
+
+TEST_CASE("InboundPipeline drops messages of past rounds before verification", "[inbound_pipeline]")
+{
+	Fixture fixture;
+	fixture.event_queue->dispatch(Quasar::AdvanceEvent{5, false});
+
+	auto make_vote = [&](Quasar::Round round) {
+		auto msg = Quasar::make_message();
+		msg->mutable_data()->mutable_vote()->set_block_hash(std::to_string(round));
+		msg->mutable_data()->mutable_vote()->set_round(round);
+		Quasar::Signature{{}, fixture.keystore->identity()}.to_proto(msg->mutable_signature());
+		return msg;
+	};
+
+	REQUIRE(fixture.pipeline->submit(make_wish(fixture.keystore->identity(), 5)));
+	REQUIRE(fixture.pipeline->submit(make_wish(fixture.keystore->identity(), 6)));
+	REQUIRE(fixture.pipeline->submit(make_vote(4)));
+	REQUIRE(fixture.pipeline->submit(make_vote(5)));
+	// votes without a round are always verified
+	REQUIRE(fixture.pipeline->submit(make_vote(0)));
+
+	auto stats = fixture.wait_idle();
+	REQUIRE(stats.obsolete == 2);
+	REQUIRE(stats.rejected == 3);
+}
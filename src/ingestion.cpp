@@ -0,0 +1,283 @@
+#include <fmt/format.h>
+#include <zmq_addon.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <tuple>
+
+#include "exception.h"
+#include "ingestion.h"
+
+namespace Quasar
+{
+
+namespace
+{
+
+// MAX_CLIENTS is how many clients are tracked before the least recently seen one is forgotten, which has most likely
+// refilled its bucket
+const size_t MAX_CLIENTS = 1 << 16;
+
+} // namespace
+
+TokenBucket::TokenBucket(double rate, double burst, Clock::time_point now)
+    : m_rate(rate), m_burst(burst), m_tokens(burst), m_updated(now)
+{
+}
+
+bool TokenBucket::take(double tokens, Clock::time_point now)
+{
+	m_tokens = available(now);
+	m_updated = std::max(m_updated, now);
+	if (tokens > m_tokens)
+	{
+		return false;
+	}
+	m_tokens -= tokens;
+	return true;
+}
+
+double TokenBucket::available(Clock::time_point now) const
+{
+	const auto elapsed = std::chrono::duration<double>(now - m_updated).count();
+	return std::min(m_burst, m_tokens + std::max(0.0, elapsed) * m_rate);
+}
+
+Ingestion::Ingestion(int port, const Settings::Ingestion &settings, std::shared_ptr<Mempool> mempool,
+                     std::shared_ptr<spdlog::logger> logger)
+    : m_settings(settings), m_mempool(std::move(mempool)), m_logger(std::move(logger)), m_context(1),
+      m_socket(m_context, zmq::socket_type::router), m_stopped(false), m_workers_stopped(false), m_stats()
+{
+	// replies to clients that are gone are dropped rather than held
+	m_socket.set(zmq::sockopt::linger, 0);
+	// a submission larger than the burst is throttled anyway, so larger messages are not buffered at all; ZMQ drops
+	// the connection of a client that sends one. Slightly larger submissions still get a reply.
+	const auto max_message_size =
+	    std::min<size_t>(settings.burst() + settings.max_transaction_bytes(), std::numeric_limits<int>::max());
+	m_socket.set(zmq::sockopt::maxmsgsize, (int64_t)max_message_size);
+	m_socket.bind(fmt::format("tcp://*:{}", port));
+
+	for (size_t i = 0; i < settings.workers(); i++)
+	{
+		m_workers.emplace_back([this] { run_worker(); });
+	}
+	// the socket is only used by the receiver thread from now on, as ZMQ sockets are not thread-safe
+	m_receiver = std::thread([this] { run_receiver(); });
+}
+
+Ingestion::~Ingestion()
+{
+	m_stopped = true;
+	m_receiver_reactor.wake();
+	m_receiver.join();
+
+	{
+		std::lock_guard lock{m_mutex};
+		m_workers_stopped = true;
+	}
+	m_items_cv.notify_all();
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+Ingestion::Stats Ingestion::stats() const
+{
+	std::lock_guard lock{m_mutex};
+	return m_stats;
+}
+
+void Ingestion::run_receiver()
+{
+	const auto fd = m_socket.get(zmq::sockopt::fd);
+	m_receiver_reactor.add(fd, [this] { receive_pending(); }, true);
+	receive_pending();
+
+	while (!m_stopped)
+	{
+		m_receiver_reactor.poll();
+	}
+}
+
+void Ingestion::receive_pending()
+{
+	// the ZMQ file descriptor is edge-triggered, so everything that is queued has to be received
+	while (m_socket.get(zmq::sockopt::events) & ZMQ_POLLIN)
+	{
+		receive_submission();
+	}
+}
+
+void Ingestion::receive_submission()
+{
+	m_parts.clear();
+	if (!zmq::recv_multipart(m_socket, std::back_inserter(m_parts), zmq::recv_flags::dontwait))
+	{
+		return;
+	}
+
+	// the ROUTER socket prefixes the routing ID of the client, and REQ clients add an empty delimiter
+	if (m_parts.size() < 2)
+	{
+		std::lock_guard lock{m_mutex};
+		m_stats.submissions++;
+		m_stats.malformed++;
+		return;
+	}
+
+	reply(admit(m_parts.front(), m_parts.back()));
+}
+
+Proto::SubmissionReply::Status Ingestion::admit(const zmq::message_t &client, zmq::message_t &body)
+{
+	const auto now = TokenBucket::Clock::now();
+	const auto size = body.size();
+
+	// a client can open any number of connections, each with a routing ID of its own, so it is known by its address
+	std::string address;
+	try
+	{
+		address = body.gets("Peer-Address");
+	}
+	catch (const zmq::error_t &)
+	{
+		// transports without addresses, such as inproc, fall back to the connection
+		address = client.to_string();
+	}
+	const auto allowed = bucket(address, now).take((double)size, now);
+
+	std::unique_lock lock{m_mutex};
+	m_stats.submissions++;
+	if (!allowed)
+	{
+		m_stats.throttled++;
+		return Proto::SubmissionReply::THROTTLED;
+	}
+	// the size of the submission is a little more than that of its transactions, which errs on the side of rejecting
+	if (m_mempool->free_bytes() < size)
+	{
+		m_stats.full++;
+		return Proto::SubmissionReply::FULL;
+	}
+	if (m_items.size() >= m_settings.queue_size())
+	{
+		m_stats.busy++;
+		return Proto::SubmissionReply::BUSY;
+	}
+
+	m_items.push_back(std::move(body));
+	lock.unlock();
+	m_items_cv.notify_one();
+	return Proto::SubmissionReply::QUEUED;
+}
+
+TokenBucket &Ingestion::bucket(const std::string &client, TokenBucket::Clock::time_point now)
+{
+	if (auto it = m_buckets.find(client); it != m_buckets.end())
+	{
+		m_clients.splice(m_clients.begin(), m_clients, it->second);
+		return it->second->second;
+	}
+
+	if (m_clients.size() >= MAX_CLIENTS)
+	{
+		m_buckets.erase(m_clients.back().first);
+		m_clients.pop_back();
+	}
+	m_clients.emplace_front(std::piecewise_construct, std::forward_as_tuple(client),
+	                        std::forward_as_tuple((double)m_settings.rate(), (double)m_settings.burst(), now));
+	m_buckets.emplace(client, m_clients.begin());
+	return m_clients.front().second;
+}
+
+void Ingestion::reply(Proto::SubmissionReply::Status status)
+{
+	Proto::SubmissionReply reply;
+	reply.set_status(status);
+	const auto serialized = reply.SerializeAsString();
+
+	// the reply goes back with the envelope of the submission; a ROUTER socket drops it if the client is gone
+	for (size_t i = 0; i + 1 < m_parts.size(); i++)
+	{
+		m_socket.send(m_parts[i], zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+	}
+	m_socket.send(zmq::buffer(serialized), zmq::send_flags::dontwait);
+}
+
+void Ingestion::run_worker()
+{
+	while (true)
+	{
+		zmq::message_t body;
+		{
+			std::unique_lock lock{m_mutex};
+			m_items_cv.wait(lock, [this] { return m_workers_stopped || !m_items.empty(); });
+			if (m_workers_stopped)
+			{
+				return;
+			}
+
+			body = std::move(m_items.front());
+			m_items.pop_front();
+		}
+
+		process(body);
+	}
+}
+
+void Ingestion::process(const zmq::message_t &body)
+{
+	// parsing the payload checks its offsets and hashes its transactions
+	std::optional<Payload> payload;
+	Proto::Payload proto;
+	if (proto.ParseFromArray(body.data(), (int)body.size()))
+	{
+		try
+		{
+			payload.emplace(std::move(proto));
+		}
+		catch (const Exception &e)
+		{
+			m_logger->debug("received a malformed submission: {}", e.what());
+		}
+	}
+
+	if (!payload)
+	{
+		std::lock_guard lock{m_mutex};
+		m_stats.malformed++;
+		return;
+	}
+
+	uint64_t invalid = 0;
+	uint64_t added = 0;
+	uint64_t rejected = 0;
+	for (auto transaction : *payload)
+	{
+		const auto size = transaction.data().size();
+		if (size == 0 || size > m_settings.max_transaction_bytes())
+		{
+			invalid++;
+			continue;
+		}
+
+		if (m_mempool->add(Transaction{transaction}))
+		{
+			added++;
+		}
+		else
+		{
+			rejected++;
+		}
+	}
+
+	std::lock_guard lock{m_mutex};
+	m_stats.invalid += invalid;
+	m_stats.added += added;
+	m_stats.rejected += rejected;
+}
+
+} // namespace Quasar
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <zmq.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mempool.h"
+#include "quasar.pb.h"
+#include "reactor.h"
+#include "settings.h"
+
+namespace Quasar
+{
+
+// TokenBucket limits how many bytes a client may submit: it holds up to burst tokens and gains rate tokens per second.
+// A request for more tokens than the bucket holds is refused without taking any.
+class TokenBucket
+{
+  public:
+	using Clock = std::chrono::steady_clock;
+
+	TokenBucket(double rate, double burst, Clock::time_point now);
+
+	bool take(double tokens, Clock::time_point now);
+
+  private:
+	double available(Clock::time_point now) const;
+
+	double m_rate;
+	double m_burst;
+	double m_tokens;
+	Clock::time_point m_updated;
+};
+
+// Ingestion accepts transactions from clients on a ZMQ ROUTER socket of its own. A client sends a serialized Payload
+// of transactions, and gets a SubmissionReply as soon as the submission is admitted or turned away.
+// Admission runs on the receiver thread and looks only at the size of a submission: it is turned away if the client
+// exceeds its rate limit, if the mempool has no room for it or if too many submissions wait for the workers. Admitted
+// submissions are parsed, hashed and validated on a pool of workers, which add their transactions to the mempool.
+class Ingestion
+{
+  public:
+	struct Stats
+	{
+		// submissions counts everything that was received; throttled, full and busy count those that were turned
+		// away, and malformed those that could not be parsed
+		uint64_t submissions;
+		uint64_t throttled;
+		uint64_t full;
+		uint64_t busy;
+		uint64_t malformed;
+		// invalid counts transactions that failed validation, and rejected those that the mempool did not take
+		uint64_t invalid;
+		uint64_t added;
+		uint64_t rejected;
+	};
+
+	Ingestion(int port, const Settings::Ingestion &settings, std::shared_ptr<Mempool> mempool,
+	          std::shared_ptr<spdlog::logger> logger);
+	~Ingestion();
+
+	Stats stats() const;
+
+  private:
+	void run_receiver();
+	void receive_pending();
+	void receive_submission();
+	Proto::SubmissionReply::Status admit(const zmq::message_t &client, zmq::message_t &body);
+	// bucket returns the rate limit of a client, and forgets the least recently seen client if too many are tracked
+	TokenBucket &bucket(const std::string &client, TokenBucket::Clock::time_point now);
+	void reply(Proto::SubmissionReply::Status status);
+
+	void run_worker();
+	void process(const zmq::message_t &body);
+
+	const Settings::Ingestion m_settings;
+	std::shared_ptr<Mempool> m_mempool;
+	std::shared_ptr<spdlog::logger> m_logger;
+
+	zmq::context_t m_context;
+	zmq::socket_t m_socket;
+	Reactor m_receiver_reactor;
+	std::thread m_receiver;
+	std::atomic<bool> m_stopped;
+
+	// parts holds the frames of the submission being received; all but the last are the envelope of the reply
+	std::vector<zmq::message_t> m_parts;
+	// clients holds the rate limit of each client by its address, most recently seen first, and buckets indexes it;
+	// only the receiver thread uses them
+	std::list<std::pair<std::string, TokenBucket>> m_clients;
+	std::unordered_map<std::string, std::list<std::pair<std::string, TokenBucket>>::iterator> m_buckets;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_items_cv;
+	std::deque<zmq::message_t> m_items;
+	bool m_workers_stopped;
+	Stats m_stats;
+
+	std::vector<std::thread> m_workers;
+};
+
+} // namespace Quasar
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+#include <spdlog/sinks/null_sink.h>
+#include <zmq.hpp>
+
+#include <thread>
+
+#include "ingestion.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+std::string make_submission(size_t count, size_t size)
+{
+	std::vector<Quasar::Transaction> transactions;
+	for (size_t i = 0; i < count; i++)
+	{
+		std::vector<Quasar::byte> data(size, Quasar::byte(i));
+		transactions.emplace_back(data);
+	}
+
+	Quasar::Proto::Payload proto;
+	Quasar::Payload{transactions}.to_proto(&proto);
+	return proto.SerializeAsString();
+}
+
+Quasar::Proto::SubmissionReply::Status submit(zmq::socket_t &client, const std::string &submission)
+{
+	client.send(zmq::buffer(submission));
+
+	zmq::message_t response;
+	REQUIRE(client.recv(response));
+	Quasar::Proto::SubmissionReply reply;
+	REQUIRE(reply.ParseFromArray(response.data(), (int)response.size()));
+	return reply.status();
+}
+
+} // namespace
+
+TEST_CASE("TokenBucket refills at its rate up to the burst", "[ingestion]")
+{
+	const auto start = Quasar::TokenBucket::Clock::now();
+	Quasar::TokenBucket bucket{100, 200, start};
+
+	REQUIRE(bucket.take(150, start));
+	// a request for more than is left takes nothing
+	REQUIRE(!bucket.take(100, start));
+	REQUIRE(bucket.take(50, start));
+	REQUIRE(!bucket.take(1, start));
+
+	REQUIRE(bucket.take(100, start + 1s));
+	// the tokens of a long idle time are capped at the burst
+	REQUIRE(!bucket.take(201, start + 60s));
+	REQUIRE(bucket.take(200, start + 60s));
+}
+
+TEST_CASE("Ingestion adds submitted transactions to the mempool", "[ingestion]")
+{
+	auto mempool = std::make_shared<Quasar::ShardedMempool>();
+	auto logger = std::make_shared<spdlog::logger>("ingestion", std::make_shared<spdlog::sinks::null_sink_mt>());
+	Quasar::Ingestion ingestion{8101, Quasar::Settings{}.ingestion(), mempool, logger};
+
+	zmq::context_t context;
+	zmq::socket_t client{context, zmq::socket_type::req};
+	client.connect("tcp://localhost:8101");
+
+	REQUIRE(submit(client, make_submission(10, 32)) == Quasar::Proto::SubmissionReply::QUEUED);
+	// transactions that are too large are dropped, and the others are still added
+	REQUIRE(submit(client, make_submission(2, 100 * 1024)) == Quasar::Proto::SubmissionReply::QUEUED);
+	REQUIRE(submit(client, "not a payload") == Quasar::Proto::SubmissionReply::QUEUED);
+
+	// the workers process the submissions after they are answered
+	auto stats = ingestion.stats();
+	for (int i = 0; i < 100 && stats.added + stats.invalid + stats.malformed < 13; i++)
+	{
+		std::this_thread::sleep_for(10ms);
+		stats = ingestion.stats();
+	}
+
+	REQUIRE(stats.submissions == 3);
+	REQUIRE(stats.added == 10);
+	REQUIRE(stats.invalid == 2);
+	REQUIRE(stats.malformed == 1);
+	REQUIRE(mempool->size() == 10);
+}
+
+TEST_CASE("Ingestion turns away submissions that do not fit and clients over their rate", "[ingestion]")
+{
+	auto mempool = std::make_shared<Quasar::ShardedMempool>(1024 * 1024);
+	auto logger = std::make_shared<spdlog::logger>("ingestion", std::make_shared<spdlog::sinks::null_sink_mt>());
+	// by default, a client may submit 4 MiB at once and 16 MiB per second
+	Quasar::Ingestion ingestion{8102, Quasar::Settings{}.ingestion(), mempool, logger};
+
+	zmq::context_t context;
+	zmq::socket_t first{context, zmq::socket_type::req};
+	zmq::socket_t second{context, zmq::socket_type::req};
+	first.connect("tcp://localhost:8102");
+	second.connect("tcp://localhost:8102");
+
+	// the rejected submission still counts against the rate of its client
+	const auto large = make_submission(48, 64 * 1024);
+	REQUIRE(submit(first, large) == Quasar::Proto::SubmissionReply::FULL);
+	REQUIRE(submit(first, large) == Quasar::Proto::SubmissionReply::THROTTLED);
+
+	// a client is known by its address, so another connection from it shares its bucket
+	REQUIRE(submit(second, large) == Quasar::Proto::SubmissionReply::THROTTLED);
+	REQUIRE(submit(second, make_submission(10, 32)) == Quasar::Proto::SubmissionReply::QUEUED);
+
+	auto stats = ingestion.stats();
+	REQUIRE(stats.submissions == 4);
+	REQUIRE(stats.full == 1);
+	REQUIRE(stats.throttled == 2);
+}
+
+TEST_CASE("Ingestion does not receive messages far larger than the burst", "[ingestion]")
+{
+	auto mempool = std::make_shared<Quasar::ShardedMempool>();
+	auto logger = std::make_shared<spdlog::logger>("ingestion", std::make_shared<spdlog::sinks::null_sink_mt>());
+	// by default, the burst is 4 MiB and a transaction has at most 64 KiB
+	Quasar::Ingestion ingestion{8103, Quasar::Settings{}.ingestion(), mempool, logger};
+
+	zmq::context_t context;
+	zmq::socket_t client{context, zmq::socket_type::req};
+	client.set(zmq::sockopt::rcvtimeo, 200);
+	client.set(zmq::sockopt::linger, 0);
+	client.connect("tcp://localhost:8103");
+
+	// the message exceeds the burst by more than the largest transaction, so the connection is dropped unanswered
+	client.send(zmq::buffer(make_submission(80, 64 * 1024)));
+	zmq::message_t response;
+	REQUIRE(!client.recv(response));
+	REQUIRE(ingestion.stats().submissions == 0);
+}
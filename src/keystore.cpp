@@ -1,14 +1,30 @@
 #include "keystore.h"
 #include "crypto.h"
+#include "exception.h"
+
+#include <botan/system_rng.h>
 
 #include <utility>
 
 namespace Quasar
 {
 
-Keystore::Keystore(std::shared_ptr<Botan::Private_Key> private_key) : m_private_key(std::move(private_key))
+Keystore::Verifier::Verifier(std::shared_ptr<Botan::Public_Key> key)
+    : public_key(std::move(key)), verifier(*public_key, Crypto::SIGNATURE_PADDING)
+{
+	if (auto ec_key = std::dynamic_pointer_cast<Botan::EC_PublicKey>(public_key))
+	{
+		schnorr.emplace(*ec_key);
+	}
+}
+
+Keystore::Keystore(std::shared_ptr<Botan::Private_Key> private_key)
+    : m_private_key(std::move(private_key)),
+      m_ec_private_key(dynamic_cast<const Botan::EC_PrivateKey *>(m_private_key.get())),
+      m_signer(std::make_unique<Botan::PK_Signer>(*m_private_key, Botan::system_rng(), Crypto::SIGNATURE_PADDING))
 {
 	m_identity = Crypto::hash(m_private_key->public_key_bits());
+	m_validators = std::make_shared<const ValidatorSet>(std::vector<Identity>{m_identity});
 }
 
 std::shared_ptr<Botan::Private_Key> Keystore::private_key() const
@@ -23,17 +39,117 @@ const Identity &Keystore::identity() const
 
 std::shared_ptr<Botan::Public_Key> Keystore::find_public_key(const Identity &identity) const
 {
-	auto elem = m_public_keys.find(identity);
-	if (elem == m_public_keys.end())
+	std::shared_lock lock{m_verifiers_mutex};
+	auto elem = m_verifiers.find(identity);
+	if (elem == m_verifiers.end())
 	{
 		return nullptr;
 	}
-	return elem->second;
+	return elem->second->public_key;
+}
+
+bool Keystore::has_public_key(const Identity &identity) const
+{
+	std::shared_lock lock{m_verifiers_mutex};
+	return m_verifiers.contains(identity);
 }
 
 void Keystore::add_public_key(const Identity &identity, const std::shared_ptr<Botan::Public_Key> &public_key)
 {
-	m_public_keys.insert({identity, public_key});
+	auto verifier = std::make_shared<Verifier>(public_key);
+
+	std::unique_lock lock{m_verifiers_mutex};
+	if (!m_verifiers.emplace(identity, std::move(verifier)).second)
+	{
+		return;
+	}
+
+	auto identities = m_validators->identities();
+	identities.push_back(identity);
+	m_validators = std::make_shared<const ValidatorSet>(std::move(identities));
+}
+
+std::shared_ptr<const ValidatorSet> Keystore::validators() const
+{
+	std::shared_lock lock{m_verifiers_mutex};
+	return m_validators;
+}
+
+Signature Keystore::sign(const std::string &message) const
+{
+	std::lock_guard lock{m_signer_mutex};
+	return Crypto::sign(message, *m_signer, m_identity);
+}
+
+bool Keystore::verify(const Signature &signature, const std::string &message) const
+{
+	auto verifier = find_verifier(signature.signer());
+
+	std::lock_guard lock{verifier->mutex};
+	return Crypto::verify(signature, message, verifier->verifier);
+}
+
+Schnorr::Share Keystore::sign_share(const std::string &message) const
+{
+	if (m_ec_private_key == nullptr)
+	{
+		throw QUASAR_EXCEPTION("Schnorr signatures require an EC key, but the private key is {}",
+		                       m_private_key->algo_name());
+	}
+	return Schnorr::sign(message, *m_ec_private_key, Botan::system_rng());
+}
+
+bool Keystore::verify_share(const Identity &signer, const Schnorr::Share &share, const std::string &message) const
+{
+	auto verifier = find_verifier(signer);
+	return verifier->schnorr && Schnorr::verify(share, message, *verifier->schnorr);
+}
+
+Certificate Keystore::aggregate(std::vector<Identity> signers, std::span<const Schnorr::Share> shares,
+                                const std::string &message) const
+{
+	std::vector<std::shared_ptr<Verifier>> holders;
+	auto keys = find_schnorr_keys(signers, holders);
+	return Certificate{std::move(signers), Schnorr::aggregate(shares, keys, message)};
+}
+
+bool Keystore::verify_aggregate(const Certificate &cert, const std::string &message) const
+{
+	std::vector<std::shared_ptr<Verifier>> holders;
+	auto keys = find_schnorr_keys(cert.signers(), holders);
+	return Schnorr::verify_aggregate(cert.aggregate(), keys, message);
+}
+
+std::shared_ptr<Keystore::Verifier> Keystore::find_verifier(const Identity &identity) const
+{
+	std::shared_lock lock{m_verifiers_mutex};
+	auto elem = m_verifiers.find(identity);
+	if (elem == m_verifiers.end())
+	{
+		throw QUASAR_EXCEPTION_KIND(Exception::Kind::NOT_FOUND, "public key for identity {:.8} not found",
+		                            identity.to_hex_string());
+	}
+	return elem->second;
+}
+
+std::vector<const Schnorr::PublicKey *> Keystore::find_schnorr_keys(
+    std::span<const Identity> signers, std::vector<std::shared_ptr<Verifier>> &holders) const
+{
+	std::vector<const Schnorr::PublicKey *> keys;
+	keys.reserve(signers.size());
+	holders.reserve(signers.size());
+
+	for (const auto &signer : signers)
+	{
+		auto verifier = find_verifier(signer);
+		if (!verifier->schnorr)
+		{
+			throw QUASAR_EXCEPTION("public key for identity {:.8} is not an EC key", signer.to_hex_string());
+		}
+		keys.push_back(&*verifier->schnorr);
+		holders.push_back(std::move(verifier));
+	}
+	return keys;
 }
 
-} // namespace Quasar
\ No newline at end of file
+} // namespace Quasar
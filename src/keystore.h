@@ -2,11 +2,19 @@
 
 #include <botan/pubkey.h>
 
+#include <mutex>
+#include <shared_mutex>
+
+#include "flat_map.h"
+#include "schnorr.h"
 #include "types.h"
 
 namespace Quasar
 {
 
+// Keystore holds the local private key and the public keys of all known identities.
+// Signer and verifier objects are created once per key and reused, so that the key setup and the precomputation
+// Botan performs for a key are not repeated for every message. All methods are thread-safe.
 class Keystore
 {
   public:
@@ -14,12 +22,63 @@ class Keystore
 	std::shared_ptr<Botan::Private_Key> private_key() const;
 	const Identity &identity() const;
 	std::shared_ptr<Botan::Public_Key> find_public_key(const Identity &identity) const;
+	bool has_public_key(const Identity &identity) const;
 	void add_public_key(const Identity &identity, const std::shared_ptr<Botan::Public_Key> &public_key);
 
+	// validators returns the local identity and all identities with a public key, which is the validator set
+	// that certificates are encoded against. The returned set is a snapshot and is not affected by later changes.
+	std::shared_ptr<const ValidatorSet> validators() const;
+
+	// sign signs the message with the local private key.
+	Signature sign(const std::string &message) const;
+
+	// verify checks the signature with the public key of its signer.
+	// Throws an exception of kind NOT_FOUND if the signer is unknown.
+	bool verify(const Signature &signature, const std::string &message) const;
+
+	// sign_share creates a Schnorr signature share with the local private key, which must be an EC key.
+	Schnorr::Share sign_share(const std::string &message) const;
+
+	// verify_share checks a Schnorr signature share with the public key of the signer.
+	// Throws an exception of kind NOT_FOUND if the signer is unknown.
+	bool verify_share(const Identity &signer, const Schnorr::Share &share, const std::string &message) const;
+
+	// aggregate combines the shares of the signers into an aggregate certificate; signers must be sorted.
+	Certificate aggregate(std::vector<Identity> signers, std::span<const Schnorr::Share> shares,
+	                      const std::string &message) const;
+
+	// verify_aggregate checks all signatures of an aggregate certificate at once.
+	// Throws an exception of kind NOT_FOUND if a signer is unknown.
+	bool verify_aggregate(const Certificate &cert, const std::string &message) const;
+
   private:
-	std::unordered_map<Identity, std::shared_ptr<Botan::Public_Key>> m_public_keys;
+	// A PK_Verifier keeps state between update and check_signature, so each one is guarded by its own mutex.
+	// This lets signatures of different signers be verified in parallel.
+	struct Verifier
+	{
+		explicit Verifier(std::shared_ptr<Botan::Public_Key> key);
+
+		std::shared_ptr<Botan::Public_Key> public_key;
+		std::mutex mutex;
+		Botan::PK_Verifier verifier;
+		// schnorr is set for EC keys, and is immutable so that it can be used without the mutex
+		std::optional<Schnorr::PublicKey> schnorr;
+	};
+
+	std::shared_ptr<Verifier> find_verifier(const Identity &identity) const;
+	// find_schnorr_keys returns the Schnorr keys of the signers, and keeps their verifiers alive in holders
+	std::vector<const Schnorr::PublicKey *> find_schnorr_keys(std::span<const Identity> signers,
+	                                                          std::vector<std::shared_ptr<Verifier>> &holders) const;
+
+	FlatMap<Identity, std::shared_ptr<Verifier>> m_verifiers;
+	std::shared_ptr<const ValidatorSet> m_validators;
+	mutable std::shared_mutex m_verifiers_mutex;
+
 	std::shared_ptr<Botan::Private_Key> m_private_key;
+	const Botan::EC_PrivateKey *m_ec_private_key;
 	Identity m_identity;
+	std::unique_ptr<Botan::PK_Signer> m_signer;
+	mutable std::mutex m_signer_mutex;
 };
 
 } // namespace Quasar
@@ -3,20 +3,152 @@
 namespace Quasar
 {
 
-void Mempool::add(const Transaction &transaction)
+size_t Mempool::size() const
 {
-	m_tx_queue.push(transaction);
+	return stats().transactions;
 }
 
-std::optional<Transaction> Mempool::next()
+ShardedMempool::ShardedMempool(size_t max_bytes) : m_max_bytes(max_bytes)
 {
-	if (m_tx_queue.empty())
+}
+
+bool ShardedMempool::add(const Transaction &transaction)
+{
+	// claim the room first, so that concurrent adds to other shards cannot overrun the budget together
+	const auto size = transaction.data().size();
+	if (m_bytes.fetch_add(size) + size > m_max_bytes)
+	{
+		m_bytes.fetch_sub(size);
+		m_rejected++;
+		return false;
+	}
+
+	const auto id = short_id(transaction.hash());
+	auto &shard = m_shards[shard_of(id)];
+
+	std::lock_guard lock{shard.mutex};
+	const auto sequence = shard.next_sequence;
+	if (!shard.transactions.emplace(id, Entry{transaction, sequence}).second)
+	{
+		m_bytes.fetch_sub(size);
+		return false;
+	}
+	shard.next_sequence++;
+	shard.order.emplace_back(id, sequence);
+	return true;
+}
+
+std::vector<Transaction> ShardedMempool::take(size_t max_txs, size_t max_bytes, const Exclude &exclude)
+{
+	std::vector<Transaction> transactions;
+	size_t bytes = 0;
+	bool full = false;
+
+	const auto first = m_next_shard.fetch_add(1, std::memory_order_relaxed);
+	for (size_t i = 0; i < SHARDS && !full; i++)
+	{
+		auto &shard = m_shards[(first + i) % SHARDS];
+
+		std::lock_guard lock{shard.mutex};
+		// an entry is stale if its transaction was removed, even if one with the same short ID was added since
+		auto current = [&shard](const std::pair<uint64_t, uint64_t> &entry) {
+			auto it = shard.transactions.find(entry.first);
+			return it != shard.transactions.end() && it->second.sequence == entry.second ? &it->second.transaction
+			                                                                              : nullptr;
+		};
+		while (!shard.order.empty() && !current(shard.order.front()))
+		{
+			shard.order.pop_front();
+		}
+
+		for (const auto &entry : shard.order)
+		{
+			if (transactions.size() >= max_txs)
+			{
+				full = true;
+				break;
+			}
+
+			const auto transaction = current(entry);
+			if (!transaction || (exclude && exclude(transaction->hash())))
+			{
+				continue;
+			}
+
+			// a transaction that exceeds the budget on its own never fits, so it is dropped rather than ending the
+			// block; otherwise it would hold its bytes for good and keep the stale entries behind it in the order
+			const auto size = transaction->data().size();
+			if (bytes + size > max_bytes)
+			{
+				if (size > max_bytes)
+				{
+					shard.transactions.erase(entry.first);
+					m_bytes.fetch_sub(size);
+					m_rejected++;
+					continue;
+				}
+				full = true;
+				break;
+			}
+			bytes += size;
+			transactions.push_back(*transaction);
+		}
+	}
+	return transactions;
+}
+
+void ShardedMempool::remove(const Payload &payload)
+{
+	for (auto transaction : payload)
+	{
+		const auto id = short_id(transaction.hash());
+		auto &shard = m_shards[shard_of(id)];
+
+		std::lock_guard lock{shard.mutex};
+		auto it = shard.transactions.find(id);
+		if (it != shard.transactions.end() && it->second.transaction.hash() == transaction.hash())
+		{
+			m_bytes.fetch_sub(it->second.transaction.data().size());
+			shard.transactions.erase(it);
+		}
+	}
+}
+
+std::optional<Transaction> ShardedMempool::find(uint64_t short_id) const
+{
+	const auto &shard = m_shards[shard_of(short_id)];
+
+	std::lock_guard lock{shard.mutex};
+	auto it = shard.transactions.find(short_id);
+	if (it == shard.transactions.end())
 	{
 		return std::nullopt;
 	}
-	auto tx = m_tx_queue.front();
-	m_tx_queue.pop();
-	return tx;
+	return it->second.transaction;
+}
+
+size_t ShardedMempool::free_bytes() const
+{
+	const size_t bytes = m_bytes;
+	return bytes < m_max_bytes ? m_max_bytes - bytes : 0;
+}
+
+Mempool::Stats ShardedMempool::stats() const
+{
+	Stats stats{0, m_bytes, 0, m_rejected};
+	for (const auto &shard : m_shards)
+	{
+		std::lock_guard lock{shard.mutex};
+		stats.transactions += shard.transactions.size();
+	}
+	return stats;
+}
+
+size_t ShardedMempool::shard_of(uint64_t short_id)
+{
+	static_assert(SHARDS == 16, "the shard is picked by the top four bits");
+	// the map of a shard hashes the whole ID, so the top bits are free to pick the shard
+	return short_id >> 60;
 }
 
-} // namespace Quasar
\ No newline at end of file
+} // namespace Quasar
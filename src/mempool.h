@@ -1,21 +1,116 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <optional>
-#include <queue>
 
+#include "flat_map.h"
 #include "types.h"
 
 namespace Quasar
 {
 
+// MempoolOrdering selects the order in which a mempool serves transactions.
+enum class MempoolOrdering
+{
+	ARRIVAL,  // oldest first, see ShardedMempool
+	PRIORITY, // highest priority first, see PriorityMempool
+};
+
+// TransactionPriority computes the priority of a transaction, such as its fee
+using TransactionPriority = std::function<uint64_t(const Transaction &)>;
+
+// Mempool holds the transactions that are not committed yet, within a budget of transaction bytes. All methods are
+// thread-safe. Transactions are indexed by the short ID of their hash, which compact proposals refer to them by; of two
+// different transactions with the same short ID, only the first is kept.
 class Mempool
 {
   public:
-	void add(const Transaction &transaction);
-	std::optional<Transaction> next();
+	using Exclude = std::function<bool(const Hash &)>;
+
+	struct Stats
+	{
+		size_t transactions;
+		size_t bytes;
+		// evicted counts transactions that made room for others, rejected those that were not added for lack of room
+		// and those that take dropped because they exceed its budget on their own
+		uint64_t evicted;
+		uint64_t rejected;
+	};
+
+	virtual ~Mempool() = default;
+
+	// add returns false if the transaction is already in the mempool or does not fit into it
+	virtual bool add(const Transaction &transaction) = 0;
+
+	// take returns up to max_txs transactions with a combined size of up to max_bytes, in the order in which the
+	// mempool serves them. It skips the transactions for which exclude returns true, such as those of uncommitted
+	// ancestors of a block. The transactions stay in the mempool until they are removed, except for those larger than
+	// max_bytes, which can never be taken and are dropped.
+	virtual std::vector<Transaction> take(size_t max_txs, size_t max_bytes, const Exclude &exclude = {}) = 0;
+
+	// remove removes the transactions of the payload, for example once the block that contains them is committed
+	virtual void remove(const Payload &payload) = 0;
+
+	// find returns a copy of the transaction with the short ID, or nullopt if there is none
+	virtual std::optional<Transaction> find(uint64_t short_id) const = 0;
+
+	// free_bytes returns how many bytes of transactions the mempool can take without rejecting any, so that
+	// submissions can be turned away before they are parsed
+	virtual size_t free_bytes() const = 0;
+
+	virtual Stats stats() const = 0;
+	size_t size() const;
+};
+
+// ShardedMempool serves transactions in the order in which they arrived, oldest first within each shard.
+// Transactions are spread over shards by their hash, each with its own lock, so that transactions can be added from
+// many threads while a proposal is built. Once the budget is used up, further transactions are rejected.
+class ShardedMempool : public Mempool
+{
+  public:
+	static constexpr size_t SHARDS = 16;
+
+	explicit ShardedMempool(size_t max_bytes = SIZE_MAX);
+
+	bool add(const Transaction &transaction) override;
+	// take starts at another shard on each call, so that no shard is preferred when the budget runs out
+	std::vector<Transaction> take(size_t max_txs, size_t max_bytes, const Exclude &exclude = {}) override;
+	void remove(const Payload &payload) override;
+	std::optional<Transaction> find(uint64_t short_id) const override;
+	size_t free_bytes() const override;
+	Stats stats() const override;
 
   private:
-	std::queue<Transaction> m_tx_queue;
+	// Entry is a transaction along with the sequence number under which it was added to its shard
+	struct Entry
+	{
+		Transaction transaction;
+		uint64_t sequence;
+	};
+
+	struct Shard
+	{
+		mutable std::mutex mutex;
+		FlatMap<uint64_t, Entry> transactions;
+		// short IDs and sequence numbers in the order in which the transactions were added; entries of removed
+		// transactions are skipped, even once a transaction with the same short ID is added again, and dropped once
+		// they reach the front
+		std::deque<std::pair<uint64_t, uint64_t>> order;
+		uint64_t next_sequence = 0;
+	};
+
+	static size_t shard_of(uint64_t short_id);
+
+	std::array<Shard, SHARDS> m_shards;
+	std::atomic<size_t> m_next_shard{0};
+
+	const size_t m_max_bytes;
+	std::atomic<size_t> m_bytes{0};
+	std::atomic<uint64_t> m_rejected{0};
 };
 
 } // namespace Quasar
@@ -0,0 +1,141 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "mempool.h"
+
+namespace
+{
+
+Quasar::Transaction make_tx(uint32_t value, size_t size = sizeof(uint32_t))
+{
+	std::vector<std::byte> data(size);
+	std::memcpy(data.data(), &value, sizeof(value));
+	return Quasar::Transaction{data};
+}
+
+} // namespace
+
+TEST_CASE("Mempool drops duplicate transactions", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	REQUIRE(mempool.add(make_tx(1)));
+	REQUIRE(mempool.add(make_tx(2)));
+	REQUIRE(!mempool.add(make_tx(1)));
+	REQUIRE(mempool.size() == 2);
+}
+
+TEST_CASE("Mempool takes a transaction that was removed and added again once", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	const auto tx = make_tx(1);
+	REQUIRE(mempool.add(tx));
+	mempool.remove(Quasar::Payload{{tx}});
+	REQUIRE(mempool.add(tx));
+	REQUIRE(mempool.add(make_tx(2)));
+
+	const auto taken = mempool.take(SIZE_MAX, SIZE_MAX);
+	REQUIRE(taken.size() == 2);
+	REQUIRE(std::count_if(taken.begin(), taken.end(), [&](const auto &t) { return t.hash() == tx.hash(); }) == 1);
+}
+
+TEST_CASE("Mempool takes transactions within a budget", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		mempool.add(make_tx(i, 100));
+	}
+
+	REQUIRE(mempool.take(10, SIZE_MAX).size() == 10);
+	REQUIRE(mempool.take(SIZE_MAX, 1000).size() == 10);
+	// taken transactions stay in the mempool until they are removed
+	REQUIRE(mempool.take(SIZE_MAX, SIZE_MAX).size() == 100);
+
+	// excluded transactions are skipped
+	const auto excluded = make_tx(7, 100).hash();
+	auto taken = mempool.take(SIZE_MAX, SIZE_MAX, [&](const Quasar::Hash &hash) { return hash == excluded; });
+	REQUIRE(taken.size() == 99);
+	REQUIRE(std::none_of(taken.begin(), taken.end(), [&](const auto &tx) { return tx.hash() == excluded; }));
+
+	mempool.remove(Quasar::Payload{taken});
+	REQUIRE(mempool.size() == 1);
+	REQUIRE(mempool.take(SIZE_MAX, SIZE_MAX)[0].hash() == excluded);
+}
+
+TEST_CASE("Mempool drops transactions that exceed the budget of take on their own", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	REQUIRE(mempool.add(make_tx(1, 2000)));
+	REQUIRE(mempool.add(make_tx(2, 100)));
+
+	const auto taken = mempool.take(SIZE_MAX, 1000);
+	REQUIRE(taken.size() == 1);
+	REQUIRE(taken[0].hash() == make_tx(2, 100).hash());
+
+	const auto stats = mempool.stats();
+	REQUIRE(stats.transactions == 1);
+	REQUIRE(stats.bytes == 100);
+	REQUIRE(stats.rejected == 1);
+}
+
+TEST_CASE("Mempool finds transactions by short ID", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	const auto tx = make_tx(1);
+	mempool.add(tx);
+
+	auto found = mempool.find(Quasar::short_id(tx.hash()));
+	REQUIRE(found);
+	REQUIRE(found->data() == tx.data());
+	REQUIRE(!mempool.find(Quasar::short_id(make_tx(2).hash())));
+
+	mempool.remove(Quasar::Payload{{tx}});
+	REQUIRE(!mempool.find(Quasar::short_id(tx.hash())));
+}
+
+TEST_CASE("Mempool accepts transactions from many threads", "[mempool]")
+{
+	Quasar::ShardedMempool mempool;
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&mempool, t] {
+			for (uint32_t i = 0; i < 1000; i++)
+			{
+				mempool.add(make_tx(t * 1000 + i));
+			}
+		});
+	}
+
+	// proposals are built while transactions arrive
+	size_t taken = 0;
+	while (taken < 4000)
+	{
+		taken = mempool.take(SIZE_MAX, SIZE_MAX).size();
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+	REQUIRE(mempool.size() == 4000);
+}
+
+TEST_CASE("Mempool rejects transactions beyond its budget", "[mempool]")
+{
+	Quasar::ShardedMempool mempool{250};
+	REQUIRE(mempool.add(make_tx(1, 100)));
+	REQUIRE(mempool.add(make_tx(2, 100)));
+	REQUIRE(!mempool.add(make_tx(3, 100)));
+
+	auto stats = mempool.stats();
+	REQUIRE(stats.transactions == 2);
+	REQUIRE(stats.bytes == 200);
+	REQUIRE(stats.rejected == 1);
+
+	// committed transactions make room again
+	mempool.remove(Quasar::Payload{{make_tx(1, 100)}});
+	REQUIRE(mempool.add(make_tx(3, 100)));
+}
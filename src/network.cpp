@@ -1,5 +1,5 @@
 #include <fmt/format.h>
-#include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/arena.h>
 
 #include "exception.h"
 #include "network.h"
@@ -7,18 +7,97 @@
 namespace Quasar
 {
 
-ZMQNetwork::ZMQNetwork(int port) : m_context(1), m_listener(m_context, zmq::socket_type::pull)
+namespace
+{
+
+// SOCKET_HWM is how many batches ZMQ queues for a peer on each lane
+const int SOCKET_HWM = 16;
+
+} // namespace
+
+MessagePtr make_message(size_t size_hint)
+{
+	google::protobuf::ArenaOptions options;
+	// the parsed message takes up more memory than its serialized form
+	options.start_block_size = std::max(options.start_block_size, 2 * size_hint);
+
+	auto arena = std::make_shared<google::protobuf::Arena>(options);
+	auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(arena.get());
+
+	return MessagePtr{arena, msg};
+}
+
+SerializedMessage serialize_message(const Proto::Message &msg)
+{
+	return std::make_shared<const std::string>(msg.SerializeAsString());
+}
+
+Lane lane_of(const Proto::Message &msg)
+{
+	const auto &data = msg.data();
+	const auto bulk = data.has_proposal() || data.has_transaction_response() || data.has_batch();
+	return bulk ? Lane::BULK : Lane::PRIORITY;
+}
+
+Round round_of(const Proto::Message &msg)
+{
+	const auto &data = msg.data();
+	switch (data.data_case())
+	{
+	// proposals are never purged: a replica that lags behind still needs them to extend its chain
+	case Proto::MessageData::kVote:
+		return data.vote().round();
+	case Proto::MessageData::kWish:
+		return data.wish().round();
+	case Proto::MessageData::kAdvance:
+		return data.advance().wish().round();
+	default:
+		return 0;
+	}
+}
+
+bool Network::send_message(const Identity &recipient, const Proto::Message &msg)
+{
+	return send_message(recipient, serialize_message(msg), lane_of(msg), round_of(msg));
+}
+
+bool Network::broadcast_message(const Proto::Message &msg)
+{
+	return broadcast_message(serialize_message(msg), lane_of(msg), round_of(msg));
+}
+
+ZMQNetwork::ZMQNetwork(int port, const Settings::Outbound &settings)
+    : m_context(1), m_listener(m_context, zmq::socket_type::pull), m_settings(settings), m_reactor(nullptr),
+      m_flush_scheduled(false), m_batch_stats(), m_sender_reactor(std::make_unique<Reactor>()), m_stopped(false)
 {
 	m_listener.bind(fmt::format("tcp://*:{}", port));
+	m_sender = std::thread([this] { run_sender(); });
+}
+
+ZMQNetwork::~ZMQNetwork()
+{
+	m_stopped = true;
+	if (m_receiver.joinable())
+	{
+		m_receiver_reactor->wake();
+		m_receiver.join();
+	}
+	m_sender_reactor->wake();
+	m_sender.join();
 }
 
 NetworkType ZMQNetwork::type()
 {
-	return NetworkType::POLLED;
+	return m_receiver.joinable() ? NetworkType::THREADED : NetworkType::POLLED;
 }
 
 void ZMQNetwork::poll(std::chrono::milliseconds duration)
 {
+	if (m_receiver.joinable())
+	{
+		throw QUASAR_EXCEPTION("messages are received on the receiver thread and cannot be polled");
+	}
+
 	if (m_poller.empty())
 	{
 		m_poller.add(m_listener, zmq::event_flags::pollin,
@@ -27,14 +106,44 @@ void ZMQNetwork::poll(std::chrono::milliseconds duration)
 	m_poller.wait(duration);
 }
 
+void ZMQNetwork::attach(Reactor &reactor)
+{
+	m_reactor = &reactor;
+	if (m_receiver.joinable())
+	{
+		// messages are received on the receiver thread
+		return;
+	}
+
+	const auto fd = m_listener.get(zmq::sockopt::fd);
+	reactor.add(fd, [self = shared_from_this()] { self->receive_pending(); }, true);
+	// the file descriptor only signals new messages, so those that arrived before are received now
+	receive_pending();
+}
+
 void ZMQNetwork::connect_to(const Identity &peer, const std::string &address)
 {
-	zmq::socket_t socket{m_context, zmq::socket_type::push};
-	socket.connect(fmt::format("tcp://{}", address));
-	m_connections.insert({peer, std::move(socket)});
+	auto connection = std::make_unique<Peer>();
+	for (auto &socket : connection->sockets)
+	{
+		socket = zmq::socket_t{m_context, zmq::socket_type::push};
+		// keep the backlog in the lanes, where outdated messages can still be purged
+		socket.set(zmq::sockopt::sndhwm, SOCKET_HWM);
+		// messages that are not sent on shutdown are outdated, and an unreachable peer must not block it
+		socket.set(zmq::sockopt::linger, 0);
+		socket.connect(fmt::format("tcp://{}", address));
+	}
+
+	{
+		// the sockets change threads here, which ZMQ allows after a full memory barrier
+		std::lock_guard lock{m_mutex};
+		m_new_peers.push_back(connection.get());
+		m_connections.insert({peer, std::move(connection)});
+	}
+	m_sender_reactor->wake();
 }
 
-void ZMQNetwork::send_message(const Identity &recipient, const Proto::Message &msg)
+bool ZMQNetwork::send_message(const Identity &recipient, const SerializedMessage &msg, Lane lane, Round round)
 {
 	auto entry = m_connections.find(recipient);
 	if (entry == m_connections.end())
@@ -43,24 +152,238 @@ void ZMQNetwork::send_message(const Identity &recipient, const Proto::Message &m
 		                            recipient.to_hex_string());
 	}
 
-	auto &[_, socket] = *entry;
+	return enqueue(*entry->second, msg, lane, round);
+}
+
+bool ZMQNetwork::broadcast_message(const SerializedMessage &msg, Lane lane, Round round)
+{
+	bool accepted = true;
+	for (auto &[_, peer] : m_connections)
+	{
+		accepted &= enqueue(*peer, msg, lane, round);
+	}
+	return accepted;
+}
+
+void ZMQNetwork::purge(Round min_round)
+{
+	const auto outdated = [min_round](const Outgoing &outgoing) {
+		return outgoing.round != 0 && outgoing.round < min_round;
+	};
+
+	uint64_t purged = 0;
+	std::lock_guard lock{m_mutex};
+	for (auto &[_, peer] : m_connections)
+	{
+		for (auto &outbox : peer->lanes)
+		{
+			for (const auto &outgoing : outbox.batch)
+			{
+				if (outdated(outgoing))
+				{
+					outbox.batch_bytes -= outgoing.msg->size();
+				}
+			}
+			purged += std::erase_if(outbox.batch, outdated);
+
+			// the I/O thread is not sending while the lock is held, so no batch is partially sent
+			for (auto &batch : outbox.queue)
+			{
+				const auto count = std::erase_if(batch, outdated);
+				outbox.queued -= count;
+				purged += count;
+			}
+			std::erase_if(outbox.queue, [](const Batch &batch) { return batch.empty(); });
+		}
+	}
+	m_batch_stats.purged += purged;
+}
+
+void ZMQNetwork::flush()
+{
+	for (auto &[_, peer] : m_connections)
+	{
+		flush(*peer);
+	}
+}
+
+ZMQNetwork::BatchStats ZMQNetwork::batch_stats() const
+{
+	std::lock_guard lock{m_mutex};
+	return m_batch_stats;
+}
+
+bool ZMQNetwork::enqueue(Peer &peer, const SerializedMessage &msg, Lane lane, Round round)
+{
+	auto &outbox = peer.lanes[(size_t)lane];
+
+	// the I/O thread cannot keep up with this peer, so the message is dropped instead of queueing without bound
+	if (outbox.batch.size() + outbox.queued >= m_settings.queue_size())
+	{
+		std::lock_guard lock{m_mutex};
+		m_batch_stats.dropped++;
+		return false;
+	}
+
+	if (!outbox.batch.empty() && outbox.batch_bytes + msg->size() > m_settings.batch_bytes())
+	{
+		flush(peer);
+	}
+
+	outbox.batch.push_back({msg, round});
+	outbox.batch_bytes += msg->size();
+
+	// without a reactor, there is nothing to send the batch later from
+	if (!m_reactor || outbox.batch_bytes >= m_settings.batch_bytes())
+	{
+		flush(peer);
+		return true;
+	}
+
+	if (m_flush_scheduled)
+	{
+		return true;
+	}
+	m_flush_scheduled = true;
+
+	auto flush = [self = shared_from_this()] {
+		self->m_flush_scheduled = false;
+		self->flush();
+	};
+	if (m_settings.batch_window() == std::chrono::milliseconds::zero())
+	{
+		// send once the consensus thread has handled the events at hand
+		m_reactor->defer(flush);
+	}
+	else
+	{
+		m_reactor->add_timer(Reactor::Clock::now() + m_settings.batch_window(), flush);
+	}
+	return true;
+}
+
+void ZMQNetwork::flush(Peer &peer)
+{
+	bool flushed = false;
+	{
+		std::lock_guard lock{m_mutex};
+		for (auto &outbox : peer.lanes)
+		{
+			if (outbox.batch.empty())
+			{
+				continue;
+			}
+
+			m_batch_stats.batches++;
+			m_batch_stats.messages += outbox.batch.size();
+			m_batch_stats.bytes += outbox.batch_bytes;
+			m_batch_stats.max_messages = std::max<uint64_t>(m_batch_stats.max_messages, outbox.batch.size());
+
+			outbox.queued += outbox.batch.size();
+			outbox.queue.push_back(std::move(outbox.batch));
+			outbox.batch.clear();
+			outbox.batch_bytes = 0;
+			flushed = true;
+		}
+	}
+
+	if (flushed)
+	{
+		m_sender_reactor->wake();
+	}
+}
+
+void ZMQNetwork::run_sender()
+{
+	while (!m_stopped)
+	{
+		send_pending();
+		m_sender_reactor->poll();
+	}
+	// send what was flushed before stopping
+	send_pending();
+}
+
+void ZMQNetwork::send_pending()
+{
+	std::lock_guard lock{m_mutex};
+
+	for (auto *peer : m_new_peers)
+	{
+		for (auto &socket : peer->sockets)
+		{
+			// the file descriptor signals when the socket may have become writable again
+			m_sender_reactor->add(socket.get(zmq::sockopt::fd), [this] { send_pending(); }, true);
+		}
+	}
+	m_new_peers.clear();
 
-	socket.send(zmq::buffer(msg.SerializeAsString()));
+	for (auto &[_, peer] : m_connections)
+	{
+		// the lanes use sockets of their own, so a full bulk lane does not hold up the priority lane
+		for (size_t lane = 0; lane < LANES; lane++)
+		{
+			auto &socket = peer->sockets[lane];
+			auto &outbox = peer->lanes[lane];
+			while (!outbox.queue.empty() && send_batch(socket, outbox.queue.front()))
+			{
+				outbox.queued -= outbox.queue.front().size();
+				outbox.queue.pop_front();
+			}
+			// reading the events resets the edge-triggered file descriptor
+			socket.get(zmq::sockopt::events);
+		}
+	}
 }
 
-void ZMQNetwork::broadcast_message(const Proto::Message &msg)
+bool ZMQNetwork::send_batch(zmq::socket_t &socket, const Batch &batch)
 {
-	for (auto &[id, _] : m_connections)
+	for (size_t i = 0; i < batch.size(); i++)
 	{
-		send_message(id, msg);
+		const auto &msg = batch[i].msg;
+
+		// the frame points into the shared buffer and holds a reference to it, which ZMQ releases from its I/O
+		// thread once the frame is sent
+		auto reference = std::make_unique<SerializedMessage>(msg);
+		zmq::message_t frame{const_cast<char *>(msg->data()), msg->size(),
+		                     [](void *, void *hint) { delete static_cast<SerializedMessage *>(hint); },
+		                     reference.get()};
+		reference.release();
+
+		// once the first part is accepted, ZMQ accepts the rest of the multipart message regardless of the
+		// high-water mark
+		auto flags = zmq::send_flags::dontwait;
+		if (i + 1 < batch.size())
+		{
+			flags = flags | zmq::send_flags::sndmore;
+		}
+		if (!socket.send(frame, flags))
+		{
+			return false;
+		}
 	}
+	return true;
 }
 
-void ZMQNetwork::set_message_handler(std::function<void(Proto::Message &)> handler)
+void ZMQNetwork::set_message_handler(std::function<void(MessagePtr)> handler)
 {
 	m_handler = handler;
 }
 
+bool ZMQNetwork::set_frame_handler(std::function<void(Frame)> handler)
+{
+	if (m_receiver.joinable())
+	{
+		throw QUASAR_EXCEPTION("the frame handler is already set");
+	}
+
+	m_frame_handler = std::move(handler);
+	m_receiver_reactor = std::make_unique<Reactor>();
+	// the listener is only used by the receiver thread from now on, as ZMQ sockets are not thread-safe
+	m_receiver = std::thread([this] { run_receiver(); });
+	return true;
+}
+
 int ZMQNetwork::size()
 {
 	return (int)m_connections.size();
@@ -81,17 +404,51 @@ std::vector<Identity> ZMQNetwork::connected_peers()
 
 void ZMQNetwork::receive_message()
 {
-	zmq::message_t msg_buf;
-	auto res = m_listener.recv(msg_buf);
-	if (res == std::nullopt)
+	// a batch arrives as one multipart message, whose parts are messages of their own
+	do
+	{
+		auto res = m_listener.recv(m_receive_buffer);
+		if (res == std::nullopt)
+		{
+			throw QUASAR_EXCEPTION("unexpected nullopt");
+		}
+
+		auto msg = make_message(m_receive_buffer.size());
+		msg->ParseFromArray(m_receive_buffer.data(), (int)m_receive_buffer.size());
+
+		m_handler(std::move(msg));
+	} while (m_receive_buffer.more());
+}
+
+void ZMQNetwork::receive_pending()
+{
+	// the ZMQ file descriptor is edge-triggered, so everything that is queued has to be received
+	while (m_listener.get(zmq::sockopt::events) & ZMQ_POLLIN)
 	{
-		throw QUASAR_EXCEPTION("unexpected nullopt");
+		if (!m_frame_handler)
+		{
+			receive_message();
+			continue;
+		}
+
+		Frame frame;
+		if (m_listener.recv(frame, zmq::recv_flags::dontwait))
+		{
+			m_frame_handler(std::move(frame));
+		}
 	}
+}
 
-	Proto::Message msg;
-	msg.ParseFromArray(msg_buf.data(), (int)msg_buf.size());
+void ZMQNetwork::run_receiver()
+{
+	const auto fd = m_listener.get(zmq::sockopt::fd);
+	m_receiver_reactor->add(fd, [this] { receive_pending(); }, true);
+	receive_pending();
 
-	m_handler(msg);
+	while (!m_stopped)
+	{
+		m_receiver_reactor->poll();
+	}
 }
 
 } // namespace Quasar
\ No newline at end of file
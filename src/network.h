@@ -3,16 +3,55 @@
 #include <zmq.hpp>
 #include <zmq_addon.hpp>
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "quasar.pb.h"
+#include "reactor.h"
+#include "settings.h"
 #include "types.h"
 
 namespace Quasar
 {
 
+// MessagePtr points to a message that is allocated on its own protobuf arena.
+// The arena is freed when the last pointer to the message (or to any part of it) is released.
+using MessagePtr = std::shared_ptr<Proto::Message>;
+
+// make_message allocates an empty message on a new arena.
+// size_hint is the expected size of the serialized message, and is used to size the first arena block.
+MessagePtr make_message(size_t size_hint = 0);
+
+// Frame holds a received message that is not parsed yet.
+using Frame = zmq::message_t;
+
+// SerializedMessage holds a serialized message, which can be sent to several peers without copying it.
+using SerializedMessage = std::shared_ptr<const std::string>;
+
+SerializedMessage serialize_message(const Proto::Message &msg);
+
+// Lane selects the outbound queue of a message, so that small messages that the protocol waits for do not queue
+// behind large proposals.
+enum class Lane
+{
+	PRIORITY, // votes, wishes, advances, transaction requests and batch acknowledgements and certificates
+	BULK,     // proposals, transaction responses and batches
+};
+
+Lane lane_of(const Proto::Message &msg);
+
+// round_of returns the round that a message belongs to, which queues use to drop outdated messages. It returns 0 for
+// messages that stay useful after their round, such as proposals.
+Round round_of(const Proto::Message &msg);
+
 enum class NetworkType
 {
 	UNSPECIFIED,
 	POLLED,
+	THREADED, // receives messages on a thread of its own
 };
 
 class Network
@@ -25,11 +64,36 @@ class Network
 		return NetworkType::UNSPECIFIED;
 	};
 
-	virtual void send_message(const Identity &recipient, const Proto::Message &msg) = 0;
-	virtual void broadcast_message(const Proto::Message &msg) = 0;
-	virtual void set_message_handler(std::function<void(Proto::Message &)> handler) = 0;
+	// send_message and broadcast_message serialize the message once, and send it with the serialized overloads on the
+	// lane of its type. They return false if the message was dropped for a recipient whose queue is full.
+	bool send_message(const Identity &recipient, const Proto::Message &msg);
+	bool broadcast_message(const Proto::Message &msg);
+	// round tags the message for purge; messages with round 0 are never purged
+	virtual bool send_message(const Identity &recipient, const SerializedMessage &msg, Lane lane, Round round) = 0;
+	virtual bool broadcast_message(const SerializedMessage &msg, Lane lane, Round round) = 0;
+
+	// purge drops the messages for rounds before min_round that are still queued to be sent
+	virtual void purge(Round min_round)
+	{
+	}
+
+	virtual void set_message_handler(std::function<void(MessagePtr)> handler) = 0;
+
+	// set_frame_handler makes the network pass on messages before they are parsed, so that they can be parsed on
+	// another thread. It replaces the message handler, and returns false if the network does not support it.
+	virtual bool set_frame_handler(std::function<void(Frame)> handler)
+	{
+		return false;
+	}
+
 	virtual int size() = 0;
 	virtual std::vector<Identity> connected_peers() = 0;
+
+	// attach lets the network use the reactor of the consensus thread, which must outlive it: a polled network
+	// receives messages in Reactor::poll, and a network may hold back messages to send them later from a timer.
+	virtual void attach(Reactor &reactor)
+	{
+	}
 };
 
 class PolledNetwork : public Network
@@ -38,31 +102,120 @@ class PolledNetwork : public Network
 	virtual void poll(std::chrono::milliseconds duration) = 0;
 };
 
+// ZMQNetwork sends the messages to a peer in batches once it is attached to a reactor: the messages that are sent
+// within the batch window, or until the batch reaches its byte limit, go out together as one multipart message.
+// The batches are sent by an I/O thread that owns the outgoing sockets, one per peer and lane, so that a proposal
+// does not hold up a vote on the same connection. A peer whose lane is full drops further messages on it.
 class ZMQNetwork : public PolledNetwork, public std::enable_shared_from_this<ZMQNetwork>
 {
   public:
-	explicit ZMQNetwork(int port);
+	struct BatchStats
+	{
+		uint64_t batches;
+		uint64_t messages;
+		uint64_t bytes;
+		uint64_t max_messages;
+		// dropped counts the messages that did not fit into the queue of a peer
+		uint64_t dropped;
+		// purged counts the queued messages that were dropped because their round had passed
+		uint64_t purged;
+
+		double mean_messages() const
+		{
+			return batches == 0 ? 0.0 : (double)messages / (double)batches;
+		}
+	};
+
+	explicit ZMQNetwork(int port, const Settings::Outbound &settings = Settings::Outbound{});
+	~ZMQNetwork() override;
 
 	NetworkType type() override;
 
+	// connect_to must be called from the thread that sends messages
 	void connect_to(const Identity &peer, const std::string &address);
 
-	void send_message(const Identity &recipient, const Proto::Message &msg) override;
-	void broadcast_message(const Proto::Message &msg) override;
-	void set_message_handler(std::function<void(Proto::Message &)> handler) override;
+	using Network::broadcast_message;
+	using Network::send_message;
+	// the sockets share the serialized message, which is released once every one of them has sent it
+	bool send_message(const Identity &recipient, const SerializedMessage &msg, Lane lane, Round round) override;
+	bool broadcast_message(const SerializedMessage &msg, Lane lane, Round round) override;
+	void purge(Round min_round) override;
+	void set_message_handler(std::function<void(MessagePtr)> handler) override;
+	// set_frame_handler starts a thread that receives messages; poll must not be called afterwards
+	bool set_frame_handler(std::function<void(Frame)> handler) override;
 	int size() override;
 	std::vector<Identity> connected_peers() override;
 
 	void poll(std::chrono::milliseconds duration) override;
+	void attach(Reactor &reactor) override;
+
+	// flush sends the batches of all peers right away
+	void flush();
+	BatchStats batch_stats() const;
 
   private:
+	static constexpr size_t LANES = 2;
+
+	struct Outgoing
+	{
+		SerializedMessage msg;
+		Round round;
+	};
+
+	using Batch = std::vector<Outgoing>;
+
+	struct Outbox
+	{
+		// batch collects messages on the sending thread until it is flushed
+		Batch batch;
+		size_t batch_bytes = 0;
+		// queue holds the flushed batches for the I/O thread, and is guarded by m_mutex
+		std::deque<Batch> queue;
+		// queued counts the messages in queue
+		std::atomic<size_t> queued = 0;
+	};
+
+	struct Peer
+	{
+		// sockets are used by the I/O thread once the peer is handed to it
+		std::array<zmq::socket_t, LANES> sockets;
+		std::array<Outbox, LANES> lanes;
+	};
+
+	bool enqueue(Peer &peer, const SerializedMessage &msg, Lane lane, Round round);
+	void flush(Peer &peer);
+
+	void run_sender();
+	void send_pending();
+	static bool send_batch(zmq::socket_t &socket, const Batch &batch);
+
 	void receive_message();
+	void receive_pending();
+	void run_receiver();
 
 	zmq::context_t m_context;
 	zmq::socket_t m_listener;
 	zmq::active_poller_t m_poller;
-	std::unordered_map<Identity, zmq::socket_t> m_connections;
-	std::function<void(Proto::Message &)> m_handler;
+	std::unordered_map<Identity, std::unique_ptr<Peer>> m_connections;
+
+	Settings::Outbound m_settings;
+	Reactor *m_reactor;
+	bool m_flush_scheduled;
+
+	mutable std::mutex m_mutex;
+	// new_peers are handed to the I/O thread, which registers their sockets with its reactor
+	std::vector<Peer *> m_new_peers;
+	BatchStats m_batch_stats;
+	std::unique_ptr<Reactor> m_sender_reactor;
+	std::thread m_sender;
+
+	std::function<void(MessagePtr)> m_handler;
+	zmq::message_t m_receive_buffer;
+
+	std::function<void(Frame)> m_frame_handler;
+	std::unique_ptr<Reactor> m_receiver_reactor;
+	std::thread m_receiver;
+	std::atomic<bool> m_stopped;
 };
 
 } // namespace Quasar
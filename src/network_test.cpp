@@ -30,7 +30,7 @@ TEST_CASE("ZMQNetwork can send message", "[network]")
 	wish_ptr->set_round(want);
 
 	net1->set_message_handler([&](auto msg) {
-		REQUIRE(msg.data().wish().round() == want);
+		REQUIRE(msg->data().wish().round() == want);
 		received = true;
 	});
 
@@ -40,3 +40,164 @@ TEST_CASE("ZMQNetwork can send message", "[network]")
 
 	REQUIRE(received);
 }
+
+TEST_CASE("ZMQNetwork broadcasts a serialized message to every peer", "[network]")
+{
+	using namespace std::chrono_literals;
+
+	const auto id1 = Quasar::Identity::from_hex_string("01");
+	const auto id2 = Quasar::Identity::from_hex_string("02");
+
+	auto net1 = std::make_shared<Quasar::ZMQNetwork>(8001);
+	auto net2 = std::make_shared<Quasar::ZMQNetwork>(8002);
+	auto net3 = std::make_shared<Quasar::ZMQNetwork>(8003);
+
+	REQUIRE_NOTHROW(net3->connect_to(id1, "localhost:8001"));
+	REQUIRE_NOTHROW(net3->connect_to(id2, "localhost:8002"));
+
+	Quasar::Proto::Message the_msg{};
+	the_msg.mutable_data()->mutable_wish()->set_round(10);
+
+	int received = 0;
+	auto handler = [&](auto msg) {
+		REQUIRE(msg->data().wish().round() == 10);
+		received++;
+	};
+	net1->set_message_handler(handler);
+	net2->set_message_handler(handler);
+
+	auto serialized = Quasar::serialize_message(the_msg);
+	REQUIRE_NOTHROW(net3->broadcast_message(serialized, Quasar::Lane::PRIORITY, 10));
+
+	net1->poll(100ms);
+	net2->poll(100ms);
+
+	REQUIRE(received == 2);
+}
+
+TEST_CASE("ZMQNetwork sends the messages to a peer as one batch", "[network]")
+{
+	using namespace std::chrono_literals;
+
+	const auto id1 = Quasar::Identity::from_hex_string("01");
+
+	auto net1 = std::make_shared<Quasar::ZMQNetwork>(8001);
+	auto net2 = std::make_shared<Quasar::ZMQNetwork>(8002);
+
+	Quasar::Reactor reactor;
+	net2->attach(reactor);
+	REQUIRE_NOTHROW(net2->connect_to(id1, "localhost:8001"));
+
+	std::vector<Quasar::Round> received;
+	net1->set_message_handler([&](auto msg) { received.push_back(msg->data().wish().round()); });
+
+	for (Quasar::Round round = 1; round <= 3; round++)
+	{
+		Quasar::Proto::Message the_msg{};
+		the_msg.mutable_data()->mutable_wish()->set_round(round);
+		net2->send_message(id1, the_msg);
+	}
+	REQUIRE(net2->batch_stats().batches == 0);
+
+	// the batch is sent by the reactor, once the messages at hand are sent
+	reactor.poll(0ms);
+	net1->poll(100ms);
+
+	REQUIRE((received == std::vector<Quasar::Round>{1, 2, 3}));
+	auto stats = net2->batch_stats();
+	REQUIRE(stats.batches == 1);
+	REQUIRE(stats.messages == 3);
+	REQUIRE(stats.max_messages == 3);
+}
+
+TEST_CASE("ZMQNetwork drops messages to a peer whose queue is full", "[network]")
+{
+	const auto id1 = Quasar::Identity::from_hex_string("01");
+
+	auto net2 = std::make_shared<Quasar::ZMQNetwork>(8002);
+	// nothing listens on this port, so the messages to the peer are never sent
+	REQUIRE_NOTHROW(net2->connect_to(id1, "localhost:8009"));
+
+	Quasar::Proto::Message the_msg{};
+	the_msg.mutable_data()->mutable_wish()->set_round(1);
+
+	const auto queue_size = Quasar::Settings::Outbound{}.queue_size();
+	size_t accepted = 0;
+	for (size_t i = 0; i < 4 * queue_size; i++)
+	{
+		accepted += net2->send_message(id1, the_msg);
+	}
+
+	REQUIRE(accepted < 4 * queue_size);
+	REQUIRE(net2->batch_stats().dropped == 4 * queue_size - accepted);
+}
+
+TEST_CASE("ZMQNetwork purges queued messages of earlier rounds", "[network]")
+{
+	using namespace std::chrono_literals;
+
+	const auto id1 = Quasar::Identity::from_hex_string("01");
+
+	auto net1 = std::make_shared<Quasar::ZMQNetwork>(8001);
+	auto net2 = std::make_shared<Quasar::ZMQNetwork>(8002);
+
+	Quasar::Reactor reactor;
+	net2->attach(reactor);
+	REQUIRE_NOTHROW(net2->connect_to(id1, "localhost:8001"));
+
+	std::vector<Quasar::Round> received;
+	net1->set_message_handler([&](auto msg) { received.push_back(msg->data().wish().round()); });
+
+	for (Quasar::Round round = 1; round <= 5; round++)
+	{
+		Quasar::Proto::Message the_msg{};
+		the_msg.mutable_data()->mutable_wish()->set_round(round);
+		net2->send_message(id1, the_msg);
+	}
+
+	net2->purge(4);
+	reactor.poll(0ms);
+	net1->poll(100ms);
+
+	REQUIRE((received == std::vector<Quasar::Round>{4, 5}));
+	REQUIRE(net2->batch_stats().purged == 3);
+}
+
+TEST_CASE("ZMQNetwork does not purge queued proposals", "[network]")
+{
+	using namespace std::chrono_literals;
+
+	const auto id1 = Quasar::Identity::from_hex_string("01");
+
+	auto net1 = std::make_shared<Quasar::ZMQNetwork>(8003);
+	auto net2 = std::make_shared<Quasar::ZMQNetwork>(8004);
+
+	Quasar::Reactor reactor;
+	net2->attach(reactor);
+	REQUIRE_NOTHROW(net2->connect_to(id1, "localhost:8003"));
+
+	std::vector<Quasar::Round> proposals;
+	net1->set_message_handler([&](auto msg) {
+		if (msg->data().has_proposal())
+		{
+			proposals.push_back(msg->data().proposal().round());
+		}
+	});
+
+	Quasar::Proto::Message proposal{};
+	proposal.mutable_data()->mutable_proposal()->set_round(1);
+	REQUIRE(Quasar::round_of(proposal) == 0);
+	net2->send_message(id1, proposal);
+
+	Quasar::Proto::Message wish{};
+	wish.mutable_data()->mutable_wish()->set_round(1);
+	net2->send_message(id1, wish);
+
+	// a lagging replica still needs the proposal to extend its chain, whereas the wish is outdated
+	net2->purge(4);
+	reactor.poll(0ms);
+	net1->poll(100ms);
+
+	REQUIRE((proposals == std::vector<Quasar::Round>{1}));
+	REQUIRE(net2->batch_stats().purged == 1);
+}
@@ -0,0 +1,267 @@
+#include <queue>
+
+#include "priority_mempool.h"
+
+namespace Quasar
+{
+
+PriorityMempool::PriorityMempool(TransactionPriority priority, size_t max_bytes)
+    : m_priority(std::move(priority)), m_max_bytes(max_bytes), m_bytes(0), m_sequence(0), m_evicted(0), m_rejected(0)
+{
+}
+
+bool PriorityMempool::add(const Transaction &transaction)
+{
+	// the priority may be costly to compute, so it is computed before taking the lock
+	const auto priority = m_priority ? m_priority(transaction) : 0;
+	const auto size = transaction.data().size();
+	const auto id = short_id(transaction.hash());
+
+	std::lock_guard lock{m_mutex};
+	if (m_index.contains(id))
+	{
+		return false;
+	}
+
+	// find the transactions to evict before evicting any, so that nothing is evicted if the transaction does not fit
+	std::vector<uint64_t> evicted;
+	auto room = m_max_bytes - m_bytes;
+	if (size > room)
+	{
+		visit(EVICT, [&](const Entry &entry) {
+			if (entry.priority >= priority)
+			{
+				return false;
+			}
+			evicted.push_back(short_id(entry.transaction.hash()));
+			room += entry.transaction.data().size();
+			return size > room;
+		});
+
+		if (size > room)
+		{
+			m_rejected++;
+			return false;
+		}
+	}
+
+	for (auto evicted_id : evicted)
+	{
+		erase(m_index.find(evicted_id)->second);
+	}
+	m_evicted += evicted.size();
+
+	const auto index = (uint32_t)m_entries.size();
+	m_entries.push_back({transaction, priority, m_sequence++, {}});
+	m_index.emplace(id, index);
+	m_bytes += size;
+
+	for (auto heap : {SERVE, EVICT})
+	{
+		m_heaps[heap].push_back(index);
+		m_entries[index].position[heap] = (uint32_t)(m_heaps[heap].size() - 1);
+		sift_up(heap, m_heaps[heap].size() - 1);
+	}
+	return true;
+}
+
+std::vector<Transaction> PriorityMempool::take(size_t max_txs, size_t max_bytes, const Exclude &exclude)
+{
+	std::vector<Transaction> transactions;
+	std::vector<uint64_t> oversized;
+	size_t bytes = 0;
+
+	std::lock_guard lock{m_mutex};
+	visit(SERVE, [&](const Entry &entry) {
+		if (transactions.size() >= max_txs)
+		{
+			return false;
+		}
+		if (exclude && exclude(entry.transaction.hash()))
+		{
+			return true;
+		}
+
+		// a transaction that exceeds the budget on its own never fits, so it is dropped rather than ending the block;
+		// otherwise it would hold its bytes for good
+		const auto size = entry.transaction.data().size();
+		if (bytes + size > max_bytes)
+		{
+			if (size > max_bytes)
+			{
+				oversized.push_back(short_id(entry.transaction.hash()));
+				return true;
+			}
+			return false;
+		}
+		bytes += size;
+		transactions.push_back(entry.transaction);
+		return true;
+	});
+
+	// the heaps are reordered by erasing, so oversized transactions are only erased once the visit is done
+	for (auto id : oversized)
+	{
+		erase(m_index.find(id)->second);
+	}
+	m_rejected += oversized.size();
+	return transactions;
+}
+
+void PriorityMempool::remove(const Payload &payload)
+{
+	std::lock_guard lock{m_mutex};
+	for (auto transaction : payload)
+	{
+		auto it = m_index.find(short_id(transaction.hash()));
+		if (it != m_index.end() && m_entries[it->second].transaction.hash() == transaction.hash())
+		{
+			erase(it->second);
+		}
+	}
+}
+
+std::optional<Transaction> PriorityMempool::find(uint64_t short_id) const
+{
+	std::lock_guard lock{m_mutex};
+	auto it = m_index.find(short_id);
+	if (it == m_index.end())
+	{
+		return std::nullopt;
+	}
+	return m_entries[it->second].transaction;
+}
+
+size_t PriorityMempool::free_bytes() const
+{
+	return m_max_bytes;
+}
+
+Mempool::Stats PriorityMempool::stats() const
+{
+	std::lock_guard lock{m_mutex};
+	return {m_entries.size(), m_bytes, m_evicted, m_rejected};
+}
+
+bool PriorityMempool::before(Heap heap, uint32_t a, uint32_t b) const
+{
+	const auto &x = m_entries[a];
+	const auto &y = m_entries[b];
+	if (heap == SERVE)
+	{
+		return x.priority > y.priority || (x.priority == y.priority && x.sequence < y.sequence);
+	}
+	return x.priority < y.priority || (x.priority == y.priority && x.sequence > y.sequence);
+}
+
+void PriorityMempool::place(Heap heap, size_t position, uint32_t index)
+{
+	m_heaps[heap][position] = index;
+	m_entries[index].position[heap] = (uint32_t)position;
+}
+
+void PriorityMempool::sift_up(Heap heap, size_t position)
+{
+	const auto index = m_heaps[heap][position];
+	while (position > 0)
+	{
+		const auto parent = (position - 1) / 2;
+		if (!before(heap, index, m_heaps[heap][parent]))
+		{
+			break;
+		}
+		place(heap, position, m_heaps[heap][parent]);
+		position = parent;
+	}
+	place(heap, position, index);
+}
+
+void PriorityMempool::sift_down(Heap heap, size_t position)
+{
+	auto &entries = m_heaps[heap];
+	const auto index = entries[position];
+	while (true)
+	{
+		auto child = 2 * position + 1;
+		if (child >= entries.size())
+		{
+			break;
+		}
+		if (child + 1 < entries.size() && before(heap, entries[child + 1], entries[child]))
+		{
+			child++;
+		}
+		if (!before(heap, entries[child], index))
+		{
+			break;
+		}
+		place(heap, position, entries[child]);
+		position = child;
+	}
+	place(heap, position, index);
+}
+
+template <typename Visitor> void PriorityMempool::visit(Heap heap, Visitor visitor) const
+{
+	// the children of a visited entry are the next candidates, so only the visited part of the heap is ordered
+	const auto &entries = m_heaps[heap];
+	auto after = [&](size_t a, size_t b) { return before(heap, entries[b], entries[a]); };
+	std::priority_queue<size_t, std::vector<size_t>, decltype(after)> candidates{after};
+
+	if (!entries.empty())
+	{
+		candidates.push(0);
+	}
+	while (!candidates.empty())
+	{
+		const auto position = candidates.top();
+		candidates.pop();
+		if (!visitor(m_entries[entries[position]]))
+		{
+			return;
+		}
+
+		for (auto child : {2 * position + 1, 2 * position + 2})
+		{
+			if (child < entries.size())
+			{
+				candidates.push(child);
+			}
+		}
+	}
+}
+
+void PriorityMempool::erase(uint32_t index)
+{
+	auto &entry = m_entries[index];
+	m_bytes -= entry.transaction.data().size();
+	m_index.erase(short_id(entry.transaction.hash()));
+
+	for (auto heap : {SERVE, EVICT})
+	{
+		const auto position = entry.position[heap];
+		const auto last = m_heaps[heap].back();
+		m_heaps[heap].pop_back();
+		if (position < m_heaps[heap].size())
+		{
+			place(heap, position, last);
+			sift_up(heap, position);
+			sift_down(heap, m_entries[last].position[heap]);
+		}
+	}
+
+	// move the last entry into the hole
+	const auto last = (uint32_t)(m_entries.size() - 1);
+	if (index != last)
+	{
+		m_entries[index] = std::move(m_entries[last]);
+		for (auto heap : {SERVE, EVICT})
+		{
+			m_heaps[heap][m_entries[index].position[heap]] = index;
+		}
+		m_index.find(short_id(m_entries[index].transaction.hash()))->second = index;
+	}
+	m_entries.pop_back();
+}
+
+} // namespace Quasar
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "mempool.h"
+
+namespace Quasar
+{
+
+// PriorityMempool serves transactions by priority, highest first, and those of equal priority in the order in which
+// they arrived. Once the budget is used up, a transaction evicts transactions with a lower priority, newest first, and
+// is rejected if that does not make enough room.
+// Transactions are kept in two indexed heaps, one that serves them and one that evicts them; each transaction knows its
+// position in both, so that any transaction can be removed in logarithmic time.
+class PriorityMempool : public Mempool
+{
+  public:
+	PriorityMempool(TransactionPriority priority, size_t max_bytes = SIZE_MAX);
+
+	bool add(const Transaction &transaction) override;
+	std::vector<Transaction> take(size_t max_txs, size_t max_bytes, const Exclude &exclude = {}) override;
+	void remove(const Payload &payload) override;
+	std::optional<Transaction> find(uint64_t short_id) const override;
+	// free_bytes is the whole budget, as transactions with a higher priority can always make room by eviction
+	size_t free_bytes() const override;
+	Stats stats() const override;
+
+  private:
+	enum Heap
+	{
+		SERVE,
+		EVICT,
+		HEAPS,
+	};
+
+	struct Entry
+	{
+		Transaction transaction;
+		uint64_t priority;
+		uint64_t sequence;
+		std::array<uint32_t, HEAPS> position;
+	};
+
+	// before returns whether the entry at index a comes before the one at index b in the heap
+	bool before(Heap heap, uint32_t a, uint32_t b) const;
+	void place(Heap heap, size_t position, uint32_t index);
+	void sift_up(Heap heap, size_t position);
+	void sift_down(Heap heap, size_t position);
+
+	// visit calls visitor with the entries of the heap in heap order, until it returns false
+	template <typename Visitor> void visit(Heap heap, Visitor visitor) const;
+
+	void erase(uint32_t index);
+
+	mutable std::mutex m_mutex;
+	TransactionPriority m_priority;
+
+	// entries are kept dense, so the heaps and the index refer to them by position
+	std::vector<Entry> m_entries;
+	std::array<std::vector<uint32_t>, HEAPS> m_heaps;
+	FlatMap<uint64_t, uint32_t> m_index;
+
+	const size_t m_max_bytes;
+	size_t m_bytes;
+	uint64_t m_sequence;
+	uint64_t m_evicted;
+	uint64_t m_rejected;
+};
+
+} // namespace Quasar
@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+#include "priority_mempool.h"
+
+namespace
+{
+
+// make_tx creates a transaction whose first byte is its priority
+Quasar::Transaction make_tx(uint8_t priority, uint32_t id, size_t size = 100)
+{
+	std::vector<std::byte> data(size);
+	data[0] = std::byte{priority};
+	std::memcpy(data.data() + 1, &id, sizeof(id));
+	return Quasar::Transaction{data};
+}
+
+uint64_t priority_of(const Quasar::Transaction &transaction)
+{
+	return (uint64_t)transaction.data()[0];
+}
+
+std::vector<uint64_t> priorities(const std::vector<Quasar::Transaction> &transactions)
+{
+	std::vector<uint64_t> result;
+	for (const auto &transaction : transactions)
+	{
+		result.push_back(priority_of(transaction));
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("PriorityMempool serves the highest priority first", "[priority_mempool]")
+{
+	Quasar::PriorityMempool mempool{priority_of};
+	mempool.add(make_tx(2, 0));
+	mempool.add(make_tx(5, 1));
+	mempool.add(make_tx(2, 2));
+	mempool.add(make_tx(9, 3));
+	REQUIRE(!mempool.add(make_tx(9, 3)));
+
+	REQUIRE((priorities(mempool.take(SIZE_MAX, SIZE_MAX)) == std::vector<uint64_t>{9, 5, 2, 2}));
+	REQUIRE((priorities(mempool.take(2, SIZE_MAX)) == std::vector<uint64_t>{9, 5}));
+	REQUIRE((priorities(mempool.take(SIZE_MAX, 300)) == std::vector<uint64_t>{9, 5, 2}));
+
+	// transactions of equal priority are served in the order in which they arrived
+	auto taken = mempool.take(SIZE_MAX, SIZE_MAX);
+	REQUIRE(taken[2].hash() == make_tx(2, 0).hash());
+
+	// excluded transactions are skipped without hiding the ones after them
+	const auto excluded = make_tx(9, 3).hash();
+	REQUIRE((priorities(mempool.take(SIZE_MAX, SIZE_MAX, [&](const Quasar::Hash &hash) {
+		         return hash == excluded;
+	         })) == std::vector<uint64_t>{5, 2, 2}));
+}
+
+TEST_CASE("PriorityMempool drops transactions that exceed the budget of take on their own", "[priority_mempool]")
+{
+	Quasar::PriorityMempool mempool{priority_of};
+	mempool.add(make_tx(9, 0, 2000));
+	mempool.add(make_tx(5, 1));
+
+	REQUIRE((priorities(mempool.take(SIZE_MAX, 1000)) == std::vector<uint64_t>{5}));
+
+	const auto stats = mempool.stats();
+	REQUIRE(stats.transactions == 1);
+	REQUIRE(stats.bytes == 100);
+	REQUIRE(stats.rejected == 1);
+	REQUIRE((priorities(mempool.take(SIZE_MAX, SIZE_MAX)) == std::vector<uint64_t>{5}));
+}
+
+TEST_CASE("PriorityMempool evicts the lowest priority when it is full", "[priority_mempool]")
+{
+	Quasar::PriorityMempool mempool{priority_of, 300};
+	REQUIRE(mempool.add(make_tx(3, 0)));
+	REQUIRE(mempool.add(make_tx(1, 1)));
+	REQUIRE(mempool.add(make_tx(1, 2)));
+
+	// the newest of the lowest priority goes first
+	REQUIRE(mempool.add(make_tx(4, 3)));
+	REQUIRE(!mempool.find(Quasar::short_id(make_tx(1, 2).hash())));
+	REQUIRE(mempool.find(Quasar::short_id(make_tx(1, 1).hash())));
+
+	// a transaction that would have to evict one of higher or equal priority is rejected, and nothing is evicted
+	REQUIRE(!mempool.add(make_tx(1, 4)));
+	REQUIRE(!mempool.add(make_tx(2, 5, 250)));
+	REQUIRE(mempool.size() == 3);
+
+	auto stats = mempool.stats();
+	REQUIRE(stats.bytes == 300);
+	REQUIRE(stats.evicted == 1);
+	REQUIRE(stats.rejected == 2);
+
+	// a large transaction may evict several
+	REQUIRE(mempool.add(make_tx(5, 6, 200)));
+	REQUIRE((priorities(mempool.take(SIZE_MAX, SIZE_MAX)) == std::vector<uint64_t>{5, 4}));
+	REQUIRE(mempool.stats().evicted == 3);
+}
+
+TEST_CASE("PriorityMempool keeps its heaps in order when transactions are removed", "[priority_mempool]")
+{
+	Quasar::PriorityMempool mempool{priority_of};
+	std::mt19937 random{7};
+	std::vector<Quasar::Transaction> transactions;
+	for (uint32_t i = 0; i < 500; i++)
+	{
+		transactions.push_back(make_tx((uint8_t)random(), i));
+		mempool.add(transactions.back());
+	}
+
+	std::shuffle(transactions.begin(), transactions.end(), random);
+	transactions.erase(transactions.begin() + 250, transactions.end());
+	mempool.remove(Quasar::Payload{transactions});
+	REQUIRE(mempool.size() == 250);
+
+	auto taken = priorities(mempool.take(SIZE_MAX, SIZE_MAX));
+	REQUIRE(taken.size() == 250);
+	REQUIRE(std::is_sorted(taken.rbegin(), taken.rend()));
+}
@@ -1,73 +1,160 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <utility>
 
-#include "crypto.h"
 #include "exception.h"
+#include "priority_mempool.h"
 #include "quasar.h"
 
 namespace Quasar
 {
 
+namespace
+{
+
+std::shared_ptr<Mempool> make_mempool(const Settings::Mempool &settings)
+{
+	if (settings.ordering() == MempoolOrdering::PRIORITY)
+	{
+		return std::make_shared<PriorityMempool>(settings.priority(), settings.max_bytes());
+	}
+	return std::make_shared<ShardedMempool>(settings.max_bytes());
+}
+
+} // namespace
+
 Quasar::Quasar(const Settings &settings, std::shared_ptr<Keystore> keystore, std::shared_ptr<Network> network,
                std::shared_ptr<LeaderRotation> leader_rotation)
-    : m_keystore(std::move(keystore)), m_network(std::move(network)), m_logger(spdlog::stderr_color_mt("stderr")),
-      m_leader_rotation(std::move(leader_rotation))
+    : m_reactor(std::make_shared<Reactor>()),
+      m_event_queue(std::make_shared<EventQueue>(2 * settings.inbound().queue_size())),
+      m_blockchain(std::make_shared<Blockchain>(settings.consensus().block_retention())),
+      m_keystore(std::move(keystore)), m_verifier(std::make_shared<CertificateVerifier>(m_keystore, settings.crypto())),
+      m_mempool(make_mempool(settings.mempool())), m_network(std::move(network)),
+      m_logger(spdlog::stderr_color_mt("stderr")), m_leader_rotation(std::move(leader_rotation)), m_stopped(false)
 {
-	m_consensus = std::make_shared<Consensus>(m_event_queue, m_blockchain, m_keystore, m_network, m_synchronizer,
-	                                          m_leader_rotation, m_logger);
-	m_consensus->init();
+	// events queued from other threads wake the loop through the reactor
+	m_event_queue->set_waker([reactor = m_reactor] { reactor->wake(); });
 
-	m_synchronizer = std::make_shared<Synchronizer>(RoundDuration{settings.round_duration()}, m_event_queue, m_network,
-	                                                m_keystore, m_logger);
+	m_synchronizer = std::make_shared<Synchronizer>(RoundDuration{settings.round_duration()}, m_event_queue, m_reactor,
+	                                                m_network, m_keystore, m_verifier, m_logger);
 	m_synchronizer->init();
 
-	// push network messages to event_queue
-	m_network->set_message_handler(
-	    [keystore = m_keystore, event_queue = m_event_queue, logger = m_logger](auto &message) {
-		    Signature sig{message.signature()};
-
-		    auto key = keystore->find_public_key(sig.signer());
-		    if (key == nullptr)
-		    {
-			    logger->warn("public key with ID {:.8} not found", sig.signer().to_hex_string());
-			    return;
-		    }
-
-		    if (!Crypto::verify(sig, message.data().SerializeAsString(), *key))
-		    {
-			    logger->warn("message received with invalid signature");
-			    return;
-		    }
-
-		    event_queue->dispatch(EventType::MESSAGE, std::make_pair(sig, std::move(message.data())));
+	m_dissemination = std::make_shared<Dissemination>(settings.dissemination(), m_event_queue, m_reactor, m_mempool,
+	                                                  m_network, m_keystore, m_verifier, m_logger);
+	m_dissemination->init();
+
+	// committed transactions leave the mempool, whether they are in the payload of a block or in the batches that it
+	// refers to, and those batches are no longer proposed
+	m_blockchain->set_commit_handler(
+	    [mempool = m_mempool, dissemination = m_dissemination](const std::shared_ptr<Block> &block) {
+		    mempool->remove(block->payload());
+		    dissemination->commit(*block);
 	    });
 
-	// add event handler to execute callbacks
-	m_event_queue->appendListener(EventType::CALLBACK,
-	                              [](const EventData &event) { std::get<std::function<void()>>(event)(); });
+	m_consensus = std::make_shared<Consensus>(settings.consensus(), m_event_queue, m_reactor, m_blockchain,
+	                                          m_keystore, m_verifier, m_mempool, m_dissemination, m_network,
+	                                          m_synchronizer, m_leader_rotation, m_logger);
+	m_consensus->init();
+
+	// push network messages to event_queue; they are parsed and verified off the consensus thread
+	m_pipeline = std::make_shared<InboundPipeline>(settings.inbound(), settings.crypto(), m_event_queue, m_keystore,
+	                                               m_verifier, m_logger);
+	m_pipeline->init();
+
+	if (!m_network->set_frame_handler([pipeline = m_pipeline](Frame frame) { pipeline->submit(std::move(frame)); }))
+	{
+		m_network->set_message_handler(
+		    [pipeline = m_pipeline](MessagePtr message) { pipeline->submit(std::move(message)); });
+	}
+
+	if (settings.ingestion().enabled())
+	{
+		m_ingestion =
+		    std::make_unique<Ingestion>(settings.ingestion().port(), settings.ingestion(), m_mempool, m_logger);
+	}
+}
+
+Quasar::~Quasar()
+{
+	// the network and the event queue hold on to the pipeline, so its workers are stopped explicitly
+	m_pipeline->stop();
 }
 
 void Quasar::run()
 {
-	using namespace std::chrono_literals;
+	m_network->attach(*m_reactor);
+
+	while (!m_stopped)
+	{
+		m_event_queue->process();
+
+		// sleep until a socket, a timer or another thread has work for the loop; sockets and timers are still checked
+		// without sleeping when more events are queued
+		const auto idle = m_event_queue->prepare_wait();
+		m_reactor->poll(idle ? Reactor::INFINITE : std::chrono::milliseconds::zero());
+		m_event_queue->finish_wait();
+	}
+
+	auto stats = m_verifier->stats();
+	m_logger->info("verified {} certificates ({} invalid), mean latency {}us, max latency {}us", stats.certificates,
+	               stats.failures, stats.mean_latency().count() / 1000, stats.max_latency.count() / 1000);
+	m_logger->info("skipped {} cached certificates and {} cached signatures", stats.cached_certificates,
+	               stats.cached_signatures);
 
-	std::shared_ptr<PolledNetwork> polled_network;
+	auto inbound = m_pipeline->stats();
+	m_logger->info("received {} messages ({} malformed, {} obsolete, {} duplicates, {} rejected), delivered {}",
+	               inbound.received, inbound.malformed, inbound.obsolete, inbound.duplicates, inbound.rejected,
+	               inbound.delivered);
 
-	if (m_network->type() == NetworkType::POLLED)
+	auto blocks = m_blockchain->stats();
+	m_logger->info("blockchain holds {} blocks; pruned {}, abandoned {} on forks", blocks.blocks, blocks.pruned,
+	               blocks.abandoned);
+
+	auto mempool = m_mempool->stats();
+	m_logger->info("mempool holds {} transactions in {} bytes; evicted {}, rejected {}", mempool.transactions,
+	               mempool.bytes, mempool.evicted, mempool.rejected);
+
+	if (m_ingestion)
 	{
-		polled_network = std::dynamic_pointer_cast<PolledNetwork>(m_network);
+		auto ingestion = m_ingestion->stats();
+		m_logger->info("clients submitted {} times ({} throttled, {} full, {} busy, {} malformed); added {} "
+		               "transactions ({} invalid, {} rejected)",
+		               ingestion.submissions, ingestion.throttled, ingestion.full, ingestion.busy,
+		               ingestion.malformed, ingestion.added, ingestion.invalid, ingestion.rejected);
 	}
 
-	while (!m_stopped)
+	if (auto network = std::dynamic_pointer_cast<ZMQNetwork>(m_network))
 	{
-		m_event_queue->process();
-		polled_network->poll(1ms);
+		auto batches = network->batch_stats();
+		m_logger->info("sent {} messages in {} batches, {:.1f} messages per batch, at most {}; dropped {}, purged {}",
+		               batches.messages, batches.batches, batches.mean_messages(), batches.max_messages,
+		               batches.dropped, batches.purged);
 	}
 }
 
 void Quasar::stop()
 {
-	m_stopped = false;
+	m_stopped = true;
+	m_reactor->wake();
+}
+
+bool Quasar::submit_transaction(const Transaction &transaction)
+{
+	return m_mempool->add(transaction);
+}
+
+CertificateVerifier::Stats Quasar::certificate_stats() const
+{
+	return m_verifier->stats();
+}
+
+InboundPipeline::Stats Quasar::inbound_stats() const
+{
+	return m_pipeline->stats();
+}
+
+Mempool::Stats Quasar::mempool_stats() const
+{
+	return m_mempool->stats();
 }
 
 } // namespace Quasar
\ No newline at end of file
@@ -1,16 +1,23 @@
 #pragma once
 
 #include <botan/pubkey.h>
+#include <atomic>
 #include <memory>
 #include <spdlog/spdlog.h>
 #include <variant>
 
 #include "blockchain.h"
+#include "certificate_verifier.h"
 #include "consensus.h"
+#include "dissemination.h"
 #include "event.h"
+#include "inbound_pipeline.h"
+#include "ingestion.h"
 #include "keystore.h"
 #include "leader_rotation.h"
+#include "mempool.h"
 #include "network.h"
+#include "reactor.h"
 #include "settings.h"
 #include "synchronizer.h"
 
@@ -22,21 +29,37 @@ class Quasar
   public:
 	Quasar(const Settings &settings, std::shared_ptr<Keystore> keystore, std::shared_ptr<Network> network,
 	       std::shared_ptr<LeaderRotation> leader_rotation);
+	~Quasar();
 
 	void run();
 	void stop();
 
+	// submit_transaction adds a transaction to the mempool and returns false if it was already there or did not fit; it
+	// may be called from any thread
+	bool submit_transaction(const Transaction &transaction);
+
+	CertificateVerifier::Stats certificate_stats() const;
+	InboundPipeline::Stats inbound_stats() const;
+	Mempool::Stats mempool_stats() const;
+
   private:
+	std::shared_ptr<Reactor> m_reactor;
 	std::shared_ptr<EventQueue> m_event_queue;
 	std::shared_ptr<Blockchain> m_blockchain;
 	std::shared_ptr<Keystore> m_keystore;
+	std::shared_ptr<CertificateVerifier> m_verifier;
+	std::shared_ptr<Mempool> m_mempool;
+	std::shared_ptr<Dissemination> m_dissemination;
+	std::shared_ptr<InboundPipeline> m_pipeline;
+	// ingestion is only created if clients may submit transactions
+	std::unique_ptr<Ingestion> m_ingestion;
 	std::shared_ptr<Network> m_network;
 	std::shared_ptr<Synchronizer> m_synchronizer;
 	std::shared_ptr<Consensus> m_consensus;
 	std::shared_ptr<spdlog::logger> m_logger;
 	std::shared_ptr<LeaderRotation> m_leader_rotation;
 
-	bool m_stopped;
+	std::atomic<bool> m_stopped;
 };
 
 } // namespace Quasar
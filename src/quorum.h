@@ -3,12 +3,12 @@
 namespace Quasar
 {
 
-int num_faulty(int n)
+inline int num_faulty(int n)
 {
 	return (n - 1) / 3;
 }
 
-int quorum_size(int n)
+inline int quorum_size(int n)
 {
 	return n - num_faulty(n);
 }
@@ -0,0 +1,175 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "exception.h"
+#include "reactor.h"
+
+namespace Quasar
+{
+
+namespace
+{
+
+const int MAX_EVENTS = 64;
+
+} // namespace
+
+Reactor::Reactor() : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)), m_wake_fd(-1), m_woken(false)
+{
+	if (m_epoll_fd < 0)
+	{
+		throw QUASAR_EXCEPTION("could not create epoll instance: {}", std::strerror(errno));
+	}
+
+	m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_wake_fd < 0)
+	{
+		close(m_epoll_fd);
+		throw QUASAR_EXCEPTION("could not create eventfd: {}", std::strerror(errno));
+	}
+
+	add(m_wake_fd, [this] {
+		// drain before clearing the flag: a wake in between finds the flag set and does not write, which is fine as
+		// this poll returns anyway, whereas a write that was drained after clearing would leave the flag set for good
+		uint64_t count;
+		while (read(m_wake_fd, &count, sizeof(count)) > 0)
+		{
+		}
+		m_woken = false;
+	});
+}
+
+Reactor::~Reactor()
+{
+	close(m_wake_fd);
+	close(m_epoll_fd);
+}
+
+void Reactor::add(int fd, std::function<void()> handler, bool edge_triggered)
+{
+	epoll_event event{};
+	event.events = EPOLLIN;
+	if (edge_triggered)
+	{
+		event.events |= EPOLLET;
+	}
+	event.data.fd = fd;
+
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+	{
+		throw QUASAR_EXCEPTION("could not add file descriptor {} to epoll: {}", fd, std::strerror(errno));
+	}
+
+	if ((size_t)fd >= m_handlers.size())
+	{
+		m_handlers.resize(fd + 1);
+	}
+	m_handlers[fd] = std::move(handler);
+}
+
+void Reactor::remove(int fd)
+{
+	if (epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) != 0)
+	{
+		throw QUASAR_EXCEPTION("could not remove file descriptor {} from epoll: {}", fd, std::strerror(errno));
+	}
+	m_handlers[fd] = nullptr;
+}
+
+Reactor::TimerId Reactor::add_timer(Clock::time_point deadline, Callback callback)
+{
+	return m_timers.add(deadline, std::move(callback));
+}
+
+bool Reactor::cancel_timer(TimerId id)
+{
+	return m_timers.cancel(id);
+}
+
+void Reactor::defer(Callback callback)
+{
+	m_deferred.push_back(std::move(callback));
+}
+
+void Reactor::wake()
+{
+	// a single write is enough to wake the poll, until it has drained the eventfd
+	if (m_woken.exchange(true))
+	{
+		return;
+	}
+
+	const uint64_t count = 1;
+	if (write(m_wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+	{
+		throw QUASAR_EXCEPTION("could not write to eventfd: {}", std::strerror(errno));
+	}
+}
+
+size_t Reactor::poll(std::chrono::milliseconds timeout)
+{
+	std::array<epoll_event, MAX_EVENTS> events{};
+
+	int count;
+	do
+	{
+		count = epoll_wait(m_epoll_fd, events.data(), MAX_EVENTS, (int)wait_time(timeout).count());
+	} while (count < 0 && errno == EINTR);
+
+	if (count < 0)
+	{
+		throw QUASAR_EXCEPTION("epoll_wait failed: {}", std::strerror(errno));
+	}
+
+	size_t handled = 0;
+	for (int i = 0; i < count; i++)
+	{
+		// a handler may have removed a later file descriptor of the same batch
+		const auto fd = events[i].data.fd;
+		if ((size_t)fd < m_handlers.size() && m_handlers[fd])
+		{
+			m_handlers[fd]();
+			handled++;
+		}
+	}
+
+	handled += m_timers.advance(Clock::now());
+
+	// callbacks that are deferred by these callbacks run on the next poll
+	std::swap(m_running, m_deferred);
+	for (auto &callback : m_running)
+	{
+		callback();
+	}
+	handled += m_running.size();
+	m_running.clear();
+
+	return handled;
+}
+
+std::chrono::milliseconds Reactor::wait_time(std::chrono::milliseconds timeout) const
+{
+	if (!m_deferred.empty())
+	{
+		return std::chrono::milliseconds::zero();
+	}
+
+	const auto deadline = m_timers.next_deadline();
+	if (!deadline)
+	{
+		return timeout;
+	}
+
+	// round up, so that the timer is due when epoll_wait returns
+	auto until_deadline = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now());
+	until_deadline = std::max(until_deadline, std::chrono::milliseconds::zero());
+
+	return timeout == INFINITE ? until_deadline : std::min(timeout, until_deadline);
+}
+
+} // namespace Quasar
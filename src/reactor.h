@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "event.h"
+#include "timer_wheel.h"
+
+namespace Quasar
+{
+
+// Reactor waits with a single epoll instance for readable file descriptors, timer deadlines and wake-ups from other
+// threads, and runs their handlers on the thread that calls poll. Apart from wake, it must only be used from that
+// thread.
+class Reactor
+{
+  public:
+	using Clock = TimerWheel::Clock;
+	using TimerId = TimerWheel::TimerId;
+
+	static constexpr std::chrono::milliseconds INFINITE{-1};
+
+	Reactor();
+	~Reactor();
+
+	Reactor(const Reactor &) = delete;
+	Reactor &operator=(const Reactor &) = delete;
+
+	// add runs the handler whenever fd becomes readable.
+	// An edge-triggered handler only runs when new data arrives, so it has to consume everything that is readable.
+	void add(int fd, std::function<void()> handler, bool edge_triggered = false);
+	void remove(int fd);
+
+	// add_timer runs the callback once, on the first poll after the deadline
+	TimerId add_timer(Clock::time_point deadline, Callback callback);
+	// cancel_timer returns false if the timer already ran or was cancelled
+	bool cancel_timer(TimerId id);
+
+	// defer runs the callback on the next poll, after the handlers of that poll, and without waiting
+	void defer(Callback callback);
+
+	// wake makes a blocked poll return; it may be called from any thread
+	void wake();
+
+	// poll waits until a file descriptor is readable, a timer is due, wake is called or the timeout expires, and
+	// then runs the handlers of everything that is ready. It returns the number of handlers that ran.
+	size_t poll(std::chrono::milliseconds timeout = INFINITE);
+
+  private:
+	std::chrono::milliseconds wait_time(std::chrono::milliseconds timeout) const;
+
+	int m_epoll_fd;
+	int m_wake_fd;
+	std::atomic<bool> m_woken;
+
+	// handlers are indexed by file descriptor, which the kernel allocates densely
+	std::vector<std::function<void()>> m_handlers;
+
+	TimerWheel m_timers;
+	std::vector<Callback> m_deferred;
+	std::vector<Callback> m_running;
+};
+
+} // namespace Quasar
@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include "reactor.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Reactor runs the handler of a readable file descriptor", "[reactor]")
+{
+	Quasar::Reactor reactor;
+
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+
+	int reads = 0;
+	reactor.add(fds[0], [&] {
+		char c;
+		REQUIRE(read(fds[0], &c, 1) == 1);
+		reads++;
+	});
+
+	REQUIRE(reactor.poll(0ms) == 0);
+
+	REQUIRE(write(fds[1], "x", 1) == 1);
+	REQUIRE(reactor.poll(1000ms) == 1);
+	REQUIRE(reads == 1);
+
+	reactor.remove(fds[0]);
+	REQUIRE(write(fds[1], "x", 1) == 1);
+	REQUIRE(reactor.poll(0ms) == 0);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST_CASE("Reactor runs timers in the order of their deadlines", "[reactor]")
+{
+	Quasar::Reactor reactor;
+	std::vector<int> order;
+
+	const auto now = Quasar::Reactor::Clock::now();
+	reactor.add_timer(now + 20ms, [&] { order.push_back(2); });
+	reactor.add_timer(now + 10ms, [&] { order.push_back(1); });
+	auto cancelled = reactor.add_timer(now + 15ms, [&] { order.push_back(3); });
+	reactor.cancel_timer(cancelled);
+
+	// without other work, poll sleeps until the next deadline
+	while (order.size() < 2)
+	{
+		reactor.poll();
+	}
+	REQUIRE((order == std::vector<int>{1, 2}));
+	REQUIRE(Quasar::Reactor::Clock::now() >= now + 20ms);
+}
+
+TEST_CASE("Reactor runs deferred callbacks on the next poll", "[reactor]")
+{
+	Quasar::Reactor reactor;
+	int calls = 0;
+
+	reactor.defer([&] {
+		calls++;
+		reactor.defer([&] { calls++; });
+	});
+
+	// a deferred callback does not let poll wait
+	REQUIRE(reactor.poll() == 1);
+	REQUIRE(calls == 1);
+	REQUIRE(reactor.poll() == 1);
+	REQUIRE(calls == 2);
+	REQUIRE(reactor.poll(0ms) == 0);
+}
+
+TEST_CASE("Reactor wakes up from another thread", "[reactor]")
+{
+	Quasar::Reactor reactor;
+	Quasar::EventQueue queue;
+	queue.set_waker([&reactor] { reactor.wake(); });
+
+	bool received = false;
+	queue.append_listener<Quasar::TimeoutEvent>([&](const Quasar::TimeoutEvent &) { received = true; });
+
+	REQUIRE(queue.prepare_wait());
+	std::thread producer{[&queue] {
+		std::this_thread::sleep_for(10ms);
+		queue.enqueue(Quasar::TimeoutEvent{1});
+	}};
+
+	REQUIRE(reactor.poll() == 1);
+	queue.finish_wait();
+	producer.join();
+
+	REQUIRE(queue.process() == 1);
+	REQUIRE(received);
+}
+
+TEST_CASE("Reactor does not lose a wake-up that arrives while it drains the previous one", "[reactor]")
+{
+	Quasar::Reactor reactor;
+
+	// wakes from another thread keep landing while the reactor drains its eventfd; a lost wake-up would leave the
+	// reactor believing it is still woken, so no later wake would write and poll would sleep until its timeout
+	std::atomic<bool> done = false;
+	std::thread waker{[&] {
+		while (!done)
+		{
+			reactor.wake();
+		}
+	}};
+	for (int i = 0; i < 10000; i++)
+	{
+		REQUIRE(reactor.poll(1000ms) == 1);
+	}
+	done = true;
+	waker.join();
+	reactor.poll(0ms);
+
+	const auto start = Quasar::Reactor::Clock::now();
+	std::thread late{[&reactor] {
+		std::this_thread::sleep_for(10ms);
+		reactor.wake();
+	}};
+	REQUIRE(reactor.poll(1000ms) == 1);
+	late.join();
+	REQUIRE(Quasar::Reactor::Clock::now() - start < 500ms);
+}
@@ -0,0 +1,273 @@
+#include <botan/exceptn.h>
+
+#include <array>
+
+#include "crypto.h"
+#include "exception.h"
+#include "schnorr.h"
+
+namespace Quasar::Schnorr
+{
+
+namespace
+{
+
+const std::string CHALLENGE_TAG = "Quasar/Schnorr/challenge";
+const std::string AGGREGATE_TAG = "Quasar/Schnorr/aggregate";
+
+const size_t WINDOW_BITS = 4;
+const size_t WINDOW_SIZE = 1 << WINDOW_BITS;
+
+size_t point_size(const Botan::EC_Group &group)
+{
+	return 1 + group.get_p_bytes();
+}
+
+size_t scalar_size(const Botan::EC_Group &group)
+{
+	return group.get_order_bytes();
+}
+
+Botan::BigInt to_scalar(const Botan::EC_Group &group, const Hash &hash)
+{
+	return group.mod_order(Botan::BigInt{hash.data(), hash.size()});
+}
+
+Hash finish(Botan::HashFunction &hash_fn)
+{
+	Hash hash{};
+	hash_fn.final(hash.data());
+	return hash;
+}
+
+// challenge computes e = H(R || P || m), which binds a share to its nonce, its signer and the message
+Botan::BigInt challenge(const Botan::EC_Group &group, const uint8_t *nonce, const PublicKey &key,
+                        const std::string &message)
+{
+	auto &hash_fn = Crypto::hasher();
+	hash_fn.update(CHALLENGE_TAG);
+	hash_fn.update(nonce, point_size(group));
+	hash_fn.update(key.encoded);
+	hash_fn.update(message);
+	return to_scalar(group, finish(hash_fn));
+}
+
+// coefficients computes a_i = H(H(R_1 || ... || R_n || P_1 || ... || P_n || m) || i), the weight of share i in
+// the aggregate; the weights depend on all shares, so a signer cannot pick its share to cancel out others
+std::vector<Botan::BigInt> coefficients(const Botan::EC_Group &group, std::span<const uint8_t> nonces,
+                                        std::span<const PublicKey *const> keys, const std::string &message)
+{
+	auto &hash_fn = Crypto::hasher();
+	hash_fn.update(AGGREGATE_TAG);
+	hash_fn.update(nonces.data(), nonces.size());
+	for (const auto *key : keys)
+	{
+		hash_fn.update(key->encoded);
+	}
+	hash_fn.update(message);
+	const auto seed = finish(hash_fn);
+
+	std::vector<Botan::BigInt> result;
+	result.reserve(keys.size());
+	for (uint32_t i = 0; i < keys.size(); i++)
+	{
+		const std::array<uint8_t, 4> index{(uint8_t)(i >> 24), (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i};
+		hash_fn.update(seed.data(), seed.size());
+		hash_fn.update(index.data(), index.size());
+		result.push_back(to_scalar(group, finish(hash_fn)));
+	}
+	return result;
+}
+
+// multi_multiply computes the sum of scalars[i] * points[i] with Straus' method: the points share a single chain
+// of doublings, and each point adds one precomputed multiple of itself per window of its scalar.
+Botan::PointGFp multi_multiply(const Botan::EC_Group &group, const std::vector<Botan::PointGFp> &points,
+                               const std::vector<Botan::BigInt> &scalars)
+{
+	std::vector<Botan::BigInt> ws(Botan::PointGFp::WORKSPACE_SIZE);
+
+	// tables[i * (WINDOW_SIZE - 1) + d - 1] holds d * points[i]
+	std::vector<Botan::PointGFp> tables;
+	tables.reserve(points.size() * (WINDOW_SIZE - 1));
+	for (const auto &point : points)
+	{
+		tables.push_back(point);
+		for (size_t d = 2; d < WINDOW_SIZE; d++)
+		{
+			auto next = tables.back();
+			next.add(point, ws);
+			tables.push_back(std::move(next));
+		}
+	}
+
+	const size_t windows = (group.get_order().bits() + WINDOW_BITS - 1) / WINDOW_BITS;
+
+	auto result = group.zero_point();
+	for (size_t w = windows; w-- > 0;)
+	{
+		for (size_t i = 0; i < WINDOW_BITS; i++)
+		{
+			result.mult2(ws);
+		}
+
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			auto digit = scalars[i].get_substring(w * WINDOW_BITS, WINDOW_BITS);
+			if (digit != 0)
+			{
+				result.add(tables[i * (WINDOW_SIZE - 1) + digit - 1], ws);
+			}
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+PublicKey::PublicKey(const Botan::EC_PublicKey &key)
+    : group(key.domain()), point(key.public_point()), encoded(point.encode(Botan::PointGFp::COMPRESSED))
+{
+}
+
+Share sign(const std::string &message, const Botan::EC_PrivateKey &key, Botan::RandomNumberGenerator &rng)
+{
+	const auto &group = key.domain();
+	const PublicKey public_key{key};
+	std::vector<Botan::BigInt> ws;
+
+	auto k = group.random_scalar(rng);
+	auto share = group.blinded_base_point_multiply(k, rng, ws).encode(Botan::PointGFp::COMPRESSED);
+
+	auto e = challenge(group, share.data(), public_key, message);
+	auto s = group.mod_order(k + group.multiply_mod_order(e, key.private_value()));
+
+	auto s_bytes = Botan::BigInt::encode_1363(s, scalar_size(group));
+	share.insert(share.end(), s_bytes.begin(), s_bytes.end());
+	return share;
+}
+
+bool verify(const Share &share, const std::string &message, const PublicKey &key)
+{
+	const auto &group = key.group;
+	if (share.size() != point_size(group) + scalar_size(group))
+	{
+		return false;
+	}
+
+	try
+	{
+		auto nonce = group.OS2ECP(share.data(), point_size(group));
+		auto s = Botan::BigInt::decode(share.data() + point_size(group), scalar_size(group));
+		if (s >= group.get_order())
+		{
+			return false;
+		}
+
+		// s * G == R + e * P
+		auto e = challenge(group, share.data(), key, message);
+		return group.point_multiply(s, key.point, group.mod_order(group.get_order() - e)) == nonce;
+	}
+	catch (Botan::Exception &)
+	{
+		return false;
+	}
+}
+
+AggregateSignature aggregate(std::span<const Share> shares, std::span<const PublicKey *const> keys,
+                             const std::string &message)
+{
+	if (shares.size() != keys.size())
+	{
+		throw QUASAR_EXCEPTION("cannot aggregate {} shares with {} keys", shares.size(), keys.size());
+	}
+	if (keys.empty())
+	{
+		return {};
+	}
+
+	const auto &group = keys.front()->group;
+
+	AggregateSignature result;
+	result.nonces.reserve(shares.size() * point_size(group));
+	for (size_t i = 0; i < shares.size(); i++)
+	{
+		if (shares[i].size() != point_size(group) + scalar_size(group) || !(keys[i]->group == group))
+		{
+			throw QUASAR_EXCEPTION("share {} does not belong to the curve of the other shares", i);
+		}
+		result.nonces.insert(result.nonces.end(), shares[i].begin(), shares[i].begin() + point_size(group));
+	}
+
+	// s = sum of a_i * s_i
+	auto weights = coefficients(group, result.nonces, keys, message);
+	Botan::BigInt s{0};
+	for (size_t i = 0; i < shares.size(); i++)
+	{
+		auto s_i = Botan::BigInt::decode(shares[i].data() + point_size(group), scalar_size(group));
+		s = group.mod_order(s + group.multiply_mod_order(weights[i], s_i));
+	}
+
+	auto s_bytes = Botan::BigInt::encode_1363(s, scalar_size(group));
+	result.scalar.assign(s_bytes.begin(), s_bytes.end());
+	return result;
+}
+
+bool verify_aggregate(const AggregateSignature &signature, std::span<const PublicKey *const> keys,
+                      const std::string &message)
+{
+	if (keys.empty())
+	{
+		return signature.nonces.empty() && signature.scalar.empty();
+	}
+
+	const auto &group = keys.front()->group;
+	const auto n = keys.size();
+	if (signature.nonces.size() != n * point_size(group) || signature.scalar.size() != scalar_size(group))
+	{
+		return false;
+	}
+
+	try
+	{
+		auto s = Botan::BigInt::decode(signature.scalar.data(), signature.scalar.size());
+		if (s >= group.get_order())
+		{
+			return false;
+		}
+
+		auto weights = coefficients(group, signature.nonces, keys, message);
+
+		// s * G == sum of a_i * (R_i + e_i * P_i), checked as a single multi-scalar multiplication that must be zero
+		std::vector<Botan::PointGFp> points;
+		std::vector<Botan::BigInt> scalars;
+		points.reserve(2 * n + 1);
+		scalars.reserve(2 * n + 1);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (!(keys[i]->group == group))
+			{
+				return false;
+			}
+
+			const auto *nonce = signature.nonces.data() + i * point_size(group);
+			auto e = challenge(group, nonce, *keys[i], message);
+
+			points.push_back(group.OS2ECP(nonce, point_size(group)));
+			scalars.push_back(weights[i]);
+			points.push_back(keys[i]->point);
+			scalars.push_back(group.multiply_mod_order(weights[i], e));
+		}
+
+		points.push_back(group.get_base_point());
+		scalars.push_back(group.mod_order(group.get_order() - s));
+
+		return multi_multiply(group, points, scalars).is_zero();
+	}
+	catch (Botan::Exception &)
+	{
+		return false;
+	}
+}
+
+} // namespace Quasar::Schnorr
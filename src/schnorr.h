@@ -0,0 +1,42 @@
+#pragma once
+
+#include <botan/ec_group.h>
+#include <botan/ecc_key.h>
+#include <botan/rng.h>
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Schnorr signatures over the curve of the validators' EC keys, with half-aggregation: the signatures of many
+// signers over the same message combine into their nonce points and a single scalar, and the combination is
+// verified with one multi-scalar multiplication instead of one verification per signer.
+namespace Quasar::Schnorr
+{
+
+// Share is the Schnorr signature of a single signer: the compressed nonce point R followed by the scalar s.
+using Share = std::vector<uint8_t>;
+
+// PublicKey holds a public point together with its encoding, which is hashed into every challenge.
+struct PublicKey
+{
+	explicit PublicKey(const Botan::EC_PublicKey &key);
+
+	Botan::EC_Group group;
+	Botan::PointGFp point;
+	std::vector<uint8_t> encoded;
+};
+
+Share sign(const std::string &message, const Botan::EC_PrivateKey &key, Botan::RandomNumberGenerator &rng);
+bool verify(const Share &share, const std::string &message, const PublicKey &key);
+
+// aggregate combines the shares of several signers, which must be given in the same order as their keys.
+// The shares are not verified, so a single invalid share makes the aggregate invalid.
+AggregateSignature aggregate(std::span<const Share> shares, std::span<const PublicKey *const> keys,
+                             const std::string &message);
+bool verify_aggregate(const AggregateSignature &signature, std::span<const PublicKey *const> keys,
+                      const std::string &message);
+
+} // namespace Quasar::Schnorr
@@ -0,0 +1,105 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <botan/ecdsa.h>
+#include <botan/system_rng.h>
+
+#include "schnorr.h"
+
+namespace
+{
+
+struct Signers
+{
+	explicit Signers(size_t count)
+	{
+		const Botan::EC_Group group{"secp256r1"};
+		for (size_t i = 0; i < count; i++)
+		{
+			private_keys.emplace_back(Botan::system_rng(), group);
+		}
+		for (const auto &key : private_keys)
+		{
+			public_keys.emplace_back(key);
+		}
+		for (const auto &key : public_keys)
+		{
+			keys.push_back(&key);
+		}
+	}
+
+	std::vector<Quasar::Schnorr::Share> sign(const std::string &message) const
+	{
+		std::vector<Quasar::Schnorr::Share> shares;
+		for (const auto &key : private_keys)
+		{
+			shares.push_back(Quasar::Schnorr::sign(message, key, Botan::system_rng()));
+		}
+		return shares;
+	}
+
+	std::vector<Botan::ECDSA_PrivateKey> private_keys;
+	std::vector<Quasar::Schnorr::PublicKey> public_keys;
+	std::vector<const Quasar::Schnorr::PublicKey *> keys;
+};
+
+} // namespace
+
+TEST_CASE("Schnorr shares verify against the signer and message", "[schnorr]")
+{
+	const Signers signers{2};
+	const auto share = Quasar::Schnorr::sign("block", signers.private_keys[0], Botan::system_rng());
+
+	REQUIRE(Quasar::Schnorr::verify(share, "block", signers.public_keys[0]));
+	REQUIRE_FALSE(Quasar::Schnorr::verify(share, "other block", signers.public_keys[0]));
+	REQUIRE_FALSE(Quasar::Schnorr::verify(share, "block", signers.public_keys[1]));
+
+	auto tampered = share;
+	tampered.back() ^= 1;
+	REQUIRE_FALSE(Quasar::Schnorr::verify(tampered, "block", signers.public_keys[0]));
+	REQUIRE_FALSE(Quasar::Schnorr::verify({}, "block", signers.public_keys[0]));
+}
+
+TEST_CASE("Schnorr aggregates verify as a whole", "[schnorr]")
+{
+	const Signers signers{7};
+	auto shares = signers.sign("block");
+
+	const auto aggregate = Quasar::Schnorr::aggregate(shares, signers.keys, "block");
+	REQUIRE(Quasar::Schnorr::verify_aggregate(aggregate, signers.keys, "block"));
+	REQUIRE_FALSE(Quasar::Schnorr::verify_aggregate(aggregate, signers.keys, "other block"));
+
+	auto reordered = signers.keys;
+	std::swap(reordered[0], reordered[1]);
+	REQUIRE_FALSE(Quasar::Schnorr::verify_aggregate(aggregate, reordered, "block"));
+
+	const std::span<const Quasar::Schnorr::PublicKey *const> fewer{signers.keys.data(), signers.keys.size() - 1};
+	REQUIRE_FALSE(Quasar::Schnorr::verify_aggregate(aggregate, fewer, "block"));
+
+	// a share over a different message spoils the aggregate
+	shares[3] = Quasar::Schnorr::sign("other block", signers.private_keys[3], Botan::system_rng());
+	const auto spoiled = Quasar::Schnorr::aggregate(shares, signers.keys, "block");
+	REQUIRE_FALSE(Quasar::Schnorr::verify_aggregate(spoiled, signers.keys, "block"));
+}
+
+TEST_CASE("Schnorr aggregate verification", "[schnorr][!benchmark]")
+{
+	const Signers signers{64};
+	const auto shares = signers.sign("block");
+	const auto aggregate = Quasar::Schnorr::aggregate(shares, signers.keys, "block");
+
+	BENCHMARK("verify 64 shares")
+	{
+		bool valid = true;
+		for (size_t i = 0; i < shares.size(); i++)
+		{
+			valid &= Quasar::Schnorr::verify(shares[i], "block", signers.public_keys[i]);
+		}
+		return valid;
+	};
+
+	BENCHMARK("verify aggregate of 64 shares")
+	{
+		return Quasar::Schnorr::verify_aggregate(aggregate, signers.keys, "block");
+	};
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "mempool.h"
 #include "types.h"
 
 namespace Quasar
@@ -17,7 +22,10 @@ class Settings
 	friend Setting;
 
   public:
-	template <typename... Args> explicit Settings(Args... args) : m_consensus(), m_round_duration()
+	template <typename... Args>
+	explicit Settings(Args... args)
+	    : m_consensus(), m_round_duration(), m_crypto(), m_inbound(), m_outbound(), m_dissemination(), m_mempool(),
+	      m_ingestion()
 	{
 		([&] { args.apply(*this); }(), ...);
 	}
@@ -25,7 +33,9 @@ class Settings
 	class Consensus
 	{
 	  public:
-		Consensus() : m_allow_empty_blocks(true)
+		Consensus()
+		    : m_allow_empty_blocks(true), m_vote_certificates(CertificateScheme::ECDSA), m_max_block_transactions(4096),
+		      m_max_block_bytes(1024 * 1024), m_compact_proposals(true), m_block_retention(1024)
 		{
 		}
 
@@ -45,13 +55,130 @@ class Settings
 			bool m_choice;
 		};
 
+		// VoteCertificates selects the signature scheme of the certificates that are formed from votes
+		class VoteCertificates : Setting
+		{
+		  public:
+			explicit VoteCertificates(CertificateScheme scheme) : m_scheme(scheme)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_consensus.m_vote_certificates = m_scheme;
+			}
+
+			CertificateScheme m_scheme;
+		};
+
+		// MaxBlockTransactions limits how many transactions the leader takes from the mempool for a block
+		class MaxBlockTransactions : Setting
+		{
+		  public:
+			explicit MaxBlockTransactions(size_t max_block_transactions)
+			    : m_max_block_transactions(max_block_transactions)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_consensus.m_max_block_transactions = m_max_block_transactions;
+			}
+
+			size_t m_max_block_transactions;
+		};
+
+		// MaxBlockBytes limits the combined size of the transactions that the leader takes from the mempool
+		class MaxBlockBytes : Setting
+		{
+		  public:
+			explicit MaxBlockBytes(size_t bytes) : m_bytes(bytes)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_consensus.m_max_block_bytes = m_bytes;
+			}
+
+			size_t m_bytes;
+		};
+
+		// CompactProposals sends proposals with the short IDs of their transactions instead of the transactions, which
+		// replicas then take from their mempool
+		class CompactProposals : Setting
+		{
+		  public:
+			explicit CompactProposals(bool choice) : m_choice(choice)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_consensus.m_compact_proposals = m_choice;
+			}
+
+			bool m_choice;
+		};
+
+		// BlockRetention sets how many rounds of blocks below the committed block are kept; older blocks are pruned
+		class BlockRetention : Setting
+		{
+		  public:
+			explicit BlockRetention(Round rounds) : m_rounds(rounds)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_consensus.m_block_retention = m_rounds;
+			}
+
+			Round m_rounds;
+		};
+
 		bool allow_empty_blocks() const
 		{
 			return m_allow_empty_blocks;
 		}
 
+		CertificateScheme vote_certificates() const
+		{
+			return m_vote_certificates;
+		}
+
+		size_t max_block_transactions() const
+		{
+			return m_max_block_transactions;
+		}
+
+		size_t max_block_bytes() const
+		{
+			return m_max_block_bytes;
+		}
+
+		bool compact_proposals() const
+		{
+			return m_compact_proposals;
+		}
+
+		Round block_retention() const
+		{
+			return m_block_retention;
+		}
+
 	  private:
 		bool m_allow_empty_blocks;
+		CertificateScheme m_vote_certificates;
+		size_t m_max_block_transactions;
+		size_t m_max_block_bytes;
+		bool m_compact_proposals;
+		Round m_block_retention;
 	};
 
 	class RoundDuration
@@ -152,6 +279,619 @@ class Settings
 		double m_timeout_multiplier;
 	};
 
+	class Crypto
+	{
+	  public:
+		Crypto()
+		    : m_verifier_threads(std::max(1u, std::thread::hardware_concurrency())), m_signature_cache_size(65536),
+		      m_certificate_cache_size(1024), m_message_cache_size(65536)
+		{
+		}
+
+		// VerifierThreads sets how many threads verify the signatures of a certificate, including the event loop.
+		class VerifierThreads : Setting
+		{
+		  public:
+			explicit VerifierThreads(size_t threads) : m_threads(threads)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_crypto.m_verifier_threads = std::max<size_t>(1, m_threads);
+			}
+
+			size_t m_threads;
+		};
+
+		// SignatureCacheSize sets how many verified signatures are remembered, so that they are not verified again.
+		class SignatureCacheSize : Setting
+		{
+		  public:
+			explicit SignatureCacheSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_crypto.m_signature_cache_size = m_size;
+			}
+
+			size_t m_size;
+		};
+
+		// CertificateCacheSize sets how many verified certificates are remembered.
+		class CertificateCacheSize : Setting
+		{
+		  public:
+			explicit CertificateCacheSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_crypto.m_certificate_cache_size = m_size;
+			}
+
+			size_t m_size;
+		};
+
+		// MessageCacheSize sets how many received messages are remembered to drop identical copies of them.
+		class MessageCacheSize : Setting
+		{
+		  public:
+			explicit MessageCacheSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_crypto.m_message_cache_size = m_size;
+			}
+
+			size_t m_size;
+		};
+
+		size_t verifier_threads() const
+		{
+			return m_verifier_threads;
+		}
+
+		size_t signature_cache_size() const
+		{
+			return m_signature_cache_size;
+		}
+
+		size_t certificate_cache_size() const
+		{
+			return m_certificate_cache_size;
+		}
+
+		size_t message_cache_size() const
+		{
+			return m_message_cache_size;
+		}
+
+	  private:
+		size_t m_verifier_threads;
+		size_t m_signature_cache_size;
+		size_t m_certificate_cache_size;
+		size_t m_message_cache_size;
+	};
+
+	class Inbound
+	{
+	  public:
+		Inbound() : m_workers(std::max(1u, std::thread::hardware_concurrency())), m_queue_size(4096)
+		{
+		}
+
+		// Workers sets how many threads parse received messages and verify their signatures.
+		class Workers : Setting
+		{
+		  public:
+			explicit Workers(size_t workers) : m_workers(workers)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_inbound.m_workers = std::max<size_t>(1, m_workers);
+			}
+
+			size_t m_workers;
+		};
+
+		// QueueSize sets how many received messages may wait for the consensus thread; receiving blocks beyond it.
+		class QueueSize : Setting
+		{
+		  public:
+			explicit QueueSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_inbound.m_queue_size = std::max<size_t>(1, m_size);
+			}
+
+			size_t m_size;
+		};
+
+		size_t workers() const
+		{
+			return m_workers;
+		}
+
+		size_t queue_size() const
+		{
+			return m_queue_size;
+		}
+
+	  private:
+		size_t m_workers;
+		size_t m_queue_size;
+	};
+
+	class Outbound
+	{
+	  public:
+		Outbound() : m_batch_window(0), m_batch_bytes(256 * 1024), m_queue_size(1024)
+		{
+		}
+
+		// BatchWindow sets how long messages to a peer are held back to send them together as one batch.
+		// With a window of zero, the messages that are sent while handling one batch of events are sent together.
+		class BatchWindow : Setting
+		{
+		  public:
+			explicit BatchWindow(std::chrono::milliseconds window) : m_window(window)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_outbound.m_batch_window = std::max(std::chrono::milliseconds::zero(), m_window);
+			}
+
+			std::chrono::milliseconds m_window;
+		};
+
+		// BatchBytes sets the size of the messages in a batch after which it is sent without waiting for the window.
+		class BatchBytes : Setting
+		{
+		  public:
+			explicit BatchBytes(size_t bytes) : m_bytes(bytes)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_outbound.m_batch_bytes = m_bytes;
+			}
+
+			size_t m_bytes;
+		};
+
+		// QueueSize sets how many messages may wait to be sent to a peer on each lane; further messages are dropped.
+		class QueueSize : Setting
+		{
+		  public:
+			explicit QueueSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_outbound.m_queue_size = std::max<size_t>(1, m_size);
+			}
+
+			size_t m_size;
+		};
+
+		std::chrono::milliseconds batch_window() const
+		{
+			return m_batch_window;
+		}
+
+		size_t batch_bytes() const
+		{
+			return m_batch_bytes;
+		}
+
+		size_t queue_size() const
+		{
+			return m_queue_size;
+		}
+
+	  private:
+		std::chrono::milliseconds m_batch_window;
+		size_t m_batch_bytes;
+		size_t m_queue_size;
+	};
+
+	// Dissemination configures how replicas spread transactions in batches, which proposals then refer to
+	class Dissemination
+	{
+	  public:
+		Dissemination()
+		    : m_enabled(true), m_batch_interval(10), m_batch_transactions(4096), m_batch_bytes(512 * 1024),
+		      m_max_block_batches(64), m_batch_retention(100)
+		{
+		}
+
+		// Enabled selects whether transactions are disseminated in batches; otherwise the leader takes them from the
+		// mempool into its proposal
+		class Enabled : Setting
+		{
+		  public:
+			explicit Enabled(bool choice) : m_choice(choice)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_enabled = m_choice;
+			}
+
+			bool m_choice;
+		};
+
+		// BatchInterval sets how often a replica seals the transactions in its mempool into a batch
+		class BatchInterval : Setting
+		{
+		  public:
+			explicit BatchInterval(std::chrono::milliseconds interval) : m_interval(interval)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_batch_interval = std::max(std::chrono::milliseconds{1}, m_interval);
+			}
+
+			std::chrono::milliseconds m_interval;
+		};
+
+		// BatchTransactions and BatchBytes limit the size of a batch; a batch is sealed early once it is full
+		class BatchTransactions : Setting
+		{
+		  public:
+			explicit BatchTransactions(size_t transactions) : m_transactions(transactions)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_batch_transactions = std::max<size_t>(1, m_transactions);
+			}
+
+			size_t m_transactions;
+		};
+
+		class BatchBytes : Setting
+		{
+		  public:
+			explicit BatchBytes(size_t bytes) : m_bytes(bytes)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_batch_bytes = std::max<size_t>(1, m_bytes);
+			}
+
+			size_t m_bytes;
+		};
+
+		// MaxBlockBatches limits how many batches the leader refers to in a block
+		class MaxBlockBatches : Setting
+		{
+		  public:
+			explicit MaxBlockBatches(size_t batches) : m_batches(batches)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_max_block_batches = m_batches;
+			}
+
+			size_t m_batches;
+		};
+
+		// BatchRetention sets for how many batch intervals a batch is kept; an own batch that no quorum acknowledged
+		// by then is given up, and its transactions are sealed into a batch once more
+		class BatchRetention : Setting
+		{
+		  public:
+			explicit BatchRetention(size_t intervals) : m_intervals(intervals)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_dissemination.m_batch_retention = std::max<size_t>(1, m_intervals);
+			}
+
+			size_t m_intervals;
+		};
+
+		bool enabled() const
+		{
+			return m_enabled;
+		}
+
+		std::chrono::milliseconds batch_interval() const
+		{
+			return m_batch_interval;
+		}
+
+		size_t batch_transactions() const
+		{
+			return m_batch_transactions;
+		}
+
+		size_t batch_bytes() const
+		{
+			return m_batch_bytes;
+		}
+
+		size_t max_block_batches() const
+		{
+			return m_max_block_batches;
+		}
+
+		size_t batch_retention() const
+		{
+			return m_batch_retention;
+		}
+
+	  private:
+		bool m_enabled;
+		std::chrono::milliseconds m_batch_interval;
+		size_t m_batch_transactions;
+		size_t m_batch_bytes;
+		size_t m_max_block_batches;
+		size_t m_batch_retention;
+	};
+
+	class Mempool
+	{
+	  public:
+		Mempool() : m_ordering(MempoolOrdering::ARRIVAL), m_max_bytes(256 * 1024 * 1024)
+		{
+		}
+
+		class Ordering : Setting
+		{
+		  public:
+			explicit Ordering(MempoolOrdering ordering) : m_ordering(ordering)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_mempool.m_ordering = m_ordering;
+			}
+
+			MempoolOrdering m_ordering;
+		};
+
+		// MaxBytes sets the budget for the data of the transactions in the mempool
+		class MaxBytes : Setting
+		{
+		  public:
+			explicit MaxBytes(size_t bytes) : m_bytes(bytes)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_mempool.m_max_bytes = m_bytes;
+			}
+
+			size_t m_bytes;
+		};
+
+		// Priority sets the priority of transactions if they are ordered by priority; without it, all transactions
+		// have the same priority and are served in the order in which they arrived
+		class Priority : Setting
+		{
+		  public:
+			explicit Priority(TransactionPriority priority) : m_priority(std::move(priority))
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_mempool.m_priority = m_priority;
+			}
+
+			TransactionPriority m_priority;
+		};
+
+		MempoolOrdering ordering() const
+		{
+			return m_ordering;
+		}
+
+		size_t max_bytes() const
+		{
+			return m_max_bytes;
+		}
+
+		const TransactionPriority &priority() const
+		{
+			return m_priority;
+		}
+
+	  private:
+		MempoolOrdering m_ordering;
+		size_t m_max_bytes;
+		TransactionPriority m_priority;
+	};
+
+	class Ingestion
+	{
+	  public:
+		Ingestion()
+		    : m_port(0), m_workers(2), m_queue_size(1024), m_rate(16 * 1024 * 1024), m_burst(4 * 1024 * 1024),
+		      m_max_transaction_bytes(64 * 1024)
+		{
+		}
+
+		// Port sets the port on which clients submit transactions; without it, clients cannot submit transactions
+		class Port : Setting
+		{
+		  public:
+			explicit Port(int port) : m_port(port)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_ingestion.m_port = m_port;
+			}
+
+			int m_port;
+		};
+
+		// Workers sets how many threads parse, hash and validate submitted transactions
+		class Workers : Setting
+		{
+		  public:
+			explicit Workers(size_t workers) : m_workers(workers)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_ingestion.m_workers = std::max<size_t>(1, m_workers);
+			}
+
+			size_t m_workers;
+		};
+
+		// QueueSize sets how many submissions may wait for the workers; further submissions are turned away as busy
+		class QueueSize : Setting
+		{
+		  public:
+			explicit QueueSize(size_t size) : m_size(size)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_ingestion.m_queue_size = std::max<size_t>(1, m_size);
+			}
+
+			size_t m_size;
+		};
+
+		// RateLimit sets how many bytes per second each client may submit on average, and how many it may submit at
+		// once after it was idle; a submission larger than the burst is always throttled, and a client that sends one
+		// larger than the burst and the largest transaction together is disconnected
+		class RateLimit : Setting
+		{
+		  public:
+			RateLimit(size_t rate, size_t burst) : m_rate(rate), m_burst(burst)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_ingestion.m_rate = m_rate;
+				settings.m_ingestion.m_burst = m_burst;
+			}
+
+			size_t m_rate;
+			size_t m_burst;
+		};
+
+		// MaxTransactionBytes limits the size of a submitted transaction
+		class MaxTransactionBytes : Setting
+		{
+		  public:
+			explicit MaxTransactionBytes(size_t bytes) : m_bytes(bytes)
+			{
+			}
+
+		  private:
+			void apply(Settings &settings) override
+			{
+				settings.m_ingestion.m_max_transaction_bytes = m_bytes;
+			}
+
+			size_t m_bytes;
+		};
+
+		bool enabled() const
+		{
+			return m_port != 0;
+		}
+
+		int port() const
+		{
+			return m_port;
+		}
+
+		size_t workers() const
+		{
+			return m_workers;
+		}
+
+		size_t queue_size() const
+		{
+			return m_queue_size;
+		}
+
+		size_t rate() const
+		{
+			return m_rate;
+		}
+
+		size_t burst() const
+		{
+			return m_burst;
+		}
+
+		size_t max_transaction_bytes() const
+		{
+			return m_max_transaction_bytes;
+		}
+
+	  private:
+		int m_port;
+		size_t m_workers;
+		size_t m_queue_size;
+		size_t m_rate;
+		size_t m_burst;
+		size_t m_max_transaction_bytes;
+	};
+
 	Consensus consensus() const
 	{
 		return m_consensus;
@@ -162,9 +902,45 @@ class Settings
 		return m_round_duration;
 	}
 
+	Crypto crypto() const
+	{
+		return m_crypto;
+	}
+
+	Inbound inbound() const
+	{
+		return m_inbound;
+	}
+
+	Outbound outbound() const
+	{
+		return m_outbound;
+	}
+
+	Dissemination dissemination() const
+	{
+		return m_dissemination;
+	}
+
+	Mempool mempool() const
+	{
+		return m_mempool;
+	}
+
+	Ingestion ingestion() const
+	{
+		return m_ingestion;
+	}
+
   private:
 	Consensus m_consensus;
 	RoundDuration m_round_duration;
+	Crypto m_crypto;
+	Inbound m_inbound;
+	Outbound m_outbound;
+	Dissemination m_dissemination;
+	Mempool m_mempool;
+	Ingestion m_ingestion;
 };
 
 } // namespace Quasar
@@ -0,0 +1,495 @@
+#include <array>
+#include <cstring>
+#include <optional>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define QUASAR_SHA256_X86
+#endif
+
+#include "exception.h"
+#include "sha256.h"
+
+namespace Quasar::Sha256
+{
+
+namespace
+{
+
+const size_t BLOCK_SIZE = 64;
+
+const std::array<uint32_t, 8> IV = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+alignas(64) const std::array<uint32_t, 64> K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+uint32_t load_be32(const uint8_t *ptr)
+{
+	return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 | (uint32_t)ptr[2] << 8 | (uint32_t)ptr[3];
+}
+
+void store_be32(uint8_t *ptr, uint32_t value)
+{
+	ptr[0] = (uint8_t)(value >> 24);
+	ptr[1] = (uint8_t)(value >> 16);
+	ptr[2] = (uint8_t)(value >> 8);
+	ptr[3] = (uint8_t)value;
+}
+
+// Cursor iterates over the padded blocks of a message.
+// The full blocks are read from the message itself; the one or two final blocks are assembled in a scratch buffer.
+class Cursor
+{
+  public:
+	explicit Cursor(std::span<const byte> message)
+	    : m_data((const uint8_t *)message.data()), m_full_blocks(message.size() / BLOCK_SIZE), m_next(0)
+	{
+		auto remainder = message.size() % BLOCK_SIZE;
+		auto tail_blocks = remainder + 9 <= BLOCK_SIZE ? 1 : 2;
+		m_blocks = m_full_blocks + tail_blocks;
+
+		std::memcpy(m_tail.data(), m_data + m_full_blocks * BLOCK_SIZE, remainder);
+		m_tail[remainder] = 0x80;
+
+		uint64_t bit_length = (uint64_t)message.size() * 8;
+		auto end = tail_blocks * BLOCK_SIZE;
+		for (int i = 0; i < 8; i++)
+		{
+			m_tail[end - 1 - i] = (uint8_t)(bit_length >> (8 * i));
+		}
+	}
+
+	const uint8_t *current() const
+	{
+		if (m_next < m_full_blocks)
+		{
+			return m_data + m_next * BLOCK_SIZE;
+		}
+		return m_tail.data() + (m_next - m_full_blocks) * BLOCK_SIZE;
+	}
+
+	size_t remaining() const
+	{
+		return m_blocks - m_next;
+	}
+
+	// contiguous returns the number of blocks, starting at the current one, that are stored next to each other
+	size_t contiguous() const
+	{
+		return m_next < m_full_blocks ? m_full_blocks - m_next : m_blocks - m_next;
+	}
+
+	void advance(size_t blocks)
+	{
+		m_next += blocks;
+	}
+
+  private:
+	const uint8_t *m_data;
+	size_t m_full_blocks;
+	size_t m_blocks;
+	size_t m_next;
+	std::array<uint8_t, 2 * BLOCK_SIZE> m_tail{};
+};
+
+// a single-message compression function that processes a number of consecutive blocks
+using CompressFn = void (*)(uint32_t state[8], const uint8_t *blocks, size_t count);
+
+uint32_t rotr(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+void compress_scalar(uint32_t state[8], const uint8_t *blocks, size_t count)
+{
+	for (; count > 0; count--, blocks += BLOCK_SIZE)
+	{
+		std::array<uint32_t, 64> w{};
+		for (size_t t = 0; t < 16; t++)
+		{
+			w[t] = load_be32(blocks + 4 * t);
+		}
+		for (size_t t = 16; t < 64; t++)
+		{
+			auto s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+			auto s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+			w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+		}
+
+		auto a = state[0], b = state[1], c = state[2], d = state[3];
+		auto e = state[4], f = state[5], g = state[6], h = state[7];
+		for (size_t t = 0; t < 64; t++)
+		{
+			auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+			auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+}
+
+#ifdef QUASAR_SHA256_X86
+
+__attribute__((target("sha,sse4.1"))) void compress_sha_ni(uint32_t state[8], const uint8_t *blocks, size_t count)
+{
+	const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	// the SHA instructions expect the state as (A, B, E, F) and (C, D, G, H)
+	__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	for (; count > 0; count--, blocks += BLOCK_SIZE)
+	{
+		const __m128i abef = state0;
+		const __m128i cdgh = state1;
+		__m128i msg[4];
+
+		// each group performs four rounds and computes the next four words of the message schedule
+		for (size_t group = 0; group < 16; group++)
+		{
+			auto &cur = msg[group % 4];
+			if (group < 4)
+			{
+				cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(blocks + 16 * group)), byte_swap);
+			}
+			else
+			{
+				const auto &prev = msg[(group - 1) % 4];
+				tmp = _mm_alignr_epi8(prev, msg[(group - 2) % 4], 4);
+				cur = _mm_sha256msg1_epu32(cur, msg[(group - 3) % 4]);
+				cur = _mm_add_epi32(cur, tmp);
+				cur = _mm_sha256msg2_epu32(cur, prev);
+			}
+
+			__m128i words = _mm_add_epi32(cur, _mm_load_si128((const __m128i *)&K[4 * group]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+			words = _mm_shuffle_epi32(words, 0x0E);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, words);
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+// Multi-lane kernels use GCC vector extensions, so the same code is compiled for AVX2 and AVX-512.
+// Lane i of every vector belongs to the i-th message in flight.
+typedef uint32_t lanes8 __attribute__((vector_size(32)));
+typedef uint32_t lanes16 __attribute__((vector_size(64)));
+
+// a macro rather than a function, since vector arguments would not be passed in registers outside of the kernels
+#define ROTR_LANES(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+template <typename V, size_t LANES>
+[[gnu::always_inline]] inline void compress_lanes(V state[8], const uint8_t *const blocks[LANES])
+{
+	V w[16];
+	for (size_t t = 0; t < 16; t++)
+	{
+		for (size_t lane = 0; lane < LANES; lane++)
+		{
+			w[t][lane] = load_be32(blocks[lane] + 4 * t);
+		}
+	}
+
+	V a = state[0], b = state[1], c = state[2], d = state[3];
+	V e = state[4], f = state[5], g = state[6], h = state[7];
+	for (size_t t = 0; t < 64; t++)
+	{
+		if (t >= 16)
+		{
+			auto w15 = w[(t - 15) % 16];
+			auto w2 = w[(t - 2) % 16];
+			auto s0 = ROTR_LANES(w15, 7) ^ ROTR_LANES(w15, 18) ^ (w15 >> 3);
+			auto s1 = ROTR_LANES(w2, 17) ^ ROTR_LANES(w2, 19) ^ (w2 >> 10);
+			w[t % 16] += s0 + w[(t - 7) % 16] + s1;
+		}
+
+		V t1 = h + (ROTR_LANES(e, 6) ^ ROTR_LANES(e, 11) ^ ROTR_LANES(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t % 16];
+		V t2 = (ROTR_LANES(a, 2) ^ ROTR_LANES(a, 13) ^ ROTR_LANES(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+__attribute__((target("avx2"))) void compress_avx2(lanes8 state[8], const uint8_t *const blocks[8])
+{
+	compress_lanes<lanes8, 8>(state, blocks);
+}
+
+__attribute__((target("avx512f"))) void compress_avx512(lanes16 state[8], const uint8_t *const blocks[16])
+{
+	compress_lanes<lanes16, 16>(state, blocks);
+}
+
+bool cpu_has_sha_ni()
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0)
+	{
+		return false;
+	}
+	// the SHA kernel also uses SSE4.1 blends
+	return (ebx & (1U << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+}
+
+#endif
+
+void finish(uint32_t state[8], Hash &output)
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		store_be32(output.data() + 4 * i, state[i]);
+	}
+}
+
+void hash_sequential(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs, CompressFn compress)
+{
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		auto state = IV;
+		Cursor cursor{inputs[i]};
+		while (cursor.remaining() > 0)
+		{
+			auto count = cursor.contiguous();
+			compress(state.data(), cursor.current(), count);
+			cursor.advance(count);
+		}
+		finish(state.data(), outputs[i]);
+	}
+}
+
+#ifdef QUASAR_SHA256_X86
+
+// hash_lanes keeps every lane of a multi-lane kernel busy with its own message.
+// When a message is done, its lane is refilled with the next input. Once fewer than half of the lanes are busy,
+// the remaining messages are finished one at a time with the single-message kernel.
+template <typename V, size_t LANES, void (*COMPRESS)(V *, const uint8_t *const *)>
+void hash_lanes(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs, CompressFn single)
+{
+	static const std::array<uint8_t, BLOCK_SIZE> idle_block{};
+
+	std::array<std::optional<Cursor>, LANES> cursors;
+	std::array<size_t, LANES> indices{};
+	V state[8];
+	size_t next_input = 0;
+	size_t active = 0;
+
+	auto fill_lane = [&](size_t lane) {
+		if (next_input == inputs.size())
+		{
+			cursors[lane].reset();
+			return;
+		}
+		cursors[lane].emplace(inputs[next_input]);
+		indices[lane] = next_input++;
+		for (size_t i = 0; i < 8; i++)
+		{
+			state[i][lane] = IV[i];
+		}
+		active++;
+	};
+
+	for (size_t lane = 0; lane < LANES; lane++)
+	{
+		fill_lane(lane);
+	}
+
+	while (2 * active > LANES)
+	{
+		std::array<const uint8_t *, LANES> blocks{};
+		for (size_t lane = 0; lane < LANES; lane++)
+		{
+			blocks[lane] = cursors[lane] ? cursors[lane]->current() : idle_block.data();
+		}
+
+		COMPRESS(state, blocks.data());
+
+		for (size_t lane = 0; lane < LANES; lane++)
+		{
+			if (!cursors[lane])
+			{
+				continue;
+			}
+			cursors[lane]->advance(1);
+			if (cursors[lane]->remaining() == 0)
+			{
+				uint32_t words[8];
+				for (size_t i = 0; i < 8; i++)
+				{
+					words[i] = state[i][lane];
+				}
+				finish(words, outputs[indices[lane]]);
+				active--;
+				fill_lane(lane);
+			}
+		}
+	}
+
+	for (size_t lane = 0; lane < LANES; lane++)
+	{
+		if (!cursors[lane])
+		{
+			continue;
+		}
+		uint32_t words[8];
+		for (size_t i = 0; i < 8; i++)
+		{
+			words[i] = state[i][lane];
+		}
+		auto &cursor = *cursors[lane];
+		while (cursor.remaining() > 0)
+		{
+			auto count = cursor.contiguous();
+			single(words, cursor.current(), count);
+			cursor.advance(count);
+		}
+		finish(words, outputs[indices[lane]]);
+	}
+
+	// inputs that never got a lane
+	hash_sequential(inputs.subspan(next_input), outputs.subspan(next_input), single);
+}
+
+#endif
+
+Kernel detect_kernel()
+{
+	if (is_supported(Kernel::AVX512))
+	{
+		return Kernel::AVX512;
+	}
+	if (is_supported(Kernel::SHA_NI))
+	{
+		return Kernel::SHA_NI;
+	}
+	if (is_supported(Kernel::AVX2))
+	{
+		return Kernel::AVX2;
+	}
+	return Kernel::SCALAR;
+}
+
+} // namespace
+
+Kernel best_kernel()
+{
+	static const Kernel kernel = detect_kernel();
+	return kernel;
+}
+
+bool is_supported(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::SCALAR:
+		return true;
+#ifdef QUASAR_SHA256_X86
+	case Kernel::SHA_NI:
+		return cpu_has_sha_ni();
+	case Kernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+	case Kernel::AVX512:
+		return __builtin_cpu_supports("avx512f");
+#endif
+	default:
+		return false;
+	}
+}
+
+const char *kernel_name(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::SCALAR:
+		return "scalar";
+	case Kernel::SHA_NI:
+		return "sha-ni";
+	case Kernel::AVX2:
+		return "avx2";
+	case Kernel::AVX512:
+		return "avx512";
+	}
+	return "unknown";
+}
+
+void hash_many(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs, Kernel kernel)
+{
+	if (inputs.size() != outputs.size())
+	{
+		throw QUASAR_EXCEPTION("got {} inputs, but {} outputs", inputs.size(), outputs.size());
+	}
+
+	if (!is_supported(kernel))
+	{
+		throw QUASAR_EXCEPTION("SHA-256 kernel {} is not supported by this CPU", kernel_name(kernel));
+	}
+
+#ifdef QUASAR_SHA256_X86
+	// the multi-lane kernels finish up with the fastest single-message kernel
+	CompressFn single = is_supported(Kernel::SHA_NI) ? compress_sha_ni : compress_scalar;
+
+	switch (kernel)
+	{
+	case Kernel::SHA_NI:
+		return hash_sequential(inputs, outputs, compress_sha_ni);
+	case Kernel::AVX2:
+		return hash_lanes<lanes8, 8, compress_avx2>(inputs, outputs, single);
+	case Kernel::AVX512:
+		return hash_lanes<lanes16, 16, compress_avx512>(inputs, outputs, single);
+	default:
+		break;
+	}
+#endif
+
+	hash_sequential(inputs, outputs, compress_scalar);
+}
+
+} // namespace Quasar::Sha256
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <span>
+
+#include "types.h"
+
+namespace Quasar::Sha256
+{
+
+// Kernel identifies an implementation of the SHA-256 compression function.
+enum class Kernel
+{
+	SCALAR, // portable implementation, one message at a time
+	SHA_NI, // x86 SHA extensions, one message at a time
+	AVX2,   // 8 messages in parallel, one per 32-bit lane
+	AVX512, // 16 messages in parallel, one per 32-bit lane
+};
+
+// best_kernel returns the fastest kernel that is supported by the CPU.
+Kernel best_kernel();
+bool is_supported(Kernel kernel);
+const char *kernel_name(Kernel kernel);
+
+// hash_many computes the digest of each input and stores it in the output at the same index.
+// The multi-lane kernels hash several messages at once, which pays off when there are many small inputs.
+void hash_many(std::span<const std::span<const byte>> inputs, std::span<Hash> outputs,
+               Kernel kernel = best_kernel());
+
+} // namespace Quasar::Sha256
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "crypto.h"
+#include "sha256.h"
+
+namespace
+{
+
+const std::vector<Quasar::Sha256::Kernel> ALL_KERNELS{Quasar::Sha256::Kernel::SCALAR, Quasar::Sha256::Kernel::SHA_NI,
+                                                      Quasar::Sha256::Kernel::AVX2, Quasar::Sha256::Kernel::AVX512};
+
+} // namespace
+
+TEST_CASE("SHA-256 kernels compute the known digest", "[sha256]")
+{
+	const std::string input = "abc";
+	const std::vector<std::span<const std::byte>> inputs{std::as_bytes(std::span{input})};
+	const auto want =
+	    Quasar::Hash::from_hex_string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+	for (auto kernel : ALL_KERNELS)
+	{
+		if (!Quasar::Sha256::is_supported(kernel))
+		{
+			continue;
+		}
+		std::vector<Quasar::Hash> outputs(1);
+		Quasar::Sha256::hash_many(inputs, outputs, kernel);
+		REQUIRE(outputs[0] == want);
+	}
+}
+
+TEST_CASE("SHA-256 kernels agree with Crypto::hash", "[sha256]")
+{
+	// cover every padding case and messages that span many blocks
+	std::vector<std::vector<std::byte>> messages;
+	for (size_t length = 0; length < 300; length++)
+	{
+		std::vector<std::byte> message(length);
+		for (size_t i = 0; i < length; i++)
+		{
+			message[i] = std::byte(i * 7 + length);
+		}
+		messages.push_back(std::move(message));
+	}
+
+	const std::vector<std::span<const std::byte>> inputs(messages.begin(), messages.end());
+	std::vector<Quasar::Hash> want;
+	for (auto input : inputs)
+	{
+		want.push_back(Quasar::Crypto::hash(input));
+	}
+
+	for (auto kernel : ALL_KERNELS)
+	{
+		if (!Quasar::Sha256::is_supported(kernel))
+		{
+			continue;
+		}
+		std::vector<Quasar::Hash> outputs(inputs.size());
+		Quasar::Sha256::hash_many(inputs, outputs, kernel);
+		REQUIRE(outputs == want);
+	}
+}
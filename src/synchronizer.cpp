@@ -1,29 +1,30 @@
+#include <google/protobuf/arena.h>
+#include <algorithm>
+
 #include "synchronizer.h"
-#include "crypto.h"
+#include "exception.h"
 #include "quorum.h"
 
 namespace Quasar
 {
 
 Synchronizer::Synchronizer(const RoundDuration &round_duration, const std::shared_ptr<EventQueue> &event_queue,
-                           const std::shared_ptr<Network> &network, const std::shared_ptr<Keystore> &keystore,
+                           const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Network> &network,
+                           const std::shared_ptr<Keystore> &keystore,
+                           const std::shared_ptr<CertificateVerifier> &verifier,
                            const std::shared_ptr<spdlog::logger> &logger)
-    : m_round(0), m_round_duration(round_duration), m_event_queue(event_queue), m_network(network),
-      m_keystore(keystore), m_logger(logger), m_timeout_timer(0)
+    : m_round(0), m_round_duration(round_duration), m_event_queue(event_queue), m_reactor(reactor),
+      m_network(network), m_keystore(keystore), m_verifier(verifier), m_logger(logger), m_timeout_timer(0)
 {
 }
 
 void Synchronizer::init()
 {
-	m_event_queue->appendListener(EventType::MESSAGE, [self = shared_from_this()](const EventData &event) {
-		auto &pair = std::get<std::pair<Signature, Proto::MessageData>>(event);
-		self->handle_message(pair.first, pair.second);
-	});
+	m_event_queue->append_listener<MessageEvent>(
+	    [self = shared_from_this()](const MessageEvent &event) { self->handle_message(event.signature, *event.data); });
 
-	m_event_queue->appendListener(EventType::TIMEOUT, [self = shared_from_this()](const EventData &event) {
-		auto round = std::get<Round>(event);
-		self->handle_timeout(round);
-	});
+	m_event_queue->append_listener<TimeoutEvent>(
+	    [self = shared_from_this()](const TimeoutEvent &event) { self->handle_timeout(event.round); });
 }
 
 Round Synchronizer::round() const
@@ -51,11 +52,14 @@ void Synchronizer::advance_to(Round round, bool timeout)
 
 	m_round = round;
 
+	// messages for earlier rounds that were not sent yet are of no use to anyone
+	m_network->purge(round);
+
 	start_timeout_timer();
 
 	m_round_duration.round_started();
 
-	m_event_queue->dispatch(EventType::ADVANCE, std::make_pair(round, timeout));
+	m_event_queue->dispatch(AdvanceEvent{round, timeout});
 }
 
 std::chrono::duration<double> Synchronizer::round_duration() const
@@ -86,14 +90,27 @@ void Synchronizer::handle_wish(const Signature &sig, const Proto::MessageData &m
 		return;
 	}
 
+	// signatures are randomized, so a wish that is sent again is not dropped as a duplicate on receipt
 	auto &wishes = m_wishes[round];
+	auto same_signer = [&](const Signature &wish) { return wish.signer() == sig.signer(); };
+	if (std::any_of(wishes.begin(), wishes.end(), same_signer))
+	{
+		m_logger->debug("duplicate wish for round {} by {:.8}", round, sig.signer().to_hex_string());
+		return;
+	}
 	wishes.push_back(sig);
 
-	if (wishes.size() >= quorum_size(m_network->size()))
+	const auto quorum = (size_t)quorum_size(m_network->size());
+	if (wishes.size() >= quorum)
 	{
 		const Certificate cert(wishes);
 		// clear wishes so that we don't create the cert again if another wish shows up later
 		wishes.clear();
+		if (cert.signers().size() < quorum)
+		{
+			return;
+		}
+		m_verifier->add_verified(cert, msg.wish().SerializeAsString());
 
 		perform_advance(cert, round);
 	}
@@ -102,7 +119,16 @@ void Synchronizer::handle_wish(const Signature &sig, const Proto::MessageData &m
 void Synchronizer::handle_advance(const Signature &sig, const Proto::MessageData &msg)
 {
 	auto round = (Round)msg.advance().wish().round();
-	const Certificate cert{msg.advance().certificate()};
+	std::optional<Certificate> cert;
+	try
+	{
+		cert.emplace(msg.advance().certificate(), *m_keystore->validators());
+	}
+	catch (const Exception &e)
+	{
+		m_logger->warn("timeout certificate from {:.8} is malformed: {}", sig.signer().to_hex_string(), e.what());
+		return;
+	}
 
 	if (m_round >= round)
 	{
@@ -111,7 +137,7 @@ void Synchronizer::handle_advance(const Signature &sig, const Proto::MessageData
 		return;
 	}
 
-	if (!Crypto::verify_certificate(cert, msg.advance().wish().SerializeAsString(), *m_keystore))
+	if (!m_verifier->verify(*cert, msg.advance().wish().SerializeAsString()))
 	{
 		m_logger->warn("timeout certificate received from {:.8} is invalid", sig.signer().to_hex_string());
 		return;
@@ -123,71 +149,61 @@ void Synchronizer::handle_advance(const Signature &sig, const Proto::MessageData
 
 void Synchronizer::handle_timeout(Quasar::Round round)
 {
-	Proto::Wish wish;
-	wish.set_round(round);
-	auto sig = Crypto::sign(wish.SerializeAsString(), *m_keystore->private_key());
-
-	Proto::Message msg;
-	auto sig_ptr = msg.mutable_signature();
-	*sig_ptr = sig.to_proto();
-
-	auto data_ptr = msg.mutable_data();
+	google::protobuf::Arena arena;
+	auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto data_ptr = msg->mutable_data();
 	auto wish_ptr = data_ptr->mutable_wish();
-	*wish_ptr = wish;
+	wish_ptr->set_round(round);
 
-	m_network->broadcast_message(msg);
+	auto sig = m_keystore->sign(wish_ptr->SerializeAsString());
+	sig.to_proto(msg->mutable_signature());
+
+	if (!m_network->broadcast_message(*msg))
+	{
+		m_logger->warn("wish for round {} was dropped for peers whose queue is full", round);
+	}
 	handle_wish(sig, *data_ptr);
 }
 
 void Synchronizer::cleanup_wishes(Round min_round)
 {
-	for (auto it = m_wishes.begin(); it != m_wishes.end();)
-	{
-		if (it->first < min_round)
-		{
-			m_wishes.erase(it);
-		}
-		else
-		{
-			it++;
-		}
-	}
+	m_wishes.erase_if([min_round](const auto &entry) { return entry.first < min_round; });
 }
 
 void Synchronizer::start_timeout_timer()
 {
-	auto duration = m_round_duration.expected_duration();
+	auto deadline = Reactor::Clock::now() + m_round_duration.expected_duration();
 
-	m_timeout_timer = m_timer_manager.add(duration, [self = shared_from_this(), round = m_round](auto timer_id) {
-		// prevent this timer from executing again
-		self->m_timer_manager.remove(timer_id);
-
-		self->m_event_queue->dispatch(EventType::TIMEOUT, round);
+	// the timer runs on the consensus thread, so the timeout is dispatched right away
+	m_timeout_timer = m_reactor->add_timer(deadline, [self = shared_from_this(), round = m_round] {
+		self->m_event_queue->dispatch(TimeoutEvent{round});
 	});
 }
 
 void Synchronizer::stop_timeout_timer()
 {
-	m_timer_manager.remove(m_timeout_timer);
+	m_reactor->cancel_timer(m_timeout_timer);
 }
 
 void Synchronizer::perform_advance(const Certificate &cert, Round round)
 {
-	Proto::Message msg;
-	auto msg_data_ptr = msg.mutable_data();
+	google::protobuf::Arena arena;
+	auto msg = google::protobuf::Arena::CreateMessage<Proto::Message>(&arena);
+	auto msg_data_ptr = msg->mutable_data();
 	auto advance_ptr = msg_data_ptr->mutable_advance();
 
-	auto cert_ptr = advance_ptr->mutable_certificate();
-	*cert_ptr = cert.to_proto();
+	cert.to_proto(advance_ptr->mutable_certificate(), *m_keystore->validators());
 
 	auto wish_ptr = advance_ptr->mutable_wish();
 	wish_ptr->set_round(round);
 
-	auto sig = Crypto::sign(msg_data_ptr->SerializeAsString(), *m_keystore->private_key());
-	auto msg_sig_ptr = msg.mutable_signature();
-	*msg_sig_ptr = sig.to_proto();
+	auto sig = m_keystore->sign(msg_data_ptr->SerializeAsString());
+	sig.to_proto(msg->mutable_signature());
 
-	m_network->broadcast_message(msg);
+	if (!m_network->broadcast_message(*msg))
+	{
+		m_logger->warn("advance to round {} was dropped for peers whose queue is full", round);
+	}
 	handle_advance(sig, *msg_data_ptr);
 }
 
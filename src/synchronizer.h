@@ -1,11 +1,13 @@
 #pragma once
 
-#include <cpptime.h>
 #include <spdlog/logger.h>
 
+#include "certificate_verifier.h"
 #include "event.h"
+#include "flat_map.h"
 #include "keystore.h"
 #include "network.h"
+#include "reactor.h"
 #include "round_duration.h"
 #include "types.h"
 
@@ -18,7 +20,8 @@ class Synchronizer : public std::enable_shared_from_this<Synchronizer>
 {
   public:
 	Synchronizer(const RoundDuration &round_duration, const std::shared_ptr<EventQueue> &event_queue,
-	             const std::shared_ptr<Network> &network, const std::shared_ptr<Keystore> &keystore,
+	             const std::shared_ptr<Reactor> &reactor, const std::shared_ptr<Network> &network,
+	             const std::shared_ptr<Keystore> &keystore, const std::shared_ptr<CertificateVerifier> &verifier,
 	             const std::shared_ptr<spdlog::logger> &logger);
 	void init();
 
@@ -43,17 +46,18 @@ class Synchronizer : public std::enable_shared_from_this<Synchronizer>
 	void perform_advance(const Certificate &cert, Round round);
 
 	std::shared_ptr<EventQueue> m_event_queue;
+	std::shared_ptr<Reactor> m_reactor;
 	std::shared_ptr<Network> m_network;
 	std::shared_ptr<Keystore> m_keystore;
+	std::shared_ptr<CertificateVerifier> m_verifier;
 	std::shared_ptr<spdlog::logger> m_logger;
 
 	RoundDuration m_round_duration;
-	CppTime::Timer m_timer_manager;
 
-	CppTime::timer_id m_timeout_timer;
+	Reactor::TimerId m_timeout_timer;
 	Round m_round;
 
-	std::unordered_map<Round, std::vector<Signature>> m_wishes;
+	FlatMap<Round, std::vector<Signature>> m_wishes;
 };
 
 } // namespace Quasar
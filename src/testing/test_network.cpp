@@ -11,24 +11,29 @@ TestNetworkNode::TestNetworkNode(Identity identity, std::shared_ptr<TestNetwork>
 {
 }
 
-void TestNetworkNode::send_message(const Identity &recipient, const Proto::Message &msg)
+bool TestNetworkNode::send_message(const Identity &recipient, const SerializedMessage &msg, Lane lane, Round round)
 {
 	m_network->send_message(recipient, msg);
+	return true;
 }
 
-void TestNetworkNode::broadcast_message(const Proto::Message &msg)
+bool TestNetworkNode::broadcast_message(const SerializedMessage &msg, Lane lane, Round round)
 {
 	m_network->broadcast_message(m_id, msg);
+	return true;
 }
 
-void TestNetworkNode::set_message_handler(std::function<void(Proto::Message &)> handler)
+void TestNetworkNode::set_message_handler(std::function<void(MessagePtr)> handler)
 {
 	m_message_handler = std::move(handler);
 }
 
-void TestNetworkNode::add_message(const Proto::Message &msg)
+void TestNetworkNode::add_message(const SerializedMessage &msg)
 {
-	m_message_queue.push(msg);
+	// each recipient parses its own copy, like it would over a real network
+	auto copy = make_message(msg->size());
+	copy->ParseFromString(*msg);
+	m_message_queue.push(std::move(copy));
 }
 
 void TestNetworkNode::handle_message()
@@ -43,7 +48,7 @@ void TestNetworkNode::handle_message()
 
 	if (m_message_handler)
 	{
-		m_message_handler(msg);
+		m_message_handler(std::move(msg));
 	}
 }
 
@@ -64,7 +69,7 @@ std::shared_ptr<TestNetworkNode> TestNetwork::create_node(const Identity &id)
 	return node;
 }
 
-void TestNetwork::send_message(const Identity &recipient, const Proto::Message &msg)
+void TestNetwork::send_message(const Identity &recipient, const SerializedMessage &msg)
 {
 	auto conn_entry = m_nodes.find(recipient);
 	if (conn_entry == m_nodes.end())
@@ -75,7 +80,7 @@ void TestNetwork::send_message(const Identity &recipient, const Proto::Message &
 	conn_entry->second->add_message(msg);
 }
 
-void TestNetwork::broadcast_message(const Identity &id_from, const Proto::Message &msg)
+void TestNetwork::broadcast_message(const Identity &id_from, const SerializedMessage &msg)
 {
 	for (auto [id, node] : m_nodes)
 	{
@@ -15,28 +15,30 @@ class TestNetworkNode : public Network
   public:
 	explicit TestNetworkNode(Identity identity, std::shared_ptr<TestNetwork> network);
 
-	void send_message(const Identity &recipient, const Proto::Message &msg) override;
-	void broadcast_message(const Proto::Message &msg) override;
-	void set_message_handler(std::function<void(Proto::Message &)> handler) override;
+	using Network::broadcast_message;
+	using Network::send_message;
+	bool send_message(const Identity &recipient, const SerializedMessage &msg, Lane lane, Round round) override;
+	bool broadcast_message(const SerializedMessage &msg, Lane lane, Round round) override;
+	void set_message_handler(std::function<void(MessagePtr)> handler) override;
 	int size() override;
 	std::vector<Identity> connected_peers() override;
 
-	void add_message(const Proto::Message &msg);
+	void add_message(const SerializedMessage &msg);
 	void handle_message();
 
   private:
 	Identity m_id;
 	std::shared_ptr<TestNetwork> m_network;
-	std::function<void(Proto::Message &)> m_message_handler;
-	std::queue<Proto::Message> m_message_queue;
+	std::function<void(MessagePtr)> m_message_handler;
+	std::queue<MessagePtr> m_message_queue;
 };
 
 class TestNetwork : public std::enable_shared_from_this<TestNetwork>
 {
   public:
 	std::shared_ptr<TestNetworkNode> create_node(const Identity &id);
-	void send_message(const Identity &recipient, const Proto::Message &msg);
-	void broadcast_message(const Identity &id_from, const Proto::Message &msg);
+	void send_message(const Identity &recipient, const SerializedMessage &msg);
+	void broadcast_message(const Identity &id_from, const SerializedMessage &msg);
 	int size();
 	std::vector<Identity> nodes_except(Identity except_id);
 	void run_for(int ticks);
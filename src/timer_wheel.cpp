@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <bit>
+
+#include "timer_wheel.h"
+
+namespace Quasar
+{
+
+static_assert(TimerWheel::SLOTS == 64, "a slot bitmap must fit into a uint64_t");
+
+TimerWheel::TimerWheel(Clock::time_point now)
+    : m_origin(now), m_current(0), m_size(0), m_free(NIL), m_due_tail(NIL), m_occupied()
+{
+	m_heads.fill(NIL);
+}
+
+TimerWheel::TimerId TimerWheel::add(Clock::time_point deadline, Callback callback)
+{
+	uint32_t index;
+	if (m_free != NIL)
+	{
+		index = m_free;
+		m_free = m_nodes[index].next;
+	}
+	else
+	{
+		index = (uint32_t)m_nodes.size();
+		m_nodes.push_back({{}, 0, 1, NIL, NIL, FREE});
+	}
+
+	auto &node = m_nodes[index];
+	node.callback = std::move(callback);
+	// round up, so that a timer never runs before its deadline
+	node.deadline = ticks(deadline, true);
+	insert(index);
+	m_size++;
+
+	return (TimerId)node.generation << 32 | index;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+	const auto index = (uint32_t)id;
+	if (index >= m_nodes.size() || m_nodes[index].generation != (uint32_t)(id >> 32) || m_nodes[index].list == FREE)
+	{
+		return false;
+	}
+
+	unlink(index);
+	release(index);
+	return true;
+}
+
+size_t TimerWheel::advance(Clock::time_point now)
+{
+	const auto target = ticks(now, false);
+	if (target > m_current)
+	{
+		// collect the timers of every slot that the wheels turn past; on each level, that is at most all of them
+		for (size_t level = 0; level < LEVELS; level++)
+		{
+			const auto shift = level * SLOT_BITS;
+			const auto elapsed = (target >> shift) - (m_current >> shift);
+			if (elapsed == 0)
+			{
+				break;
+			}
+
+			auto passed = ~uint64_t{0};
+			if (elapsed < SLOTS)
+			{
+				passed = std::rotl((uint64_t{1} << elapsed) - 1, (int)(((m_current >> shift) + 1) % SLOTS));
+			}
+
+			for (auto slots = m_occupied[level] & passed; slots != 0; slots &= slots - 1)
+			{
+				const auto list = (uint16_t)(level * SLOTS + std::countr_zero(slots));
+				while (m_heads[list] != NIL)
+				{
+					const auto index = m_heads[list];
+					unlink(index);
+					m_cascade.push_back(index);
+				}
+			}
+		}
+
+		m_current = target;
+
+		// due timers go to the due list in the order of their deadlines, the others to a lower level
+		std::stable_sort(m_cascade.begin(), m_cascade.end(),
+		                 [this](uint32_t a, uint32_t b) { return m_nodes[a].deadline < m_nodes[b].deadline; });
+		for (auto index : m_cascade)
+		{
+			insert(index);
+		}
+		m_cascade.clear();
+	}
+
+	size_t count = 0;
+	while (m_heads[DUE] != NIL)
+	{
+		// take the callback out first, as it may add timers and so move the nodes
+		const auto index = m_heads[DUE];
+		unlink(index);
+		auto callback = std::move(m_nodes[index].callback);
+		release(index);
+
+		callback();
+		count++;
+	}
+	return count;
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::next_deadline() const
+{
+	if (m_heads[DUE] != NIL)
+	{
+		return m_origin + std::chrono::milliseconds{m_current};
+	}
+
+	std::optional<uint64_t> next;
+	for (size_t level = 0; level < LEVELS; level++)
+	{
+		if (m_occupied[level] == 0)
+		{
+			continue;
+		}
+
+		// find the first occupied slot after the current one, which the wheel reaches after distance turns
+		const auto shift = level * SLOT_BITS;
+		const auto position = m_current >> shift;
+		const auto distance = std::countr_zero(std::rotr(m_occupied[level], (int)((position + 1) % SLOTS))) + 1;
+		const auto tick = (position + distance) << shift;
+		next = next ? std::min(*next, tick) : tick;
+	}
+
+	if (!next)
+	{
+		return std::nullopt;
+	}
+	return m_origin + std::chrono::milliseconds{*next};
+}
+
+size_t TimerWheel::size() const
+{
+	return m_size;
+}
+
+uint64_t TimerWheel::ticks(Clock::time_point time, bool round_up) const
+{
+	if (time <= m_origin)
+	{
+		return 0;
+	}
+
+	const auto elapsed = time - m_origin;
+	return round_up ? std::chrono::ceil<std::chrono::milliseconds>(elapsed).count()
+	                : std::chrono::floor<std::chrono::milliseconds>(elapsed).count();
+}
+
+void TimerWheel::insert(uint32_t index)
+{
+	const auto deadline = m_nodes[index].deadline;
+	if (deadline <= m_current)
+	{
+		link(index, DUE);
+		return;
+	}
+
+	// the level is given by the highest group of bits in which the deadline differs from the current time, and the
+	// slot by the deadline's bits in that group, so that the timer moves down once the wheel reaches the slot
+	auto level = std::min((size_t)(std::bit_width(deadline ^ m_current) - 1) / SLOT_BITS, LEVELS - 1);
+	const auto shift = level * SLOT_BITS;
+	auto slot = (deadline >> shift) % SLOTS;
+
+	// on the top level, the deadline may be more than one turn ahead; the timer then waits for the longest time
+	// possible and is inserted again from there
+	if ((deadline >> shift) - (m_current >> shift) >= SLOTS)
+	{
+		slot = ((m_current >> shift) - 1) % SLOTS;
+	}
+
+	link(index, (uint16_t)(level * SLOTS + slot));
+}
+
+void TimerWheel::link(uint32_t index, uint16_t list)
+{
+	auto &node = m_nodes[index];
+	node.list = list;
+
+	if (list == DUE)
+	{
+		// due timers run first in, first out
+		node.prev = m_due_tail;
+		node.next = NIL;
+		if (m_due_tail != NIL)
+		{
+			m_nodes[m_due_tail].next = index;
+		}
+		else
+		{
+			m_heads[DUE] = index;
+		}
+		m_due_tail = index;
+		return;
+	}
+
+	node.prev = NIL;
+	node.next = m_heads[list];
+	if (node.next != NIL)
+	{
+		m_nodes[node.next].prev = index;
+	}
+	m_heads[list] = index;
+	m_occupied[list / SLOTS] |= uint64_t{1} << (list % SLOTS);
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+	auto &node = m_nodes[index];
+	if (node.prev != NIL)
+	{
+		m_nodes[node.prev].next = node.next;
+	}
+	else
+	{
+		m_heads[node.list] = node.next;
+	}
+	if (node.next != NIL)
+	{
+		m_nodes[node.next].prev = node.prev;
+	}
+	else if (node.list == DUE)
+	{
+		m_due_tail = node.prev;
+	}
+
+	if (node.list != DUE && m_heads[node.list] == NIL)
+	{
+		m_occupied[node.list / SLOTS] &= ~(uint64_t{1} << (node.list % SLOTS));
+	}
+}
+
+void TimerWheel::release(uint32_t index)
+{
+	auto &node = m_nodes[index];
+	node.callback = {};
+	// invalidate the id, so that cancelling a timer that ran does not cancel the next one in this node
+	node.generation++;
+	node.list = FREE;
+	node.next = m_free;
+	m_free = index;
+	m_size--;
+}
+
+} // namespace Quasar
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "event.h"
+
+namespace Quasar
+{
+
+// TimerWheel is a hierarchical timing wheel with a resolution of one millisecond. Timers are kept in intrusive lists,
+// one per slot, so that adding and cancelling a timer takes constant time; a timer moves down at most once per level
+// before it runs, unless its deadline is beyond the range of the top level (about 4.6 hours).
+// It is not thread-safe and is meant to be driven by the thread that runs the timers.
+class TimerWheel
+{
+  public:
+	using Clock = std::chrono::steady_clock;
+	// TimerId identifies a timer; ids of timers that ran or were cancelled are never reused, and 0 is never an id
+	using TimerId = uint64_t;
+
+	static constexpr size_t LEVELS = 4;
+	static constexpr size_t SLOT_BITS = 6;
+	static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+
+	explicit TimerWheel(Clock::time_point now = Clock::now());
+
+	// add runs the callback once, on the first call to advance at or after the deadline
+	TimerId add(Clock::time_point deadline, Callback callback);
+	// cancel returns false if the timer already ran or was cancelled
+	bool cancel(TimerId id);
+
+	// advance runs all timers that are due at now, including timers that are added by their callbacks with a
+	// deadline that has passed, and returns how many ran
+	size_t advance(Clock::time_point now);
+
+	// next_deadline is the earliest time at which advance has work to do, or nullopt if there are no timers.
+	// It may be earlier than the next deadline, when timers have to move down to a lower level first.
+	std::optional<Clock::time_point> next_deadline() const;
+
+	size_t size() const;
+
+  private:
+	static constexpr uint32_t NIL = UINT32_MAX;
+	// lists are the slots of every level, followed by the list of due timers
+	static constexpr uint16_t DUE = LEVELS * SLOTS;
+	static constexpr uint16_t FREE = UINT16_MAX;
+
+	struct Node
+	{
+		Callback callback;
+		uint64_t deadline;
+		uint32_t generation;
+		uint32_t prev;
+		uint32_t next;
+		uint16_t list;
+	};
+
+	uint64_t ticks(Clock::time_point time, bool round_up) const;
+
+	void insert(uint32_t index);
+	void link(uint32_t index, uint16_t list);
+	void unlink(uint32_t index);
+	void release(uint32_t index);
+
+	Clock::time_point m_origin;
+	uint64_t m_current;
+	size_t m_size;
+
+	std::vector<Node> m_nodes;
+	uint32_t m_free;
+	std::array<uint32_t, LEVELS * SLOTS + 1> m_heads;
+	uint32_t m_due_tail;
+	// occupied has a bit for every non-empty slot, to find the next one without scanning the slots
+	std::array<uint64_t, LEVELS> m_occupied;
+	// cascade is reused by advance for the timers that move down
+	std::vector<uint32_t> m_cascade;
+};
+
+} // namespace Quasar
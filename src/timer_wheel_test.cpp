@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+
+#include "timer_wheel.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const auto START = Quasar::TimerWheel::Clock::time_point{} + 1000h;
+
+} // namespace
+
+TEST_CASE("Timers run once their deadline is reached", "[timer_wheel]")
+{
+	Quasar::TimerWheel wheel{START};
+	std::vector<int> order;
+
+	wheel.add(START + 5ms, [&] { order.push_back(2); });
+	wheel.add(START + 3ms, [&] { order.push_back(1); });
+	wheel.add(START + 300ms, [&] { order.push_back(3); });
+	REQUIRE(wheel.size() == 3);
+	REQUIRE(wheel.next_deadline() == START + 3ms);
+
+	REQUIRE(wheel.advance(START + 2ms) == 0);
+	REQUIRE(wheel.advance(START + 5ms) == 2);
+	REQUIRE((order == std::vector<int>{1, 2}));
+
+	REQUIRE(wheel.advance(START + 299ms) == 0);
+	REQUIRE(wheel.advance(START + 300ms) == 1);
+	REQUIRE(order.back() == 3);
+	REQUIRE(wheel.size() == 0);
+	REQUIRE(!wheel.next_deadline());
+}
+
+TEST_CASE("Cancelled timers do not run", "[timer_wheel]")
+{
+	Quasar::TimerWheel wheel{START};
+	int calls = 0;
+
+	auto id = wheel.add(START + 10ms, [&] { calls++; });
+	REQUIRE(wheel.cancel(id));
+	REQUIRE(!wheel.cancel(id));
+	REQUIRE(wheel.size() == 0);
+
+	// the node of the cancelled timer is reused, but its old id does not refer to the new timer
+	auto other = wheel.add(START + 10ms, [&] { calls++; });
+	REQUIRE(other != id);
+	REQUIRE(!wheel.cancel(id));
+
+	REQUIRE(wheel.advance(START + 10ms) == 1);
+	REQUIRE(calls == 1);
+	REQUIRE(!wheel.cancel(other));
+}
+
+TEST_CASE("Timers that are added by a timer and already due run in the same advance", "[timer_wheel]")
+{
+	Quasar::TimerWheel wheel{START};
+	int calls = 0;
+
+	wheel.add(START + 1ms, [&] {
+		calls++;
+		wheel.add(START, [&] { calls++; });
+	});
+
+	REQUIRE(wheel.advance(START + 1ms) == 2);
+	REQUIRE(calls == 2);
+}
+
+TEST_CASE("Timers on higher levels run on time", "[timer_wheel]")
+{
+	Quasar::TimerWheel wheel{START};
+	std::mt19937_64 random{42};
+	std::uniform_int_distribution<int64_t> delays{0, 48LL * 3600 * 1000}; // beyond the range of the wheel
+
+	std::vector<std::chrono::milliseconds> deadlines(1000);
+	std::vector<int64_t> fired(deadlines.size(), -1);
+	auto now = START;
+	for (size_t i = 0; i < deadlines.size(); i++)
+	{
+		deadlines[i] = std::chrono::milliseconds{delays(random)};
+		wheel.add(START + deadlines[i], [&, i] { fired[i] = (now - START) / 1ms; });
+	}
+
+	// jump from deadline to deadline like a reactor that sleeps until the next one
+	while (auto next = wheel.next_deadline())
+	{
+		REQUIRE(*next >= now);
+		now = *next;
+		wheel.advance(now);
+	}
+
+	for (size_t i = 0; i < deadlines.size(); i++)
+	{
+		REQUIRE(fired[i] == deadlines[i].count());
+	}
+}
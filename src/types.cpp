@@ -1,5 +1,9 @@
 #include <botan/exceptn.h>
 #include <botan/hex.h>
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <utility>
@@ -58,10 +62,32 @@ std::string Hash::to_hex_string() const
 	return Botan::hex_encode(data(), size());
 }
 
-Transaction::Transaction(const std::vector<byte> &data) : m_data(data)
+TransactionView::TransactionView(std::span<const byte> data, const Hash &hash) : m_data(data), m_hash(&hash)
+{
+}
+
+std::span<const byte> TransactionView::data() const
+{
+	return m_data;
+}
+
+const Hash &TransactionView::hash() const
+{
+	return *m_hash;
+}
+
+Transaction::Transaction(const std::vector<byte> &data)
+    : m_data(data), m_hash(Crypto::hash(std::span<const byte>{m_data}))
+{
+}
+
+Transaction::Transaction(std::span<const byte> data)
+    : m_data(data.begin(), data.end()), m_hash(Crypto::hash(std::span<const byte>{m_data}))
+{
+}
+
+Transaction::Transaction(TransactionView view) : m_data(view.data().begin(), view.data().end()), m_hash(view.hash())
 {
-	const std::vector<uint8_t> uint_vec{(const uint8_t *)m_data.data(), (const uint8_t *)m_data.data() + m_data.size()};
-	m_hash = Crypto::hash(uint_vec);
 }
 
 const std::vector<byte> &Transaction::data() const
@@ -74,6 +100,272 @@ const Hash &Transaction::hash() const
 	return m_hash;
 }
 
+TransactionView Transaction::view() const
+{
+	return {m_data, m_hash};
+}
+
+uint64_t short_id(const Hash &hash)
+{
+	uint64_t id;
+	std::memcpy(&id, hash.data(), sizeof(id));
+	return id;
+}
+
+Hash batch_digest(const Identity &author, const Hash &root)
+{
+	std::array<uint8_t, 2 * HASH_LENGTH> buffer{};
+	std::copy(author.begin(), author.end(), buffer.begin());
+	std::copy(root.begin(), root.end(), buffer.begin() + HASH_LENGTH);
+	return Crypto::hash(std::span<const byte>{std::as_bytes(std::span{buffer})});
+}
+
+namespace
+{
+
+// leaves and interior nodes are hashed with different prefixes, as in RFC 6962: otherwise a leaf whose hash is
+// 0x01 || left || right would yield the same root as the two leaves below that interior node
+const uint8_t MERKLE_LEAF_PREFIX = 0x00;
+const uint8_t MERKLE_NODE_PREFIX = 0x01;
+
+Hash hash_merkle_leaf(const Hash &leaf)
+{
+	std::array<uint8_t, 1 + HASH_LENGTH> buffer{};
+	buffer[0] = MERKLE_LEAF_PREFIX;
+	std::memcpy(buffer.data() + 1, leaf.data(), HASH_LENGTH);
+	return Crypto::hash(std::span<const byte>{std::as_bytes(std::span{buffer})});
+}
+
+Hash hash_merkle_node(const Hash &left, const Hash &right)
+{
+	std::array<uint8_t, 1 + 2 * HASH_LENGTH> buffer{};
+	buffer[0] = MERKLE_NODE_PREFIX;
+	std::memcpy(buffer.data() + 1, left.data(), HASH_LENGTH);
+	std::memcpy(buffer.data() + 1 + HASH_LENGTH, right.data(), HASH_LENGTH);
+	return Crypto::hash(std::span<const byte>{std::as_bytes(std::span{buffer})});
+}
+
+} // namespace
+
+void MerkleTree::add(const Hash &leaf)
+{
+	auto carry = hash_merkle_leaf(leaf);
+	size_t level = 0;
+	while ((m_size >> level) & 1)
+	{
+		carry = hash_merkle_node(m_peaks[level], carry);
+		level++;
+	}
+
+	if (level == m_peaks.size())
+	{
+		m_peaks.push_back(carry);
+	}
+	else
+	{
+		m_peaks[level] = carry;
+	}
+
+	m_size++;
+}
+
+Hash MerkleTree::root() const
+{
+	std::optional<Hash> root;
+	for (size_t level = 0; level < m_peaks.size(); level++)
+	{
+		if (((m_size >> level) & 1) == 0)
+		{
+			continue;
+		}
+		root = root ? hash_merkle_node(m_peaks[level], *root) : m_peaks[level];
+	}
+	return root.value_or(Hash{});
+}
+
+size_t MerkleTree::size() const
+{
+	return m_size;
+}
+
+Hash MerkleTree::root(std::span<const Hash> leaves)
+{
+	MerkleTree tree;
+	for (const auto &leaf : leaves)
+	{
+		tree.add(leaf);
+	}
+	return tree.root();
+}
+
+Payload::Iterator::Iterator(const Payload *payload, size_t index) : m_payload(payload), m_index(index)
+{
+}
+
+TransactionView Payload::Iterator::operator*() const
+{
+	return (*m_payload)[m_index];
+}
+
+Payload::Iterator &Payload::Iterator::operator++()
+{
+	m_index++;
+	return *this;
+}
+
+bool Payload::Iterator::operator==(const Iterator &other) const
+{
+	return m_payload == other.m_payload && m_index == other.m_index;
+}
+
+Payload::Payload() = default;
+
+Payload::Payload(const std::vector<Transaction> &transactions)
+{
+	PayloadBuilder builder;
+	for (const auto &tx : transactions)
+	{
+		builder.add(tx.view());
+	}
+	*this = builder.build();
+}
+
+Payload::Payload(std::shared_ptr<const void> owner, std::span<const byte> buffer, std::vector<uint32_t> offsets)
+    : m_owner(std::move(owner)), m_buffer(buffer), m_offsets(std::move(offsets))
+{
+	validate_offsets();
+	hash_transactions();
+}
+
+Payload::Payload(const Proto::Payload &proto) : m_offsets(proto.offsets().begin(), proto.offsets().end())
+{
+	auto buffer = std::make_shared<const std::string>(proto.transactions());
+	m_buffer = std::as_bytes(std::span{*buffer});
+	m_owner = std::move(buffer);
+	validate_offsets();
+	hash_transactions();
+}
+
+Payload::Payload(Proto::Payload &&proto) : m_offsets(proto.offsets().begin(), proto.offsets().end())
+{
+	auto buffer = std::make_shared<const std::string>(std::move(*proto.mutable_transactions()));
+	m_buffer = std::as_bytes(std::span{*buffer});
+	m_owner = std::move(buffer);
+	validate_offsets();
+	hash_transactions();
+}
+
+size_t Payload::size() const
+{
+	return m_offsets.size();
+}
+
+bool Payload::empty() const
+{
+	return m_offsets.empty();
+}
+
+size_t Payload::byte_size() const
+{
+	return m_offsets.empty() ? 0 : m_offsets.back();
+}
+
+const Hash &Payload::root() const
+{
+	return m_root;
+}
+
+TransactionView Payload::operator[](size_t index) const
+{
+	auto start = index == 0 ? 0 : m_offsets[index - 1];
+	return {m_buffer.subspan(start, m_offsets[index] - start), m_hashes[index]};
+}
+
+Payload::Iterator Payload::begin() const
+{
+	return {this, 0};
+}
+
+Payload::Iterator Payload::end() const
+{
+	return {this, m_offsets.size()};
+}
+
+void Payload::to_proto(Proto::Payload *proto) const
+{
+	proto->set_transactions(m_buffer.data(), byte_size());
+	proto->mutable_offsets()->Add(m_offsets.begin(), m_offsets.end());
+}
+
+void Payload::validate_offsets() const
+{
+	uint32_t prev = 0;
+	for (auto offset : m_offsets)
+	{
+		if (offset < prev)
+		{
+			throw QUASAR_EXCEPTION("payload offset {} is smaller than the previous offset {}", offset, prev);
+		}
+		prev = offset;
+	}
+	if (prev > m_buffer.size())
+	{
+		throw QUASAR_EXCEPTION("payload offset {} exceeds buffer size {}", prev, m_buffer.size());
+	}
+}
+
+void Payload::hash_transactions()
+{
+	std::vector<std::span<const byte>> transactions;
+	transactions.reserve(m_offsets.size());
+	for (size_t i = 0; i < m_offsets.size(); i++)
+	{
+		auto start = i == 0 ? 0 : m_offsets[i - 1];
+		transactions.push_back(m_buffer.subspan(start, m_offsets[i] - start));
+	}
+
+	m_hashes.resize(transactions.size());
+	Crypto::hash_batch(transactions, m_hashes);
+	m_root = MerkleTree::root(m_hashes);
+}
+
+void PayloadBuilder::add(TransactionView transaction)
+{
+	auto data = transaction.data();
+	m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+	m_offsets.push_back((uint32_t)m_buffer.size());
+	m_hashes.push_back(transaction.hash());
+	m_tree.add(transaction.hash());
+}
+
+size_t PayloadBuilder::size() const
+{
+	return m_offsets.size();
+}
+
+size_t PayloadBuilder::byte_size() const
+{
+	return m_buffer.size();
+}
+
+Payload PayloadBuilder::build()
+{
+	Payload payload;
+	auto buffer = std::make_shared<const std::vector<byte>>(std::move(m_buffer));
+	payload.m_buffer = std::span{*buffer};
+	payload.m_owner = std::move(buffer);
+	payload.m_offsets = std::move(m_offsets);
+	payload.m_hashes = std::move(m_hashes);
+	payload.m_root = m_tree.root();
+
+	m_buffer = {};
+	m_offsets = {};
+	m_hashes = {};
+	m_tree = {};
+
+	return payload;
+}
+
 const std::array<uint8_t, SIGNATURE_LENGTH> &Signature::data() const
 {
 	return m_data;
@@ -92,11 +384,16 @@ Signature::Signature(const std::array<uint8_t, SIGNATURE_LENGTH> &data, const Id
 Proto::Signature Signature::to_proto() const
 {
 	Proto::Signature proto{};
-	proto.set_data(m_data.data(), m_data.size());
-	proto.set_signer(m_signer.data(), m_signer.size());
+	to_proto(&proto);
 	return proto;
 }
 
+void Signature::to_proto(Proto::Signature *proto) const
+{
+	proto->set_data(m_data.data(), m_data.size());
+	proto->set_signer(m_signer.data(), m_signer.size());
+}
+
 Signature::Signature(const Proto::Signature &proto)
 {
 	std::copy_n(proto.data().begin(), std::min(proto.data().length(), SIGNATURE_LENGTH), m_data.begin());
@@ -108,29 +405,239 @@ const std::vector<Signature> &Certificate::signatures() const
 	return m_signatures;
 }
 
-Certificate::Certificate(const std::vector<Signature> &signatures) : m_signatures(signatures)
+const std::vector<Identity> &Certificate::signers() const
+{
+	return m_signers;
+}
+
+bool Certificate::is_aggregate() const
+{
+	return m_aggregate.has_value();
+}
+
+const AggregateSignature &Certificate::aggregate() const
+{
+	return *m_aggregate;
+}
+
+const Hash &Certificate::digest() const
+{
+	return m_digest;
+}
+
+Certificate::Certificate(std::vector<Signature> signatures) : m_signatures(std::move(signatures))
+{
+	// the compact encoding lists signers in validator order and can hold each signer only once
+	auto by_signer = [](const Signature &a, const Signature &b) { return a.signer() < b.signer(); };
+	auto same_signer = [](const Signature &a, const Signature &b) { return a.signer() == b.signer(); };
+	std::stable_sort(m_signatures.begin(), m_signatures.end(), by_signer);
+	m_signatures.erase(std::unique(m_signatures.begin(), m_signatures.end(), same_signer), m_signatures.end());
+
+	m_signers.reserve(m_signatures.size());
+	std::transform(m_signatures.begin(), m_signatures.end(), std::back_inserter(m_signers),
+	               [](const Signature &sig) { return sig.signer(); });
+
+	compute_digest();
+}
+
+Certificate::Certificate(std::vector<Identity> signers, AggregateSignature aggregate)
+    : m_signers(std::move(signers)), m_aggregate(std::move(aggregate))
+{
+	if (!std::is_sorted(m_signers.begin(), m_signers.end()) ||
+	    std::adjacent_find(m_signers.begin(), m_signers.end()) != m_signers.end())
+	{
+		throw QUASAR_EXCEPTION("signers of an aggregate certificate must be sorted and unique");
+	}
+
+	compute_digest();
+}
+
+Certificate::Certificate(const Proto::CompactCertificate &proto, const ValidatorSet &validators)
+{
+	const auto &signers = proto.signers();
+
+	if (signers.size() > (validators.size() + 7) / 8)
+	{
+		throw QUASAR_EXCEPTION("certificate signer bitmap with {} bytes exceeds validator set of size {}",
+		                       signers.size(), validators.size());
+	}
+
+	for (size_t i = 0; i < signers.size() * 8; i++)
+	{
+		if (((uint8_t)signers[i / 8] & (1u << (i % 8))) == 0)
+		{
+			continue;
+		}
+		if (i >= validators.size())
+		{
+			throw QUASAR_EXCEPTION("certificate signer index {} exceeds validator set of size {}", i,
+			                       validators.size());
+		}
+		m_signers.push_back(validators[i]);
+	}
+
+	const auto count = m_signers.size();
+
+	if (!proto.aggregate().empty())
+	{
+		// each signer contributes a nonce point of the same size
+		if (!proto.signatures().empty() || count == 0 || proto.nonces().size() % count != 0)
+		{
+			throw QUASAR_EXCEPTION("aggregate certificate has {} signers but {} bytes of nonces", count,
+			                       proto.nonces().size());
+		}
+		m_aggregate = AggregateSignature{{proto.nonces().begin(), proto.nonces().end()},
+		                                 {proto.aggregate().begin(), proto.aggregate().end()}};
+		compute_digest();
+		return;
+	}
+
+	const auto &signatures = proto.signatures();
+	if (signatures.size() != count * SIGNATURE_LENGTH || !proto.nonces().empty())
+	{
+		throw QUASAR_EXCEPTION("certificate has {} signers but {} bytes of signatures", count, signatures.size());
+	}
+
+	m_signatures.reserve(count);
+	auto data = signatures.begin();
+	for (const auto &signer : m_signers)
+	{
+		std::array<uint8_t, SIGNATURE_LENGTH> signature{};
+		std::copy_n(data, SIGNATURE_LENGTH, signature.begin());
+		data += SIGNATURE_LENGTH;
+		m_signatures.emplace_back(signature, signer);
+	}
+
+	compute_digest();
+}
+
+void Certificate::compute_digest()
 {
+	std::vector<uint8_t> buffer;
+	if (m_aggregate)
+	{
+		buffer.reserve(m_signers.size() * HASH_LENGTH + m_aggregate->nonces.size() + m_aggregate->scalar.size());
+		for (const auto &signer : m_signers)
+		{
+			buffer.insert(buffer.end(), signer.begin(), signer.end());
+		}
+		buffer.insert(buffer.end(), m_aggregate->nonces.begin(), m_aggregate->nonces.end());
+		buffer.insert(buffer.end(), m_aggregate->scalar.begin(), m_aggregate->scalar.end());
+	}
+	else
+	{
+		buffer.reserve(m_signatures.size() * (SIGNATURE_LENGTH + HASH_LENGTH));
+		for (const auto &sig : m_signatures)
+		{
+			buffer.insert(buffer.end(), sig.data().begin(), sig.data().end());
+			buffer.insert(buffer.end(), sig.signer().begin(), sig.signer().end());
+		}
+	}
+	m_digest = Crypto::hash(std::as_bytes(std::span{buffer}));
 }
 
-Certificate::Certificate(const Proto::Certificate &proto)
+Hash BlockHeader::hash() const
 {
-	std::for_each(proto.signatures().begin(), proto.signatures().end(),
-	              [this](auto sig) { this->m_signatures.push_back(Signature{sig}); });
+	std::array<uint8_t, 4 * HASH_LENGTH + sizeof(Round)> buffer{};
+	auto it = std::copy(parent.begin(), parent.end(), buffer.begin());
+	for (int i = sizeof(Round) - 1; i >= 0; i--)
+	{
+		*it++ = (uint8_t)(round >> (8 * i));
+	}
+	it = std::copy(certificate_digest.begin(), certificate_digest.end(), it);
+	it = std::copy(payload_root.begin(), payload_root.end(), it);
+	std::copy(batches_root.begin(), batches_root.end(), it);
+	return Crypto::hash(std::span<const byte>{std::as_bytes(std::span{buffer})});
 }
 
-Proto::Certificate Certificate::to_proto() const
+Proto::CompactCertificate Certificate::to_proto(const ValidatorSet &validators) const
 {
-	Proto::Certificate proto{};
-	std::for_each(m_signatures.begin(), m_signatures.end(), [&proto](auto signature) {
-		auto ptr = proto.add_signatures();
-		*ptr = signature.to_proto();
-	});
+	Proto::CompactCertificate proto{};
+	to_proto(&proto, validators);
 	return proto;
 }
 
+void Certificate::to_proto(Proto::CompactCertificate *proto, const ValidatorSet &validators) const
+{
+	proto->Clear();
+	if (m_signers.empty())
+	{
+		return;
+	}
+
+	std::string signers;
+	for (const auto &signer : m_signers)
+	{
+		auto index = validators.index_of(signer);
+		if (!index)
+		{
+			throw QUASAR_EXCEPTION_KIND(Exception::Kind::NOT_FOUND, "signer {:.8} is not a validator",
+			                            signer.to_hex_string());
+		}
+		if (signers.size() <= *index / 8)
+		{
+			signers.resize(*index / 8 + 1);
+		}
+		signers[*index / 8] = (char)((uint8_t)signers[*index / 8] | (1u << (*index % 8)));
+	}
+	proto->set_signers(std::move(signers));
+
+	if (m_aggregate)
+	{
+		proto->set_nonces(m_aggregate->nonces.data(), m_aggregate->nonces.size());
+		proto->set_aggregate(m_aggregate->scalar.data(), m_aggregate->scalar.size());
+		return;
+	}
+
+	// signatures are sorted by signer, which is the validator order, so the signature data is appended in order
+	std::string signatures;
+	signatures.reserve(m_signatures.size() * SIGNATURE_LENGTH);
+	for (const auto &sig : m_signatures)
+	{
+		signatures.append((const char *)sig.data().data(), sig.data().size());
+	}
+	proto->set_signatures(std::move(signatures));
+}
+
+ValidatorSet::ValidatorSet(std::vector<Identity> identities) : m_identities(std::move(identities))
+{
+	std::sort(m_identities.begin(), m_identities.end());
+	m_identities.erase(std::unique(m_identities.begin(), m_identities.end()), m_identities.end());
+}
+
+size_t ValidatorSet::size() const
+{
+	return m_identities.size();
+}
+
+const Identity &ValidatorSet::operator[](size_t index) const
+{
+	return m_identities[index];
+}
+
+const std::vector<Identity> &ValidatorSet::identities() const
+{
+	return m_identities;
+}
+
+std::optional<size_t> ValidatorSet::index_of(const Identity &identity) const
+{
+	auto it = std::lower_bound(m_identities.begin(), m_identities.end(), identity);
+	if (it == m_identities.end() || *it != identity)
+	{
+		return std::nullopt;
+	}
+	return (size_t)(it - m_identities.begin());
+}
+
+const BlockHeader &Block::header() const
+{
+	return m_header;
+}
+
 const Hash &Block::parent() const
 {
-	return m_parent;
+	return m_header.parent;
 }
 
 const Certificate &Block::certificate() const
@@ -140,28 +647,69 @@ const Certificate &Block::certificate() const
 
 Round Block::round() const
 {
-	return m_round;
+	return m_header.round;
 }
 
-const std::vector<Transaction> &Block::payload() const
+const Payload &Block::payload() const
 {
 	return m_payload;
 }
 
-Block::Block(const Hash &m_parent, Certificate m_certificate, Round m_round, const std::vector<Transaction> &m_payload)
-    : m_parent(m_parent), m_certificate(std::move(m_certificate)), m_round(m_round), m_payload(m_payload)
+const std::vector<BatchReference> &Block::batches() const
+{
+	return m_batches;
+}
+
+namespace
+{
+
+std::vector<BatchReference> batches_from_proto(const Proto::Block &proto, const ValidatorSet &validators)
+{
+	std::vector<BatchReference> batches;
+	batches.reserve(proto.batches_size());
+	for (const auto &batch : proto.batches())
+	{
+		batches.push_back({Hash::from_byte_string(batch.digest()), Certificate{batch.certificate(), validators}});
+	}
+	return batches;
+}
+
+} // namespace
+
+Hash batches_root(const std::vector<BatchReference> &batches)
+{
+	MerkleTree tree;
+	for (const auto &batch : batches)
+	{
+		tree.add(batch.digest);
+	}
+	return tree.root();
+}
+
+Block::Block(const Hash &parent, Certificate certificate, Round round, Payload payload,
+             std::vector<BatchReference> batches)
+    : m_certificate(std::move(certificate)), m_payload(std::move(payload)), m_batches(std::move(batches)),
+      m_header{parent, round, m_certificate.digest(), m_payload.root(), batches_root(m_batches)},
+      m_hash(m_header.hash())
+{
+}
+
+Block::Block(const Proto::Block &proto, const ValidatorSet &validators)
+    : m_certificate(proto.certificate(), validators), m_payload(proto.payload()),
+      m_batches(batches_from_proto(proto, validators)),
+      m_header{Hash::from_byte_string(proto.parent()), proto.round(), m_certificate.digest(), m_payload.root(),
+               batches_root(m_batches)},
+      m_hash(m_header.hash())
 {
-	m_hash = Crypto::hash(to_proto().SerializeAsString());
 }
 
-Block::Block(const Proto::Block &proto)
-    : m_round(proto.round()), m_certificate(proto.certificate()), m_hash(Crypto::hash(proto.SerializeAsString()))
+Block::Block(Proto::Block &&proto, const ValidatorSet &validators)
+    : m_certificate(proto.certificate(), validators), m_payload(std::move(*proto.mutable_payload())),
+      m_batches(batches_from_proto(proto, validators)),
+      m_header{Hash::from_byte_string(proto.parent()), proto.round(), m_certificate.digest(), m_payload.root(),
+               batches_root(m_batches)},
+      m_hash(m_header.hash())
 {
-	std::for_each(proto.payload().transactions().begin(), proto.payload().transactions().end(), [this](auto raw_tx) {
-		this->m_payload.push_back(
-		    Transaction{{(const byte *)raw_tx.data(), (const byte *)raw_tx.data() + raw_tx.size()}});
-	});
-	std::copy_n(proto.parent().begin(), std::min(proto.parent().length(), HASH_LENGTH), m_parent.begin());
 }
 
 Hash Block::hash() const
@@ -169,17 +717,48 @@ Hash Block::hash() const
 	return m_hash;
 }
 
-Proto::Block Block::to_proto() const
+Proto::Block Block::to_proto(const ValidatorSet &validators) const
 {
 	Proto::Block proto{};
-	proto.set_parent(m_parent.data(), m_parent.size());
-	proto.set_round(m_round);
-	auto payload_mut = proto.mutable_payload();
-	std::for_each(m_payload.begin(), m_payload.end(),
-	              [payload_mut](auto tx) { payload_mut->add_transactions(tx.data().data(), tx.data().size()); });
-	auto cert_ptr = proto.mutable_certificate();
-	*cert_ptr = m_certificate.to_proto();
+	to_proto(&proto, validators);
 	return proto;
 }
 
-} // namespace Quasar
\ No newline at end of file
+void Block::to_proto(Proto::Block *proto, const ValidatorSet &validators) const
+{
+	proto->set_parent(m_header.parent.data(), m_header.parent.size());
+	proto->set_round(m_header.round);
+	m_payload.to_proto(proto->mutable_payload());
+	m_certificate.to_proto(proto->mutable_certificate(), validators);
+	batches_to_proto(proto, validators);
+}
+
+void Block::to_compact_proto(Proto::Block *proto, const ValidatorSet &validators) const
+{
+	proto->set_parent(m_header.parent.data(), m_header.parent.size());
+	proto->set_round(m_header.round);
+	m_certificate.to_proto(proto->mutable_certificate(), validators);
+	batches_to_proto(proto, validators);
+
+	auto compact = proto->mutable_compact_payload();
+	compact->set_root(m_header.payload_root.data(), m_header.payload_root.size());
+
+	auto short_ids = compact->mutable_short_ids();
+	short_ids->reserve(m_payload.size() * sizeof(uint64_t));
+	for (auto transaction : m_payload)
+	{
+		short_ids->append((const char *)transaction.hash().data(), sizeof(uint64_t));
+	}
+}
+
+void Block::batches_to_proto(Proto::Block *proto, const ValidatorSet &validators) const
+{
+	for (const auto &batch : m_batches)
+	{
+		auto batch_proto = proto->add_batches();
+		batch_proto->set_digest(batch.digest.data(), batch.digest.size());
+		batch.certificate.to_proto(batch_proto->mutable_certificate(), validators);
+	}
+}
+
+} // namespace Quasar
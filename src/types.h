@@ -3,7 +3,10 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
 #include "quasar.pb.h"
@@ -34,19 +37,137 @@ class Hash : public std::array<uint8_t, HASH_LENGTH>
 
 using Identity = Hash;
 
+// TransactionView is a non-owning reference to the data and hash of a transaction.
+// It is only valid for as long as the object that it was obtained from.
+class TransactionView
+{
+  public:
+	TransactionView(std::span<const byte> data, const Hash &hash);
+
+	std::span<const byte> data() const;
+	const Hash &hash() const;
+
+  private:
+	std::span<const byte> m_data;
+	const Hash *m_hash;
+};
+
 class Transaction
 {
   public:
 	explicit Transaction(const std::vector<byte> &data);
+	explicit Transaction(std::span<const byte> data);
+	// copies the data and hash of the view, without hashing the data again
+	explicit Transaction(TransactionView view);
 
 	const std::vector<byte> &data() const;
 	const Hash &hash() const;
 
+	TransactionView view() const;
+
   private:
 	std::vector<byte> m_data;
 	Hash m_hash;
 };
 
+// short_id abbreviates a transaction hash to its first eight bytes, by which compact proposals refer to transactions
+uint64_t short_id(const Hash &hash);
+
+// batch_digest identifies a batch by its author and the Merkle root of its transactions
+Hash batch_digest(const Identity &author, const Hash &root);
+
+// MerkleTree incrementally computes the Merkle root of a sequence of leaf hashes, such as transaction hashes.
+// A leaf enters the tree as H(0x00 || leaf) and an interior node is H(0x01 || left || right).
+// It only stores the roots of the complete subtrees seen so far, so adding a leaf takes amortized constant time.
+// The tree has the same shape as in RFC 6962: the left subtree of a node is the largest possible perfect tree.
+class MerkleTree
+{
+  public:
+	void add(const Hash &leaf);
+	// root returns the root of the tree, or the zero hash if no leaves were added
+	Hash root() const;
+	size_t size() const;
+
+	static Hash root(std::span<const Hash> leaves);
+
+  private:
+	// m_peaks[i] holds the root of a perfect subtree with 2^i leaves if bit i of m_size is set
+	std::vector<Hash> m_peaks;
+	size_t m_size = 0;
+};
+
+// Payload stores the transactions of a block in a single contiguous buffer, along with a table of offsets.
+// The buffer can be borrowed from another object, such as a received message, which is then kept alive by the payload.
+class Payload
+{
+  public:
+	class Iterator
+	{
+	  public:
+		Iterator(const Payload *payload, size_t index);
+
+		TransactionView operator*() const;
+		Iterator &operator++();
+		bool operator==(const Iterator &other) const;
+
+	  private:
+		const Payload *m_payload;
+		size_t m_index;
+	};
+
+	Payload();
+	explicit Payload(const std::vector<Transaction> &transactions);
+	// the buffer must remain valid for as long as the owner is alive
+	Payload(std::shared_ptr<const void> owner, std::span<const byte> buffer, std::vector<uint32_t> offsets);
+	explicit Payload(const Proto::Payload &proto);
+	// takes over the transaction buffer of the proto message without copying it
+	explicit Payload(Proto::Payload &&proto);
+
+	size_t size() const;
+	bool empty() const;
+	// byte_size returns the combined size of all transactions
+	size_t byte_size() const;
+	// root returns the Merkle root of the transaction hashes
+	const Hash &root() const;
+
+	TransactionView operator[](size_t index) const;
+	Iterator begin() const;
+	Iterator end() const;
+
+	void to_proto(Proto::Payload *proto) const;
+
+  private:
+	void validate_offsets() const;
+	void hash_transactions();
+
+	std::shared_ptr<const void> m_owner;
+	std::span<const byte> m_buffer;
+	// m_offsets holds the end offset of each transaction in m_buffer
+	std::vector<uint32_t> m_offsets;
+	std::vector<Hash> m_hashes;
+	Hash m_root;
+
+	friend class PayloadBuilder;
+};
+
+// PayloadBuilder assembles a Payload by appending transactions to a single buffer.
+class PayloadBuilder
+{
+  public:
+	void add(TransactionView transaction);
+
+	size_t size() const;
+	size_t byte_size() const;
+
+	Payload build();
+
+  private:
+	std::vector<byte> m_buffer;
+	std::vector<uint32_t> m_offsets;
+	std::vector<Hash> m_hashes;
+	MerkleTree m_tree;
+};
+
 class Signature
 {
   public:
@@ -57,46 +178,131 @@ class Signature
 	const Identity &signer() const;
 
 	Proto::Signature to_proto() const;
+	void to_proto(Proto::Signature *proto) const;
 
   private:
 	std::array<uint8_t, SIGNATURE_LENGTH> m_data{};
 	Identity m_signer{};
 };
 
+// ValidatorSet is the set of validator identities in ascending order.
+// Compact certificates refer to signers by their index in this set, so all nodes must agree on it.
+class ValidatorSet
+{
+  public:
+	ValidatorSet() = default;
+	explicit ValidatorSet(std::vector<Identity> identities);
+
+	size_t size() const;
+	const Identity &operator[](size_t index) const;
+	const std::vector<Identity> &identities() const;
+	// index_of returns the index of the identity, or nothing if it is not a validator
+	std::optional<size_t> index_of(const Identity &identity) const;
+
+  private:
+	std::vector<Identity> m_identities;
+};
+
+// CertificateScheme selects how the signatures in a certificate are represented.
+enum class CertificateScheme
+{
+	ECDSA,   // one ECDSA signature per signer, each verified on its own
+	SCHNORR, // Schnorr signatures half-aggregated into the signers' nonces and a single scalar
+};
+
+// AggregateSignature is a half-aggregated Schnorr signature, see schnorr.h.
+struct AggregateSignature
+{
+	// nonces holds the encoded nonce point of each signer, in signer order
+	std::vector<uint8_t> nonces;
+	std::vector<uint8_t> scalar;
+};
+
+// Certificate is a set of signatures over the same message, sorted by signer.
+// The signatures are either kept individually or as a single aggregate signature.
 class Certificate
 {
   public:
-	explicit Certificate(const std::vector<Signature> &signatures);
-	explicit Certificate(const Proto::Certificate &proto);
+	explicit Certificate(std::vector<Signature> signatures);
+	// signers must be sorted and in the same order as the nonces of the aggregate
+	Certificate(std::vector<Identity> signers, AggregateSignature aggregate);
+	Certificate(const Proto::CompactCertificate &proto, const ValidatorSet &validators);
 
+	const std::vector<Identity> &signers() const;
+	bool is_aggregate() const;
+	// signatures is empty for aggregate certificates
 	const std::vector<Signature> &signatures() const;
+	const AggregateSignature &aggregate() const;
+	// digest returns a hash over all signatures, which is used to commit to the certificate in block headers
+	const Hash &digest() const;
 
-	Proto::Certificate to_proto() const;
+	// to_proto throws if a signer is not part of the validator set
+	Proto::CompactCertificate to_proto(const ValidatorSet &validators) const;
+	void to_proto(Proto::CompactCertificate *proto, const ValidatorSet &validators) const;
 
   private:
+	void compute_digest();
+
+	std::vector<Identity> m_signers;
 	std::vector<Signature> m_signatures;
+	std::optional<AggregateSignature> m_aggregate;
+	Hash m_digest;
+};
+
+// BatchReference refers to a batch of transactions by its digest, along with the certificate that shows that a quorum
+// of validators has stored the batch.
+struct BatchReference
+{
+	Hash digest;
+	Certificate certificate;
 };
 
+// BlockHeader holds the fields that determine the hash of a block.
+// The payload is represented by the Merkle root of its transaction hashes, the batches by the Merkle root of their
+// digests and the certificate by its digest, so the cost of hashing a block does not depend on the size of its payload.
+struct BlockHeader
+{
+	Hash parent;
+	Round round;
+	Hash certificate_digest;
+	Hash payload_root;
+	Hash batches_root;
+
+	Hash hash() const;
+};
+
+// batches_root returns the Merkle root of the digests of the batches
+Hash batches_root(const std::vector<BatchReference> &batches);
+
 class Block
 {
   public:
-	explicit Block(const Proto::Block &proto);
-	Block(const Hash &m_parent, Certificate m_certificate, Round m_round, const std::vector<Transaction> &m_payload);
+	Block(const Proto::Block &proto, const ValidatorSet &validators);
+	Block(Proto::Block &&proto, const ValidatorSet &validators);
+	Block(const Hash &parent, Certificate certificate, Round round, Payload payload,
+	      std::vector<BatchReference> batches = {});
 
 	Hash hash() const;
+	const BlockHeader &header() const;
 	const Hash &parent() const;
 	const Certificate &certificate() const;
 	Round round() const;
-	const std::vector<Transaction> &payload() const;
+	const Payload &payload() const;
+	const std::vector<BatchReference> &batches() const;
 
-	Proto::Block to_proto() const;
+	Proto::Block to_proto(const ValidatorSet &validators) const;
+	void to_proto(Proto::Block *proto, const ValidatorSet &validators) const;
+	// to_compact_proto refers to the transactions of the payload by their short IDs
+	void to_compact_proto(Proto::Block *proto, const ValidatorSet &validators) const;
 
   private:
-	Hash m_hash{};
-	Hash m_parent{};
+	void batches_to_proto(Proto::Block *proto, const ValidatorSet &validators) const;
+
 	Certificate m_certificate;
-	Round m_round;
-	std::vector<Transaction> m_payload;
+	Payload m_payload;
+	std::vector<BatchReference> m_batches;
+	BlockHeader m_header;
+	Hash m_hash;
 };
 
 const Certificate GENESIS_CERT{std::vector<Signature>{}};
@@ -111,12 +317,9 @@ template <> struct hash<Quasar::Hash>
 {
 	size_t operator()(const Quasar::Hash &a) const noexcept
 	{
-		const hash<uint8_t> hasher;
-		size_t h = 0;
-		for (size_t i = 0; i < Quasar::HASH_LENGTH; i++)
-		{
-			h = h * 31 + hasher(a[i]);
-		}
+		// digests are uniformly distributed, so the first word is as good a hash as any
+		size_t h;
+		std::memcpy(&h, a.data(), sizeof(h));
 		return h;
 	}
 };
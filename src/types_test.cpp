@@ -0,0 +1,226 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+
+#include "crypto.h"
+#include "exception.h"
+#include "types.h"
+
+namespace
+{
+
+Quasar::Transaction make_tx(std::initializer_list<uint8_t> bytes)
+{
+	std::vector<std::byte> data;
+	for (auto b : bytes)
+	{
+		data.push_back(std::byte{b});
+	}
+	return Quasar::Transaction{data};
+}
+
+Quasar::Identity make_identity(uint8_t id)
+{
+	Quasar::Identity identity;
+	identity[0] = id;
+	return identity;
+}
+
+Quasar::Signature make_signature(uint8_t signer, uint8_t fill)
+{
+	std::array<uint8_t, Quasar::SIGNATURE_LENGTH> data{};
+	data.fill(fill);
+	return Quasar::Signature{data, make_identity(signer)};
+}
+
+} // namespace
+
+TEST_CASE("Payload keeps transactions in order", "[types]")
+{
+	const std::vector<Quasar::Transaction> txs{make_tx({1, 2, 3}), make_tx({}), make_tx({4, 5})};
+	const Quasar::Payload payload{txs};
+
+	REQUIRE(payload.size() == 3);
+	REQUIRE(payload.byte_size() == 5);
+
+	size_t i = 0;
+	for (auto view : payload)
+	{
+		REQUIRE(std::ranges::equal(view.data(), txs[i].data()));
+		REQUIRE(view.hash() == txs[i].hash());
+		i++;
+	}
+	REQUIRE(i == txs.size());
+}
+
+TEST_CASE("Payload survives a proto round trip", "[types]")
+{
+	const std::vector<Quasar::Transaction> txs{make_tx({1, 2, 3}), make_tx({4}), make_tx({5, 6})};
+	const Quasar::Payload payload{txs};
+
+	Quasar::Proto::Payload proto;
+	payload.to_proto(&proto);
+	const Quasar::Payload decoded{std::move(proto)};
+
+	REQUIRE(decoded.size() == payload.size());
+	for (size_t i = 0; i < payload.size(); i++)
+	{
+		REQUIRE(std::ranges::equal(decoded[i].data(), payload[i].data()));
+		REQUIRE(decoded[i].hash() == payload[i].hash());
+	}
+}
+
+TEST_CASE("Payload rejects invalid offsets", "[types]")
+{
+	Quasar::Proto::Payload proto;
+	proto.set_transactions("abc");
+	proto.add_offsets(2);
+	proto.add_offsets(1);
+	REQUIRE_THROWS_AS(Quasar::Payload{proto}, Quasar::Exception);
+
+	proto.clear_offsets();
+	proto.add_offsets(4);
+	REQUIRE_THROWS_AS(Quasar::Payload{proto}, Quasar::Exception);
+}
+
+TEST_CASE("Certificate survives a compact proto round trip", "[types]")
+{
+	const Quasar::ValidatorSet validators{{make_identity(3), make_identity(1), make_identity(9), make_identity(5)}};
+	REQUIRE(validators.index_of(make_identity(1)) == 0);
+	REQUIRE(validators.index_of(make_identity(9)) == 3);
+	REQUIRE_FALSE(validators.index_of(make_identity(2)));
+
+	const Quasar::Certificate cert{{make_signature(9, 0xAA), make_signature(1, 0xBB), make_signature(5, 0xCC)}};
+	REQUIRE(cert.signatures()[0].signer() == make_identity(1));
+
+	auto proto = cert.to_proto(validators);
+	REQUIRE(proto.signers() == std::string(1, '\x0D'));
+	REQUIRE(proto.signatures().size() == 3 * Quasar::SIGNATURE_LENGTH);
+
+	const Quasar::Certificate decoded{proto, validators};
+	REQUIRE(decoded.digest() == cert.digest());
+	REQUIRE(decoded.signatures().size() == 3);
+	for (size_t i = 0; i < 3; i++)
+	{
+		REQUIRE(decoded.signatures()[i].signer() == cert.signatures()[i].signer());
+		REQUIRE(decoded.signatures()[i].data() == cert.signatures()[i].data());
+	}
+
+	const Quasar::Certificate outsider{{make_signature(2, 0)}};
+	REQUIRE_THROWS_AS(outsider.to_proto(validators), Quasar::Exception);
+
+	proto.set_signers(std::string(1, '\x1D'));
+	REQUIRE_THROWS_AS((Quasar::Certificate{proto, validators}), Quasar::Exception);
+	proto.set_signers(std::string(1, '\x05'));
+	REQUIRE_THROWS_AS((Quasar::Certificate{proto, validators}), Quasar::Exception);
+}
+
+TEST_CASE("Block survives a proto round trip", "[types]")
+{
+	const Quasar::ValidatorSet validators{{make_identity(1), make_identity(2)}};
+	const Quasar::Certificate cert{{make_signature(2, 0x11), make_signature(1, 0x22)}};
+	const Quasar::Block block{Quasar::GENESIS.hash(), cert, 1, Quasar::Payload{{make_tx({1, 2}), make_tx({3})}}};
+	const Quasar::Block decoded{block.to_proto(validators), validators};
+
+	REQUIRE(decoded.hash() == block.hash());
+	REQUIRE(decoded.parent() == block.parent());
+	REQUIRE(decoded.round() == block.round());
+	REQUIRE(decoded.payload().size() == 2);
+}
+
+TEST_CASE("Compact block refers to transactions by short ID", "[types]")
+{
+	const Quasar::ValidatorSet validators{{make_identity(1), make_identity(2)}};
+	const Quasar::Certificate cert{{make_signature(1, 0x11)}};
+	const auto tx1 = make_tx({1, 2});
+	const auto tx2 = make_tx({3});
+	const Quasar::Block block{Quasar::GENESIS.hash(), cert, 1, Quasar::Payload{{tx1, tx2}}};
+
+	Quasar::Proto::Block proto;
+	block.to_compact_proto(&proto, validators);
+	REQUIRE(!proto.has_payload());
+	REQUIRE(Quasar::Hash::from_byte_string(proto.compact_payload().root()) == block.payload().root());
+
+	const auto &short_ids = proto.compact_payload().short_ids();
+	REQUIRE(short_ids.size() == 2 * sizeof(uint64_t));
+	uint64_t id;
+	std::memcpy(&id, short_ids.data() + sizeof(id), sizeof(id));
+	REQUIRE(id == Quasar::short_id(tx2.hash()));
+
+	// a block that is rebuilt from the transactions has the same hash
+	const Quasar::Block rebuilt{Quasar::Hash::from_byte_string(proto.parent()),
+	                            Quasar::Certificate{proto.certificate(), validators}, proto.round(),
+	                            Quasar::Payload{{tx1, tx2}}};
+	REQUIRE(rebuilt.hash() == block.hash());
+}
+
+TEST_CASE("MerkleTree root", "[types]")
+{
+	std::vector<Quasar::Hash> leaves;
+	for (uint8_t i = 0; i < 9; i++)
+	{
+		leaves.push_back(make_tx({i}).hash());
+	}
+
+	REQUIRE(Quasar::MerkleTree::root({}) == Quasar::Hash{});
+	// a single leaf is still hashed, so that a root cannot be passed off as a leaf
+	const auto single = Quasar::MerkleTree::root(std::span{leaves}.first(1));
+	REQUIRE(single != leaves[0]);
+	REQUIRE(single != Quasar::Hash{});
+
+	Quasar::MerkleTree tree;
+	for (size_t i = 0; i < leaves.size(); i++)
+	{
+		tree.add(leaves[i]);
+		REQUIRE(tree.size() == i + 1);
+		REQUIRE(tree.root() == Quasar::MerkleTree::root(std::span{leaves}.first(i + 1)));
+		if (i > 0)
+		{
+			REQUIRE(tree.root() != Quasar::MerkleTree::root(std::span{leaves}.first(i)));
+		}
+	}
+
+	std::swap(leaves[2], leaves[3]);
+	REQUIRE(tree.root() != Quasar::MerkleTree::root(leaves));
+}
+
+TEST_CASE("MerkleTree root of an interior node differs from that of its leaves", "[types]")
+{
+	const auto a = make_tx({1});
+	const auto b = make_tx({2});
+
+	// the transaction is the preimage of the interior node above a and b, with and without the leaf prefix
+	std::vector<std::array<Quasar::Hash, 2>> children{{a.hash(), b.hash()}};
+	std::array<Quasar::Hash, 2> leaves{};
+	for (size_t i = 0; i < 2; i++)
+	{
+		std::vector<Quasar::byte> leaf{Quasar::byte{0x00}};
+		leaf.insert(leaf.end(), (const Quasar::byte *)children[0][i].begin(),
+		            (const Quasar::byte *)children[0][i].end());
+		leaves[i] = Quasar::Crypto::hash(std::span<const Quasar::byte>{leaf});
+	}
+	children.push_back(leaves);
+
+	const Quasar::Payload pair{{a, b}};
+	for (const auto &[left, right] : children)
+	{
+		std::vector<Quasar::byte> node{Quasar::byte{0x01}};
+		node.insert(node.end(), (const Quasar::byte *)left.begin(), (const Quasar::byte *)left.end());
+		node.insert(node.end(), (const Quasar::byte *)right.begin(), (const Quasar::byte *)right.end());
+
+		const Quasar::Payload forged{{Quasar::Transaction{node}}};
+		REQUIRE(forged.root() != pair.root());
+	}
+}
+
+TEST_CASE("Block hash commits to the payload", "[types]")
+{
+	const Quasar::Payload payload{{make_tx({1, 2}), make_tx({3})}};
+	const Quasar::Block block{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 1, payload};
+	const Quasar::Block other{Quasar::GENESIS.hash(), Quasar::GENESIS_CERT, 1, Quasar::Payload{{make_tx({1, 2})}}};
+
+	REQUIRE(block.header().payload_root == payload.root());
+	REQUIRE(block.header().certificate_digest == Quasar::GENESIS_CERT.digest());
+	REQUIRE(block.hash() == block.header().hash());
+	REQUIRE(block.hash() != other.hash());
+}